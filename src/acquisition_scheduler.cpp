@@ -0,0 +1,120 @@
+#include "acquisition_scheduler.h"
+#include "config.h"
+
+AcquisitionScheduler::AcquisitionScheduler()
+    : sensorCount(0),
+      guardMs(SENSOR_CROSSTALK_GUARD_MS),
+      lastCycleMs(0) {
+}
+
+bool AcquisitionScheduler::addSensor(LevelSensor* sensor, uint8_t tank) {
+    if (!sensor || tank >= MAX_TANKS || sensorCount >= MAX_SCHEDULED_SENSORS) {
+        return false;
+    }
+    
+    sensors[sensorCount] = sensor;
+    tanks[sensorCount++] = tank;
+    return true;
+}
+
+uint8_t AcquisitionScheduler::runCycle(SensorReading* readings) {
+    uint32_t cycleStart = millis();
+    
+    for (uint8_t i = 0; i < sensorCount; i++) {
+        sensors[i]->beginBurst();
+    }
+    
+    bool pending = sensorCount > 0;
+    while (pending) {
+        runRound();
+        
+        pending = false;
+        for (uint8_t i = 0; i < sensorCount; i++) {
+            if (!sensors[i]->burstComplete()) {
+                pending = true;
+                break;
+            }
+        }
+    }
+    
+    // Stamp every reading with the middle of the acquisition window
+    lastCycleMs = millis() - cycleStart;
+    uint32_t timestamp = cycleStart + lastCycleMs / 2;
+    
+    uint8_t validCount = 0;
+    for (uint8_t i = 0; i < sensorCount; i++) {
+        readings[i] = sensors[i]->endBurst(timestamp);
+        if (readings[i].isValid) {
+            validCount++;
+        }
+    }
+    
+    #if DEBUG_SENSOR
+    DEBUG_PRINTF("Acquisition cycle: %d sensors in %lu ms\n", sensorCount, (unsigned long)lastCycleMs);
+    #endif
+    
+    return validCount;
+}
+
+void AcquisitionScheduler::runRound() {
+    bool due[MAX_SCHEDULED_SENSORS];
+    bool inFlight[MAX_SCHEDULED_SENSORS] = {false};
+    uint8_t waiting = 0;
+    uint8_t remaining = 0;
+    
+    for (uint8_t i = 0; i < sensorCount; i++) {
+        due[i] = !sensors[i]->burstComplete();
+        if (due[i]) {
+            waiting++;
+        }
+    }
+    
+    // Per tank: a ping in flight, or when the last one finished
+    bool tankBusy[MAX_TANKS] = {false};
+    bool tankSettling[MAX_TANKS] = {false};
+    uint32_t tankDoneMs[MAX_TANKS];
+    bool triggered = false;
+    uint32_t lastTriggerMs = 0;
+    
+    while (waiting > 0 || remaining > 0) {
+        // Fire every sensor whose tank is quiet, staggered by the guard
+        for (uint8_t i = 0; i < sensorCount; i++) {
+            uint8_t tank = tanks[i];
+            if (!due[i] || tankBusy[tank] ||
+                (tankSettling[tank] && millis() - tankDoneMs[tank] < SENSOR_SETTLE_MS)) {
+                continue;
+            }
+            
+            uint32_t sinceTrigger = millis() - lastTriggerMs;
+            if (triggered && sinceTrigger < guardMs) {
+                delay(guardMs - sinceTrigger);
+            }
+            
+            sensors[i]->startPing();
+            lastTriggerMs = millis();
+            triggered = true;
+            due[i] = false;
+            waiting--;
+            inFlight[i] = true;
+            tankBusy[tank] = true;
+            remaining++;
+        }
+        
+        // Echo edges are captured by interrupt; just collect the results
+        for (uint8_t i = 0; i < sensorCount; i++) {
+            if (inFlight[i] && sensors[i]->pollPing()) {
+                inFlight[i] = false;
+                remaining--;
+                tankBusy[tanks[i]] = false;
+                tankSettling[tanks[i]] = true;
+                tankDoneMs[tanks[i]] = millis();
+            }
+        }
+        
+        if (waiting > 0 || remaining > 0) {
+            delay(1);
+        }
+    }
+    
+    delay(SENSOR_SETTLE_MS); // Shared ring-down for all sensors
+}
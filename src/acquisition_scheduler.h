@@ -0,0 +1,53 @@
+#ifndef ACQUISITION_SCHEDULER_H
+#define ACQUISITION_SCHEDULER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "level_sensor.h"
+
+// Every sensor of every tank (redundant sensors included)
+#define MAX_SCHEDULED_SENSORS (MAX_TANKS * MAX_TANK_SENSORS)
+
+/**
+ * Interleaves the ping windows of several level sensors.
+ *
+ * Each round fires every sensor that still needs samples, staggered by a
+ * crosstalk guard interval, then waits for all echoes together. The settle
+ * time of one sensor overlaps with the pings of the others, and all
+ * readings of a cycle share one timestamp.
+ *
+ * Sensors on the same tank hear each other's echoes for the whole window,
+ * far longer than the guard, so within a round they take turns: the next
+ * one fires only after the previous one's ping has finished and rung down.
+ */
+class AcquisitionScheduler {
+public:
+    AcquisitionScheduler();
+    
+    // Sensor registration (order defines reading order); sensors of one
+    // tank never ping at the same time
+    bool addSensor(LevelSensor* sensor, uint8_t tank);
+    void clear() { sensorCount = 0; }
+    uint8_t getSensorCount() const { return sensorCount; }
+    
+    // Delay between triggers of different sensors within a round
+    void setGuardInterval(uint32_t guardMs) { this->guardMs = guardMs; }
+    uint32_t getGuardInterval() const { return guardMs; }
+    
+    // Run one full acquisition cycle; readings[i] belongs to sensor i
+    uint8_t runCycle(SensorReading* readings);
+    
+    // Statistics
+    uint32_t getLastCycleTime() const { return lastCycleMs; }
+    
+private:
+    LevelSensor* sensors[MAX_SCHEDULED_SENSORS];
+    uint8_t tanks[MAX_SCHEDULED_SENSORS];
+    uint8_t sensorCount;
+    uint32_t guardMs;
+    uint32_t lastCycleMs;
+    
+    void runRound();
+};
+
+#endif // ACQUISITION_SCHEDULER_H
@@ -0,0 +1,99 @@
+#include "auto_calibrator.h"
+
+AutoCalibrator::AutoCalibrator() {
+    reset();
+}
+
+void AutoCalibrator::reset() {
+    memset(histogram, 0, sizeof(histogram));
+    total = 0;
+    proposal.emptyMm = 0;
+    proposal.fullMm = 0;
+    proposal.emptyConfidence = 0;
+    proposal.fullConfidence = 0;
+    proposal.valid = false;
+}
+
+void AutoCalibrator::observe(const SensorReading& reading) {
+    if (!reading.isValid) {
+        return;
+    }
+    
+    uint16_t bin = min((uint16_t)(reading.distanceMm / AUTOCAL_BIN_MM), (uint16_t)(AUTOCAL_BINS - 1));
+    
+    // Halve everything when a bin saturates: old history fades out
+    // while the shape of the distribution is kept
+    if (histogram[bin] == UINT16_MAX) {
+        total = 0;
+        for (uint16_t i = 0; i < AUTOCAL_BINS; i++) {
+            histogram[i] >>= 1;
+            total += histogram[i];
+        }
+    }
+    
+    histogram[bin]++;
+    total++;
+}
+
+DistanceMm AutoCalibrator::percentile(uint16_t permille) const {
+    uint32_t target = (total * permille + 999) / 1000;
+    uint32_t cumulative = 0;
+    
+    for (uint16_t i = 0; i < AUTOCAL_BINS; i++) {
+        cumulative += histogram[i];
+        if (cumulative >= target && cumulative > 0) {
+            return i * AUTOCAL_BIN_MM + AUTOCAL_BIN_MM / 2; // Bin centre
+        }
+    }
+    return (AUTOCAL_BINS - 1) * AUTOCAL_BIN_MM;
+}
+
+uint32_t AutoCalibrator::countBelow(DistanceMm distance) const {
+    uint32_t count = 0;
+    for (uint16_t i = 0; i < AUTOCAL_BINS && (uint32_t)(i + 1) * AUTOCAL_BIN_MM <= distance; i++) {
+        count += histogram[i];
+    }
+    return count;
+}
+
+uint32_t AutoCalibrator::countAbove(DistanceMm distance) const {
+    uint32_t count = 0;
+    for (uint16_t i = distance / AUTOCAL_BIN_MM + 1; i < AUTOCAL_BINS; i++) {
+        count += histogram[i];
+    }
+    return count;
+}
+
+uint8_t AutoCalibrator::confidence(uint32_t beyond) {
+    return (uint8_t)min(beyond * 100 / AUTOCAL_MIN_BEYOND, (uint32_t)100);
+}
+
+bool AutoCalibrator::propose(DistanceMm currentEmptyMm, DistanceMm currentFullMm) {
+    proposal.emptyMm = currentEmptyMm;
+    proposal.fullMm = currentFullMm;
+    proposal.emptyConfidence = 0;
+    proposal.fullConfidence = 0;
+    proposal.valid = false;
+    
+    if (total < AUTOCAL_MIN_READINGS) {
+        return false;
+    }
+    
+    // Farthest robust extreme past the empty mark: level was clamped at 0 %
+    DistanceMm deepest = percentile(1000 - AUTOCAL_TAIL_PERMILLE);
+    if (deepest > currentEmptyMm + AUTOCAL_MARGIN_MM) {
+        proposal.emptyMm = deepest;
+        proposal.emptyConfidence = confidence(countAbove(currentEmptyMm + AUTOCAL_MARGIN_MM));
+        proposal.valid = true;
+    }
+    
+    // Nearest robust extreme past the full mark: level was clamped at 100 %
+    DistanceMm shallowest = percentile(AUTOCAL_TAIL_PERMILLE);
+    if (shallowest + AUTOCAL_MARGIN_MM < currentFullMm) {
+        proposal.fullMm = shallowest;
+        proposal.fullConfidence = confidence(countBelow(currentFullMm - AUTOCAL_MARGIN_MM));
+        proposal.valid = true;
+    }
+    
+    return proposal.valid;
+}
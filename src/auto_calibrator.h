@@ -0,0 +1,60 @@
+#ifndef AUTO_CALIBRATOR_H
+#define AUTO_CALIBRATOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "fixed_point.h"
+#include "level_sensor.h"
+
+// Histogram extent (covers the 5 m sensor range)
+#define AUTOCAL_BINS 512
+
+// Auto-calibration mode
+enum AutoCalMode {
+    AUTOCAL_OFF = 0,
+    AUTOCAL_PROPOSE = 1,    // Report proposed bounds only
+    AUTOCAL_APPLY = 2       // Apply confident proposals
+};
+
+// Proposed calibration with per-bound confidence (0-100%)
+struct CalibrationProposal {
+    DistanceMm emptyMm;
+    DistanceMm fullMm;
+    uint8_t emptyConfidence;
+    uint8_t fullConfidence;
+    bool valid;             // At least one bound differs from the current one
+};
+
+/**
+ * Learns tank bounds from the long-run distribution of filtered distances.
+ *
+ * Readings are counted in a decaying histogram; the 1st and 99th
+ * percentiles are the robust extremes. A bound is only ever widened, and
+ * only when the tank has been observed past it (the level was clamped at
+ * 0 % or 100 %): never having seen the tank full is no evidence that the
+ * full mark is wrong.
+ */
+class AutoCalibrator {
+public:
+    AutoCalibrator();
+    
+    void observe(const SensorReading& reading);
+    void reset();
+    
+    // Compare the observed extremes against the current calibration
+    bool propose(DistanceMm currentEmptyMm, DistanceMm currentFullMm);
+    const CalibrationProposal& getProposal() const { return proposal; }
+    uint32_t getReadingCount() const { return total; }
+    
+private:
+    uint16_t histogram[AUTOCAL_BINS];
+    uint32_t total;
+    CalibrationProposal proposal;
+    
+    DistanceMm percentile(uint16_t permille) const;
+    uint32_t countBelow(DistanceMm distance) const;
+    uint32_t countAbove(DistanceMm distance) const;
+    static uint8_t confidence(uint32_t beyond);
+};
+
+#endif // AUTO_CALIBRATOR_H
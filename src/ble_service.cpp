@@ -2,14 +2,21 @@
 #include "pump_controller.h"
 #include "config.h"
 
+#if HAS_BLE
+// Tanks 1-2 keep their original characteristics; later tanks follow the config one
+static void tankCharUuid(char* uuid, size_t size, uint8_t index) {
+    uint16_t suffix = index < 2 ? BLE_TANK1_CHAR_SUFFIX + index : BLE_TANK3_CHAR_SUFFIX + index - 2;
+    snprintf(uuid, size, BLE_TANK_CHAR_UUID_PREFIX "%04x", suffix);
+}
+#endif
+
 WaterLevelBLE::WaterLevelBLE(ConfigManager& configManager)
     : configManager(configManager)
 #if HAS_BLE
       , pumpController(nullptr)
       , pServer(nullptr)
       , pService(nullptr)
-      , pTank1Char(nullptr)
-      , pTank2Char(nullptr)
+      , tankCount(0)
       , pPumpChar(nullptr)
       , pConfigChar(nullptr)
       , running(false)
@@ -17,6 +24,11 @@ WaterLevelBLE::WaterLevelBLE(ConfigManager& configManager)
       , oldDeviceConnected(false)
 #endif
 {
+    #if HAS_BLE
+    for (uint8_t i = 0; i < MAX_TANKS; i++) {
+        pTankChars[i] = nullptr;
+    }
+    #endif
 }
 
 bool WaterLevelBLE::begin() {
@@ -36,24 +48,21 @@ bool WaterLevelBLE::begin() {
     pServer = BLEDevice::createServer();
     pServer->setCallbacks(new ServerCallbacks(this));
     
-    // Create BLE service
-    pService = pServer->createService(BLE_SERVICE_UUID);
-    
-    // Tank 1 Level characteristic (read + notify)
-    pTank1Char = pService->createCharacteristic(
-        BLE_TANK1_CHAR_UUID,
-        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
-    );
-    pTank1Char->addDescriptor(new BLE2902());
-    pTank1Char->setValue("0");
-    
-    // Tank 2 Level characteristic (read + notify)
-    pTank2Char = pService->createCharacteristic(
-        BLE_TANK2_CHAR_UUID,
-        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
-    );
-    pTank2Char->addDescriptor(new BLE2902());
-    pTank2Char->setValue("0");
+    // Create BLE service (handles: service + 3 per tank level + 2 pump + 2 config)
+    tankCount = constrain(config.tankCount, 1, MAX_TANKS);
+    pService = pServer->createService(BLEUUID(BLE_SERVICE_UUID), 1 + MAX_TANKS * 3 + 4);
+    
+    // Tank Level characteristics (read + notify)
+    for (uint8_t i = 0; i < tankCount; i++) {
+        char uuid[40];
+        tankCharUuid(uuid, sizeof(uuid), i);
+        pTankChars[i] = pService->createCharacteristic(
+            uuid,
+            BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+        );
+        pTankChars[i]->addDescriptor(new BLE2902());
+        pTankChars[i]->setValue("0");
+    }
     
     // Pump Status characteristic (read + write)
     pPumpChar = pService->createCharacteristic(
@@ -97,43 +106,22 @@ void WaterLevelBLE::stop() {
     #endif
 }
 
-void WaterLevelBLE::updateTank1Level(float levelPercent) {
-    #if !HAS_BLE
-        return;
-    #endif
-    
-    #if HAS_BLE
-    if (!running || !pTank1Char) return;
-    
-    char buffer[16];
-    snprintf(buffer, sizeof(buffer), "%.1f", levelPercent);
-    pTank1Char->setValue(buffer);
-    
-    if (deviceConnected) {
-        pTank1Char->notify();
-        #if DEBUG_BLE
-        DEBUG_PRINTF("BLE: Tank1 level updated: %.1f%%\n", levelPercent);
-        #endif
-    }
-    #endif
-}
-
-void WaterLevelBLE::updateTank2Level(float levelPercent) {
+void WaterLevelBLE::updateTankLevel(uint8_t index, CentiPercent level) {
     #if !HAS_BLE
         return;
     #endif
     
     #if HAS_BLE
-    if (!running || !pTank2Char) return;
+    if (!running || index >= tankCount || !pTankChars[index]) return;
     
     char buffer[16];
-    snprintf(buffer, sizeof(buffer), "%.1f", levelPercent);
-    pTank2Char->setValue(buffer);
+    formatFixed(buffer, sizeof(buffer), (level + 5) / 10, 1); // Same "12.3" format as before
+    pTankChars[index]->setValue(buffer);
     
     if (deviceConnected) {
-        pTank2Char->notify();
+        pTankChars[index]->notify();
         #if DEBUG_BLE
-        DEBUG_PRINTF("BLE: Tank2 level updated: %.1f%%\n", levelPercent);
+        DEBUG_PRINTF("BLE: Tank%d level updated: %s%%\n", index + 1, buffer);
         #endif
     }
     #endif
@@ -182,9 +170,9 @@ void WaterLevelBLE::PumpCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
         DEBUG_PRINTF("BLE: Pump control command: %c\n", cmd);
         
         if (cmd == '1') {
-            bleService->pumpController->turnOn();
+            bleService->pumpController->post(PUMP_CMD_ON, PUMP_ORIGIN_BLE);
         } else if (cmd == '0') {
-            bleService->pumpController->turnOff();
+            bleService->pumpController->post(PUMP_CMD_OFF, PUMP_ORIGIN_BLE);
         }
     }
 }
@@ -13,6 +13,7 @@
 #endif
 
 #include "config_manager.h"
+#include "fixed_point.h"
 
 // Forward declaration
 class PumpController;
@@ -25,9 +26,8 @@ public:
     bool begin();
     void stop();
     
-    // Update characteristic values
-    void updateTank1Level(float levelPercent);
-    void updateTank2Level(float levelPercent);
+    // Update characteristic values (tank index is 0-based)
+    void updateTankLevel(uint8_t index, CentiPercent level);
     void updatePumpStatus(bool isOn);
     
     // Status
@@ -61,8 +61,8 @@ private:
         
         BLEServer* pServer;
         BLEService* pService;
-        BLECharacteristic* pTank1Char;
-        BLECharacteristic* pTank2Char;
+        BLECharacteristic* pTankChars[MAX_TANKS];  // One per configured tank
+        uint8_t tankCount;
         BLECharacteristic* pPumpChar;
         BLECharacteristic* pConfigChar;
         
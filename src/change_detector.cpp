@@ -0,0 +1,82 @@
+#include "change_detector.h"
+
+ChangeDetector::ChangeDetector()
+    : initialized(false), lastLevel(0), lastRate(0), lastTimestamp(0),
+      sumUpQ4(0), sumDownQ4(0), anchor(0), hasPending(false), events(0), missed(0) {
+}
+
+void ChangeDetector::reset() {
+    initialized = false;
+    sumUpQ4 = 0;
+    sumDownQ4 = 0;
+}
+
+bool ChangeDetector::update(uint8_t tank, const SensorReading& reading) {
+    if (!reading.isValid) {
+        return false;
+    }
+    
+    if (!initialized) {
+        lastLevel = reading.filteredCenti;
+        lastRate = reading.rateCentiPerMin;
+        lastTimestamp = reading.timestamp;
+        initialized = true;
+        return false;
+    }
+    
+    // Where the previous trend says the level should be now (Q4; 16 / 60000 ms)
+    int64_t dtMs = reading.timestamp - lastTimestamp;
+    int32_t predictedQ4 = ((int32_t)lastLevel << 4) + (int32_t)(lastRate * dtMs / 3750);
+    int32_t deviationQ4 = ((int32_t)reading.filteredCenti << 4) - predictedQ4;
+    int32_t slackQ4 = (int32_t)(CHANGE_SLACK * dtMs / 3750);
+    
+    if (sumUpQ4 == 0 && sumDownQ4 == 0) {
+        anchor = lastLevel;
+    }
+    sumUpQ4 = max((int32_t)0, sumUpQ4 + deviationQ4 - slackQ4);
+    sumDownQ4 = max((int32_t)0, sumDownQ4 - deviationQ4 - slackQ4);
+    
+    lastLevel = reading.filteredCenti;
+    lastRate = reading.rateCentiPerMin;
+    lastTimestamp = reading.timestamp;
+    
+    bool up = sumUpQ4 >= (CHANGE_THRESHOLD << 4);
+    bool down = sumDownQ4 >= (CHANGE_THRESHOLD << 4);
+    if (!up && !down) {
+        return false;
+    }
+    
+    // The new behaviour is the trend from here on
+    sumUpQ4 = 0;
+    sumDownQ4 = 0;
+    events++;
+    
+    if (hasPending.load(std::memory_order_acquire)) {
+        missed++;
+        return false;
+    }
+    
+    pending.tank = tank;
+    pending.direction = up ? CHANGE_RISE : CHANGE_DROP;
+    pending.fromCenti = anchor;
+    pending.levelCenti = reading.filteredCenti;
+    pending.rateCentiPerMin = reading.rateCentiPerMin;
+    pending.timestamp = reading.timestamp;
+    hasPending.store(true, std::memory_order_release);
+    
+    #if DEBUG_SENSOR
+    DEBUG_PRINTF("Change: tank %d %s from %d.%02d%% to %d.%02d%%\n", tank + 1, up ? "rise" : "drop",
+                 anchor / 100, anchor % 100, reading.filteredCenti / 100, reading.filteredCenti % 100);
+    #endif
+    return true;
+}
+
+bool ChangeDetector::takeEvent(ChangeEvent& event) {
+    if (!hasPending.load(std::memory_order_acquire)) {
+        return false;
+    }
+    
+    event = pending;
+    hasPending.store(false, std::memory_order_release);
+    return true;
+}
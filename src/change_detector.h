@@ -0,0 +1,73 @@
+#ifndef CHANGE_DETECTOR_H
+#define CHANGE_DETECTOR_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "fixed_point.h"
+#include "level_sensor.h"
+
+enum ChangeDirection {
+    CHANGE_DROP = 0,
+    CHANGE_RISE = 1
+};
+
+// A detected change in how a tank's level moves
+struct ChangeEvent {
+    uint8_t tank;               // 0-based
+    uint8_t direction;          // ChangeDirection
+    CentiPercent fromCenti;     // Level where the deviation started
+    CentiPercent levelCenti;    // Filtered level when it fired
+    int16_t rateCentiPerMin;    // Estimated rate when it fired
+    uint32_t timestamp;
+};
+
+/**
+ * Streaming change-point detector for one tank.
+ *
+ * A two-sided CUSUM on the difference between each filtered level and the
+ * level the previous reading's trend predicted. A steady fill or drain
+ * keeps the sums at zero, however fast; a level that departs from its
+ * trend (burst pipe, stuck valve, pump start) accumulates until the
+ * deviation beyond CHANGE_SLACK adds up to CHANGE_THRESHOLD.
+ *
+ * The sensor task feeds readings; the last event is handed to the network
+ * task through a single-slot mailbox (events while it is full are counted,
+ * not queued).
+ */
+class ChangeDetector {
+public:
+    ChangeDetector();
+    
+    void reset();
+    
+    // Feed a filtered reading; true when it fired a new event
+    bool update(uint8_t tank, const SensorReading& reading);
+    
+    // Deviation is building up (worth sampling faster)
+    bool isSuspect() const { return max(sumUpQ4, sumDownQ4) >= (CHANGE_SUSPECT << 4); }
+    
+    // Consumer side: take the pending event, false if there is none
+    bool takeEvent(ChangeEvent& event);
+    
+    uint32_t getEventCount() const { return events; }
+    uint32_t getMissedCount() const { return missed; }  // Fired while the mailbox was full
+
+private:
+    bool initialized;
+    CentiPercent lastLevel;
+    int16_t lastRate;
+    uint32_t lastTimestamp;
+    
+    // CUSUM sums, Q4 0.01 % (slack per reading is a fraction of a unit)
+    int32_t sumUpQ4;
+    int32_t sumDownQ4;
+    CentiPercent anchor;        // Level where the current run of deviation began
+    
+    ChangeEvent pending;
+    std::atomic<bool> hasPending;
+    uint32_t events;
+    uint32_t missed;
+};
+
+#endif // CHANGE_DETECTOR_H
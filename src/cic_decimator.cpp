@@ -0,0 +1,58 @@
+#include "cic_decimator.h"
+
+CicDecimator::CicDecimator(uint8_t stages, uint8_t log2Ratio, uint8_t extraBits) {
+    configure(stages, log2Ratio, extraBits);
+}
+
+void CicDecimator::configure(uint8_t stages, uint8_t log2Ratio, uint8_t extraBits) {
+    if (stages < 1) stages = 1;
+    if (stages > CIC_MAX_STAGES) stages = CIC_MAX_STAGES;
+    if (log2Ratio > 8) log2Ratio = 8;
+    
+    // Cannot keep more fraction bits than the gain provides
+    uint8_t gainBits = stages * log2Ratio;
+    if (extraBits > gainBits) extraBits = gainBits;
+    
+    this->stages = stages;
+    this->log2Ratio = log2Ratio;
+    this->extraBits = extraBits;
+    reset();
+}
+
+void CicDecimator::reset() {
+    for (uint8_t i = 0; i < CIC_MAX_STAGES; i++) {
+        integrators[i] = 0;
+        combDelays[i] = 0;
+    }
+    phase = 0;
+    outputs = 0;
+}
+
+bool CicDecimator::push(int32_t sample, int32_t& output) {
+    // Integrators (unsigned so wrap-around is well defined)
+    uint32_t acc = (uint32_t)sample;
+    for (uint8_t i = 0; i < stages; i++) {
+        integrators[i] += acc;
+        acc = integrators[i];
+    }
+    
+    if (++phase < ((uint16_t)1 << log2Ratio)) {
+        return false;
+    }
+    phase = 0;
+    
+    // Combs at the decimated rate
+    for (uint8_t i = 0; i < stages; i++) {
+        uint32_t delayed = combDelays[i];
+        combDelays[i] = acc;
+        acc -= delayed;
+    }
+    
+    // Remove the gain, keeping extraBits of oversampling resolution
+    uint8_t shift = stages * log2Ratio - extraBits;
+    int32_t value = (int32_t)acc;
+    output = shift > 0 ? (value + ((int32_t)1 << (shift - 1))) >> shift : value;
+    
+    outputs++;
+    return true;
+}
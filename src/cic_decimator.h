@@ -0,0 +1,52 @@
+#ifndef CIC_DECIMATOR_H
+#define CIC_DECIMATOR_H
+
+#include <stdint.h>
+
+#define CIC_MAX_STAGES 4
+
+/**
+ * Integer CIC (cascaded integrator-comb) decimator.
+ *
+ * N integrators run at the input rate, N combs at the output rate, and
+ * the output is produced every 2^log2Ratio inputs. With one stage this is
+ * a plain boxcar average; more stages trade a longer settling time for
+ * better rejection of mains hum and pump vibration. Integrators wrap
+ * modulo 2^32 by design - the combs undo the wrap as long as the output
+ * fits, i.e. inputBits + stages * log2Ratio <= 32.
+ *
+ * The DC gain 2^(stages * log2Ratio) is removed by a shift that keeps
+ * extraBits of the oversampling gain as fraction bits, so the output is
+ * the input scale in Q(extraBits). Platform independent so synthetic
+ * sample streams can be run through it on a host.
+ */
+class CicDecimator {
+public:
+    CicDecimator(uint8_t stages = 2, uint8_t log2Ratio = 6, uint8_t extraBits = 2);
+    
+    void configure(uint8_t stages, uint8_t log2Ratio, uint8_t extraBits);
+    void reset();
+    
+    // Feed one input sample; true when an output sample is ready
+    bool push(int32_t sample, int32_t& output);
+    
+    uint8_t getStages() const { return stages; }
+    uint16_t getRatio() const { return (uint16_t)1 << log2Ratio; }
+    uint8_t getExtraBits() const { return extraBits; }
+    
+    // Outputs produced since reset (the first 'stages' are still settling)
+    uint32_t getOutputCount() const { return outputs; }
+    bool isSettled() const { return outputs > stages; }
+    
+private:
+    uint8_t stages;
+    uint8_t log2Ratio;
+    uint8_t extraBits;
+    
+    uint32_t integrators[CIC_MAX_STAGES];
+    uint32_t combDelays[CIC_MAX_STAGES];
+    uint16_t phase;
+    uint32_t outputs;
+};
+
+#endif // CIC_DECIMATOR_H
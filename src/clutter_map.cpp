@@ -0,0 +1,66 @@
+#include "clutter_map.h"
+#include "config.h"
+
+ClutterMap::ClutterMap()
+    : observations(0), learning(true), dirty(false) {
+    clear();
+    dirty = false;
+}
+
+void ClutterMap::load(const uint8_t* bitmap) {
+    memcpy(this->bitmap, bitmap, CLUTTER_MAP_BYTES);
+}
+
+void ClutterMap::save(uint8_t* bitmap) const {
+    memcpy(bitmap, this->bitmap, CLUTTER_MAP_BYTES);
+}
+
+void ClutterMap::clear() {
+    memset(bitmap, 0, sizeof(bitmap));
+    memset(hits, 0, sizeof(hits));
+    observations = 0;
+    dirty = true;
+}
+
+void ClutterMap::observe(DistanceMm distance, bool aboveSurface) {
+    if (!learning) {
+        return;
+    }
+    
+    uint16_t bin = binOf(distance);
+    if (aboveSurface && bin < CLUTTER_BINS && hits[bin] < UINT8_MAX) {
+        if (++hits[bin] == CLUTTER_LEARN_HITS && !isClutter(distance)) {
+            bitmap[bin >> 3] |= 1 << (bin & 7);
+            dirty = true;
+            
+            DEBUG_PRINTF("Clutter: learned %u-%u mm\n", 
+                         bin * CLUTTER_BIN_MM, (bin + 1) * CLUTTER_BIN_MM);
+        }
+    }
+    
+    // Halve the histogram regularly so scattered noise never adds up
+    if (++observations >= CLUTTER_DECAY_SAMPLES) {
+        observations = 0;
+        for (uint16_t i = 0; i < CLUTTER_BINS; i++) {
+            hits[i] >>= 1;
+        }
+    }
+}
+
+bool ClutterMap::isClutter(DistanceMm distance) const {
+    uint16_t bin = binOf(distance);
+    if (bin >= CLUTTER_BINS) {
+        return false;
+    }
+    return (bitmap[bin >> 3] >> (bin & 7)) & 0x01;
+}
+
+uint16_t ClutterMap::getBinCount() const {
+    uint16_t count = 0;
+    for (uint8_t i = 0; i < CLUTTER_MAP_BYTES; i++) {
+        for (uint8_t b = bitmap[i]; b; b &= b - 1) {
+            count++;
+        }
+    }
+    return count;
+}
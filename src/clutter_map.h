@@ -0,0 +1,54 @@
+#ifndef CLUTTER_MAP_H
+#define CLUTTER_MAP_H
+
+#include <Arduino.h>
+#include "fixed_point.h"
+
+// Map resolution and extent (CLUTTER_BINS * CLUTTER_BIN_MM covers the sensor range)
+#define CLUTTER_BIN_MM      20
+#define CLUTTER_BINS        256
+#define CLUTTER_MAP_BYTES   (CLUTTER_BINS / 8)
+
+/**
+ * Per-sensor map of distances that return fixed false echoes (walls,
+ * ladders, inlet pipes).
+ *
+ * Echoes landing well above the current surface estimate are counted in
+ * a decaying histogram; a bin that keeps collecting them is flagged as
+ * clutter. Only returns closer than the surface are ever learned or
+ * rejected, so a map can never hide the real surface below a fitting.
+ * The flags are a 32-byte bitmap stored with the tank calibration.
+ */
+class ClutterMap {
+public:
+    ClutterMap();
+    
+    // Bitmap persistence
+    void load(const uint8_t* bitmap);
+    void save(uint8_t* bitmap) const;
+    void clear();
+    
+    // Learning from the long-run distance histogram
+    void setLearning(bool enabled) { learning = enabled; }
+    bool isLearning() const { return learning; }
+    void observe(DistanceMm distance, bool aboveSurface);
+    
+    // Lookup
+    bool isClutter(DistanceMm distance) const;
+    uint16_t getBinCount() const;
+    
+    // Set when a bin was learned and the map should be persisted
+    bool isDirty() const { return dirty; }
+    void clearDirty() { dirty = false; }
+    
+private:
+    uint8_t bitmap[CLUTTER_MAP_BYTES];
+    uint8_t hits[CLUTTER_BINS];     // Off-surface returns per bin (decaying)
+    uint16_t observations;
+    bool learning;
+    bool dirty;
+    
+    static uint16_t binOf(DistanceMm distance) { return distance / CLUTTER_BIN_MM; }
+};
+
+#endif // CLUTTER_MAP_H
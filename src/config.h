@@ -49,6 +49,13 @@
     #define DEFAULT_TRIG_PIN_2      13    // D7
     #define DEFAULT_ECHO_PIN_2      15    // D8
     
+    // Pressure transducer (single ADC: tank 1 only)
+    #define DEFAULT_PRESSURE_PIN_1  A0
+    #define DEFAULT_PRESSURE_PIN_2  255   // None
+    
+    // Tank registry capacity (RAM is tight; only two sensor pin pairs are free)
+    #define MAX_TANKS               2
+    
     // OLED Display (I2C)
     #define OLED_SDA_PIN            4     // D2 (default I2C SDA)
     #define OLED_SCL_PIN            5     // D1 (default I2C SCL)
@@ -62,7 +69,7 @@
     
     // Status LED
     #define STATUS_LED_PIN          2     // D4 (built-in LED)
-    
+
 #elif defined(BOARD_ESP32_S2)
     // ESP32-S2 specific pins (avoiding strapping pins)
     // Tank 1 Ultrasonic Sensor (JSN-SR04T)
@@ -73,6 +80,13 @@
     #define DEFAULT_TRIG_PIN_2      12
     #define DEFAULT_ECHO_PIN_2      13
     
+    // Pressure transducers (ADC1 - ADC2 is unavailable while WiFi is on)
+    #define DEFAULT_PRESSURE_PIN_1  3
+    #define DEFAULT_PRESSURE_PIN_2  4
+    
+    // Tank registry capacity
+    #define MAX_TANKS               4
+    
     // OLED Display (I2C)
     #define OLED_SDA_PIN            8
     #define OLED_SCL_PIN            9
@@ -86,7 +100,7 @@
     
     // Status LED
     #define STATUS_LED_PIN          15    // Built-in LED on ESP32-S2
-    
+
 #else
     // ESP32 Classic pins
     // Tank 1 Ultrasonic Sensor (JSN-SR04T)
@@ -97,6 +111,13 @@
     #define DEFAULT_TRIG_PIN_2      32
     #define DEFAULT_ECHO_PIN_2      33
     
+    // Pressure transducers (ADC1 input-only pins - ADC2 is unavailable while WiFi is on)
+    #define DEFAULT_PRESSURE_PIN_1  34
+    #define DEFAULT_PRESSURE_PIN_2  35
+    
+    // Tank registry capacity (tanks 3+ have no default pins)
+    #define MAX_TANKS               8
+    
     // OLED Display (I2C)
     #define OLED_SDA_PIN            21
     #define OLED_SCL_PIN            22
@@ -115,18 +136,109 @@
 // ============================================================================
 // SENSOR CONFIGURATION
 // ============================================================================
-#define SENSOR_TIMEOUT_US       30000  // 30ms timeout for ultrasonic sensor
-#define SENSOR_SAMPLES          5      // Number of samples for median filter
+#define SENSOR_TIMEOUT_US       30000  // Upper bound on the echo window (~5 m round trip)
+#define SENSOR_RANGE_MARGIN_MM  300    // Listening range beyond the calibrated empty distance
+#define SENSOR_ECHO_LATENCY_US  1000   // Trigger to echo-pin rise (transmit burst)
+#define SENSOR_MODULE_TIMEOUT_US 60000 // Longest the module holds the echo pin when nothing returns
+#define SENSOR_SAMPLES          1      // Pings per reading (filter window persists across readings)
+#define SENSOR_MAX_SAMPLES      10     // Upper bound on pings in one burst
+#define SENSOR_CONSENSUS_K      3      // Recent samples that must agree to end a burst (0 = off)
+#define SENSOR_CONSENSUS_MAX_K  8
+#define SENSOR_CONSENSUS_TOL_MM 10     // Agreement band for consensus sampling
+#define SENSOR_CONSENSUS_MAX_PINGS 6   // Burst cap while samples disagree
+
+// Clutter map (fixed false echoes from fittings above the surface)
+#define CLUTTER_GUARD_MM        100    // Returns this far above the surface are off-surface
+#define CLUTTER_LEARN_HITS      20     // Off-surface hits that flag a bin as clutter
+#define CLUTTER_DECAY_SAMPLES   500    // Histogram halves after this many samples
+#define CLUTTER_MAX_REJECTS     8      // Consecutive clutter hits accepted as the surface
+#define SENSOR_FILTER_WINDOW    5      // Sliding median window (samples)
+#define SENSOR_FILTER_MIN_FILL  3      // Samples needed before a reading is valid
+#define SENSOR_HAMPEL_K         3.0    // Outlier threshold in scaled MADs
+#define SENSOR_HAMPEL_MIN_MM    5      // Floor for the scaled MAD (calm water)
+
+// Filling profile: the surface rises while inflow splashes it. A shorter
+// window keeps up with the rise (a longer median lags the ramp by more than
+// the splashes cost) and a wider MAD floor accepts the ripple on the way up
+// while splash echoes, hundreds of mm off, are still rejected
+#define FILL_FILTER_WINDOW      4      // Sliding median window while filling (samples)
+#define FILL_HAMPEL_K           3.0
+#define FILL_HAMPEL_MIN_MM      12     // Splash ripple is never below this
+#define FILL_PROFILE_HOLD_MS    30000  // Kept after inflow ends while the surface settles
+#define FILL_DETECT_RATE        50     // Rise (0.01 %/min) treated as inflow without the pump
+#define SENSOR_SETTLE_MS        10     // Ring-down time between pings of one sensor
+#define SENSOR_CROSSTALK_GUARD_MS 5    // Offset between triggers of different sensors
 #define SENSOR_READ_INTERVAL    5000   // Sensor reading interval in ms
-#define SPEED_OF_SOUND          0.0343 // Speed of sound in cm/μs (at 20°C)
+#define SENSOR_MIN_INTERVAL     1000   // Adaptive sampling floor (pump on / fast change)
+#define SENSOR_MAX_INTERVAL     60000  // Adaptive sampling ceiling (flat level)
+#define SAMPLING_FAST_RATE      0.5    // |rate| in %/min that selects the floor
+#define SAMPLING_FLAT_RATE      0.05   // |rate| in %/min treated as flat
+#define DEFAULT_AIR_TEMPERATURE_C 20.0  // Used for speed of sound when no probe is fitted
+
+// JSN-SR04T serial output (trig wire = module RX, echo wire = module TX)
+#define DEFAULT_SENSOR_DRIVER   0      // SensorDriver: 0 pulse, 1 UART auto, 2 UART controlled
+#define JSN_UART_BAUD           9600
+#define JSN_UART_TRIGGER        0x55   // Measurement request in controlled mode
+#define JSN_UART_TIMEOUT_MS     150    // Longest wait for a frame (auto mode streams every ~100 ms)
+#define JSN_UART_FIRST          1      // First ESP32 hardware UART for serial sensors, further ones take the next (ESP8266 uses software serial)
+
+// Hydrostatic pressure transducer (4-20 mA into a shunt, or 0.5-4.5 V through a divider)
+#define PRESSURE_ADC_PERIOD_MS  2      // Continuous ADC sampling period
+#define PRESSURE_CIC_STAGES     2      // Decimator order (1 = boxcar average)
+#define PRESSURE_CIC_LOG2_RATIO 5      // Decimate by 32 (one output per 64 ms)
+#define PRESSURE_OVERSAMPLE_BITS 2     // Extra resolution kept from oversampling
+#define PRESSURE_FAULT_MARGIN_MV 200   // Below zero by this much: open loop / unplugged
+#define PRESSURE_ADC_FULL_SCALE_MV 3200 // ESP8266 A0 full scale (D1 mini divider)
+#define DEFAULT_PRESSURE_ZERO_MV 600   // Pin voltage at zero head (4 mA into 150 Ω)
+#define DEFAULT_PRESSURE_FULL_MV 3000  // Pin voltage at full scale (20 mA into 150 Ω)
+#define DEFAULT_PRESSURE_RANGE_MM 5000 // Water head at full scale (0.5 bar ≈ 5 m)
+
+// Redundant sensors on one tank, fused into a single level
+#define MAX_TANK_SENSORS        2      // Primary + redundant sensors per tank
+#define FUSION_EWMA_SHIFT       3      // Noise / bias / error-rate smoothing (1/8 per reading)
+#define FUSION_VAR_FLOOR        100    // Noise floor, centi-percent² (σ 0.1%); quieter inputs are not favoured further
+#define FUSION_INITIAL_VAR      2500   // Assumed noise until learned (σ 0.5%)
+
+// Raw echo diagnostic stream (installer view over a web socket)
+#define DIAG_PING_INTERVAL_MS   50     // 20 Hz while streaming; the normal pipeline pauses
+#define DIAG_DEFAULT_SECONDS    60     // Stream length when none is requested
+#define DIAG_MAX_SECONDS        300    // Auto-expiry cap
+#define DIAG_RING_SIZE          64     // Pings buffered between frames (power of two)
+#define DIAG_FRAME_MAX_PINGS    32     // Pings per web socket frame
+
+// Level estimator (constant-velocity Kalman filter per tank)
+#define KALMAN_PROCESS_NOISE    1e-6   // Rate random walk, %²/s³
+#define KALMAN_MEASUREMENT_NOISE 0.25  // Level measurement variance, %² (σ = 0.5%)
+#define KALMAN_INITIAL_RATE_VAR 0.01   // Initial rate variance, (%/s)²
+#define KALMAN_RESET_SIGMA      6.0    // Re-initialize on innovations beyond this
+
+// Change-point detection on the filtered level (two-sided CUSUM against the trend)
+#define CHANGE_SLACK            30     // Trend deviation ignored, 0.01 %/min
+#define CHANGE_THRESHOLD        60     // Accumulated deviation that fires an event, 0.01 %
+#define CHANGE_SUSPECT          20     // Accumulated deviation that shortens the sampling interval
 
 // ============================================================================
 // DEFAULT TANK CALIBRATION (User configurable via web interface)
 // ============================================================================
-#define DEFAULT_TANK1_EMPTY_CM  200.0  // Distance when tank is empty (sensor to bottom)
-#define DEFAULT_TANK1_FULL_CM   10.0   // Distance when tank is full (sensor to water surface)
-#define DEFAULT_TANK2_EMPTY_CM  200.0
-#define DEFAULT_TANK2_FULL_CM   10.0
+#define DEFAULT_TANK_EMPTY_CM   200.0  // Distance when tank is empty (sensor to bottom)
+#define DEFAULT_TANK_FULL_CM    10.0   // Distance when tank is full (sensor to water surface)
+#define DEFAULT_TANK_COUNT      1
+
+// Tank geometry (0 = vertical prismatic; diameter 0 = unknown, percent only)
+#define DEFAULT_TANK_SHAPE      0
+#define DEFAULT_TANK_DIAMETER_CM 0.0
+#define DEFAULT_TANK_LENGTH_CM  0.0
+#define DEFAULT_TANK_CONE_CM    0.0
+
+// Auto-calibration from observed extremes (0 = off, 1 = propose, 2 = apply)
+#define DEFAULT_AUTOCAL_MODE    0
+#define AUTOCAL_BIN_MM          10     // Distance histogram resolution
+#define AUTOCAL_TAIL_PERMILLE   10     // Robust extremes: 1st / 99th percentile
+#define AUTOCAL_MIN_READINGS    500    // Readings before anything is proposed
+#define AUTOCAL_MIN_BEYOND      100    // Readings past a bound for full confidence
+#define AUTOCAL_MARGIN_MM       20     // Extremes within this of a bound are ignored
+#define AUTOCAL_APPLY_CONFIDENCE 80    // Minimum confidence (%) to apply a bound
+#define CONFIG_SAVE_MIN_INTERVAL_MS 600000  // Runtime-learned settings: at most one save per 10 min
 
 // ============================================================================
 // WIFI & CAPTIVE PORTAL
@@ -149,14 +261,16 @@
 #define DEFAULT_MQTT_TOPIC      "water/level"
 #define DEFAULT_MQTT_CMD_TOPIC  "water/command"
 #define MQTT_RECONNECT_INTERVAL 5000                // 5 seconds
-#define MQTT_PUBLISH_INTERVAL   10000               // 10 seconds
+#define MQTT_PUBLISH_INTERVAL   60000               // 60 seconds (level changes are published at once)
+#define MQTT_PAYLOAD_SIZE       (160 + MAX_TANKS * (224 + MAX_TANK_SENSORS * 96)) // Sensor payload grows with tanks and fused sensors
 
 // ============================================================================
 // BLE CONFIGURATION
 // ============================================================================
 #define BLE_SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
-#define BLE_TANK1_CHAR_UUID     "beb5483e-36e1-4688-b7f5-ea07361b26a8"
-#define BLE_TANK2_CHAR_UUID     "beb5483e-36e1-4688-b7f5-ea07361b26a9"
+#define BLE_TANK_CHAR_UUID_PREFIX "beb5483e-36e1-4688-b7f5-ea07361b"  // + 4 hex digits per tank
+#define BLE_TANK1_CHAR_SUFFIX   0x26a8  // Tanks 1-2: 26a8, 26a9
+#define BLE_TANK3_CHAR_SUFFIX   0x26b0  // Tanks 3+: 26b0, 26b1, ...
 #define BLE_PUMP_CHAR_UUID      "beb5483e-36e1-4688-b7f5-ea07361b26aa"
 #define BLE_CONFIG_CHAR_UUID    "beb5483e-36e1-4688-b7f5-ea07361b26ab"
 
@@ -176,6 +290,27 @@
 #define PUMP_AUTO_ON_THRESHOLD  20.0                // Auto-start pump at 20% level
 #define PUMP_AUTO_OFF_THRESHOLD 90.0                // Auto-stop pump at 90% level
 #define PUMP_DRY_RUN_THRESHOLD  5.0                 // Stop if source tank below 5%
+#define PUMP_TARGET_TANK        0                   // Tank the pump fills (registry index)
+#define PUMP_SOURCE_TANK        1                   // Tank the pump draws from, if configured
+
+// Predictive auto-off: stop early when the level would pass the OFF threshold
+// before the next reading, projected from the fill rate and the stop latency
+#define DEFAULT_PUMP_PREDICTIVE false
+#define PUMP_PREDICT_LATENCY_MS 3000                // Initial sensing + actuation latency
+#define PUMP_PREDICT_LATENCY_MAX_MS 60000
+#define PUMP_PREDICT_MIN_RATE   10                  // Slower fills (0.01 %/min) are not extrapolated
+#define PUMP_PREDICT_SETTLE_MS  30000               // Level watched after a stop for the actual peak
+#define PUMP_STOP_LOG_SIZE      8                   // Level stops kept for review
+
+// Dry-run detection: the target level must rise this much within the window
+// while the pump runs (any mode), or it is stopped as running dry
+#define DEFAULT_PUMP_STALL_RISE 1.0                 // % level
+#define DEFAULT_PUMP_STALL_WINDOW 0                 // ms, 0 = off (size it from the tank and pump)
+
+// Scheduled mode: level control only inside weekly windows (local time)
+#define PUMP_SCHEDULE_MAX_WINDOWS 14                // Two a day
+#define PUMP_SCHEDULE_RECHECK_MS 3600000            // Longest sleep before a window edge (clock corrections)
+#define PUMP_SCHEDULE_RETRY_MS  60000               // Window check while the clock is not set
 
 // ============================================================================
 // TASK PRIORITIES & STACK SIZES (FreeRTOS)
@@ -188,6 +323,11 @@
 #define NETWORK_TASK_STACK      8192
 #define WEB_TASK_PRIORITY       1
 #define WEB_TASK_STACK          8192
+#define PUMP_TASK_PRIORITY      3                   // Owner of the pump; above the tasks posting to it
+#define PUMP_TASK_STACK         3072
+#define PUMP_TASK_IDLE_MS       1000                // Queue check without a notification
+#define PUMP_QUEUE_SIZE         16                  // Pump commands in flight (power of two)
+#define PUMP_ACK_RING_SIZE      16                  // Outcomes kept for lookup by ticket (power of two)
 
 // ============================================================================
 // OTA CONFIGURATION
@@ -195,6 +335,13 @@
 #define OTA_HOSTNAME            "waterlevel-monitor"
 #define OTA_PASSWORD            "admin123"          // Change this!
 
+// ============================================================================
+// TIME (NTP)
+// ============================================================================
+#define NTP_SERVER              "pool.ntp.org"
+#define DEFAULT_TIME_ZONE       "UTC0"              // POSIX TZ, e.g. "CET-1CEST,M3.5.0,M10.5.0/3"
+#define CLOCK_VALID_EPOCH       1600000000          // Anything earlier is an unset clock
+
 // ============================================================================
 // WATCHDOG TIMER
 // ============================================================================
@@ -5,8 +5,8 @@
     #include <esp_system.h>
 #endif
 
-ConfigManager::ConfigManager() {
-    // Constructor
+ConfigManager::ConfigManager()
+    : savePending(false), lastSaveTime(0), saveCount(0), coalescedSaves(0) {
 }
 
 bool ConfigManager::begin() {
@@ -53,15 +53,44 @@ bool ConfigManager::loadConfig() {
     #else
         DEBUG_PRINTLN("Loading configuration from NVS...");
         
-        // Tank configuration
-        config.tankMode = (TankMode)preferences.getUChar("tankMode", SINGLE_TANK);
+        // Tank configuration (older firmware stored single/dual as "tankMode")
+        uint8_t legacyCount = preferences.getUChar("tankMode", 0) + 1;
+        config.tankCount = constrain(preferences.getUChar("tankCount", legacyCount), 1, MAX_TANKS);
         config.unitSystem = (UnitSystem)preferences.getUChar("unitSystem", METRIC_CM);
-        config.tank1EmptyCm = preferences.getFloat("t1Empty", DEFAULT_TANK1_EMPTY_CM);
-        config.tank1FullCm = preferences.getFloat("t1Full", DEFAULT_TANK1_FULL_CM);
-        config.tank2EmptyCm = preferences.getFloat("t2Empty", DEFAULT_TANK2_EMPTY_CM);
-        config.tank2FullCm = preferences.getFloat("t2Full", DEFAULT_TANK2_FULL_CM);
-        preferences.getString("t1Name", config.tank1Name, sizeof(config.tank1Name));
-        preferences.getString("t2Name", config.tank2Name, sizeof(config.tank2Name));
+        config.autoCalMode = preferences.getUChar("autoCal", DEFAULT_AUTOCAL_MODE);
+        
+        char key[CONFIG_KEY_SIZE];
+        for (uint8_t i = 0; i < MAX_TANKS; i++) {
+            TankConfig& tank = config.tanks[i];
+            resetTankDefaults(i);
+            
+            tank.emptyCm = preferences.getFloat(tankKey(key, i, "t%uEmpty"), tank.emptyCm);
+            tank.fullCm = preferences.getFloat(tankKey(key, i, "t%uFull"), tank.fullCm);
+            preferences.getString(tankKey(key, i, "t%uName"), tank.name, sizeof(tank.name));
+            tank.driver = preferences.getUChar(tankKey(key, i, "t%uDriver"), tank.driver);
+            tank.trigPin = preferences.getUChar(tankKey(key, i, "trigPin%u"), tank.trigPin);
+            tank.echoPin = preferences.getUChar(tankKey(key, i, "echoPin%u"), tank.echoPin);
+            tank.pressurePin = preferences.getUChar(tankKey(key, i, "t%uPPin"), tank.pressurePin);
+            tank.geometry.shape = preferences.getUChar(tankKey(key, i, "t%uShape"), tank.geometry.shape);
+            tank.geometry.diameterCm = preferences.getFloat(tankKey(key, i, "t%uDiam"), tank.geometry.diameterCm);
+            tank.geometry.lengthCm = preferences.getFloat(tankKey(key, i, "t%uLen"), tank.geometry.lengthCm);
+            tank.geometry.coneHeightCm = preferences.getFloat(tankKey(key, i, "t%uCone"), tank.geometry.coneHeightCm);
+            tank.pressure.zeroMv = preferences.getUShort(tankKey(key, i, "t%uPZero"), tank.pressure.zeroMv);
+            tank.pressure.fullScaleMv = preferences.getUShort(tankKey(key, i, "t%uPFull"), tank.pressure.fullScaleMv);
+            tank.pressure.rangeMm = preferences.getUShort(tankKey(key, i, "t%uPRange"), tank.pressure.rangeMm);
+            preferences.getBytes(tankKey(key, i, "t%uClutter"), tank.clutter, CLUTTER_MAP_BYTES);
+            
+            for (uint8_t s = 1; s < MAX_TANK_SENSORS; s++) {
+                TankSensorConfig& sensor = tank.redundant[s - 1];
+                sensor.driver = preferences.getUChar(sensorKey(key, i, s, "t%uS%uDrv"), sensor.driver);
+                sensor.trigPin = preferences.getUChar(sensorKey(key, i, s, "t%uS%uTrig"), sensor.trigPin);
+                sensor.echoPin = preferences.getUChar(sensorKey(key, i, s, "t%uS%uEcho"), sensor.echoPin);
+                sensor.pressurePin = preferences.getUChar(sensorKey(key, i, s, "t%uS%uPPin"), sensor.pressurePin);
+                sensor.emptyCm = preferences.getFloat(sensorKey(key, i, s, "t%uS%uEmpty"), sensor.emptyCm);
+                sensor.fullCm = preferences.getFloat(sensorKey(key, i, s, "t%uS%uFull"), sensor.fullCm);
+                preferences.getBytes(sensorKey(key, i, s, "t%uS%uClut"), sensor.clutter, CLUTTER_MAP_BYTES);
+            }
+        }
     
     // WiFi configuration
     preferences.getString("wifiSSID", config.wifiSSID, sizeof(config.wifiSSID));
@@ -77,11 +106,16 @@ bool ConfigManager::loadConfig() {
     config.mqttPublishInterval = preferences.getUInt("mqttInterval", MQTT_PUBLISH_INTERVAL);
     
     // Sensor configuration
-    config.trigPin1 = preferences.getUChar("trigPin1", DEFAULT_TRIG_PIN_1);
-    config.echoPin1 = preferences.getUChar("echoPin1", DEFAULT_ECHO_PIN_1);
-    config.trigPin2 = preferences.getUChar("trigPin2", DEFAULT_TRIG_PIN_2);
-    config.echoPin2 = preferences.getUChar("echoPin2", DEFAULT_ECHO_PIN_2);
     config.sensorReadInterval = preferences.getUInt("sensorInt", SENSOR_READ_INTERVAL);
+    config.sensorMinInterval = preferences.getUInt("sensorMinInt", SENSOR_MIN_INTERVAL);
+    config.sensorMaxInterval = preferences.getUInt("sensorMaxInt", SENSOR_MAX_INTERVAL);
+    config.sensorGuardMs = preferences.getUShort("sensorGuard", SENSOR_CROSSTALK_GUARD_MS);
+    config.sensorConsensusK = preferences.getUChar("consK", SENSOR_CONSENSUS_K);
+    config.sensorConsensusTolMm = preferences.getUShort("consTol", SENSOR_CONSENSUS_TOL_MM);
+    config.sensorConsensusMaxPings = preferences.getUChar("consMax", SENSOR_CONSENSUS_MAX_PINGS);
+    config.kalmanProcessNoise = preferences.getFloat("kalmanQ", KALMAN_PROCESS_NOISE);
+    config.kalmanMeasurementNoise = preferences.getFloat("kalmanR", KALMAN_MEASUREMENT_NOISE);
+    config.airTemperatureC = preferences.getFloat("airTemp", DEFAULT_AIR_TEMPERATURE_C);
     
     // Pump configuration
     config.pumpRelayPin = preferences.getUChar("pumpPin", DEFAULT_PUMP_RELAY_PIN);
@@ -90,6 +124,15 @@ bool ConfigManager::loadConfig() {
     config.pumpAutoOffThreshold = preferences.getFloat("pumpOffThr", PUMP_AUTO_OFF_THRESHOLD);
     config.pumpMaxRunTime = preferences.getUInt("pumpMaxTime", PUMP_MAX_RUN_TIME);
     config.pumpCooldownTime = preferences.getUInt("pumpCool", PUMP_COOLDOWN_TIME);
+    config.pumpPredictiveStop = preferences.getBool("pumpPredict", DEFAULT_PUMP_PREDICTIVE);
+    config.pumpStallRise = preferences.getFloat("pumpStallRise", DEFAULT_PUMP_STALL_RISE);
+    config.pumpStallWindow = preferences.getUInt("pumpStallWin", DEFAULT_PUMP_STALL_WINDOW);
+    config.pumpWindowCount = min((uint8_t)PUMP_SCHEDULE_MAX_WINDOWS, preferences.getUChar("pumpWinCnt", 0));
+    preferences.getBytes("pumpWindows", config.pumpWindows, sizeof(config.pumpWindows));
+    preferences.getString("timeZone", config.timeZone, sizeof(config.timeZone));
+    if (strlen(config.timeZone) == 0) {
+        strcpy(config.timeZone, DEFAULT_TIME_ZONE);
+    }
     
     // Display configuration
     config.displayEnabled = preferences.getBool("dispEnabled", true);
@@ -109,20 +152,52 @@ bool ConfigManager::loadConfig() {
 }
 
 bool ConfigManager::saveConfig() {
+    // Any save also satisfies a pending deferred one
+    savePending = false;
+    lastSaveTime = millis();
+    saveCount++;
+    
     #ifdef ESP8266
         return saveToLittleFS();
     #else
         DEBUG_PRINTLN("Saving configuration to NVS...");
         
-        // Tank configuration
-        preferences.putUChar("tankMode", config.tankMode);
-    preferences.putUChar("unitSystem", config.unitSystem);
-    preferences.putFloat("t1Empty", config.tank1EmptyCm);
-    preferences.putFloat("t1Full", config.tank1FullCm);
-    preferences.putFloat("t2Empty", config.tank2EmptyCm);
-    preferences.putFloat("t2Full", config.tank2FullCm);
-    preferences.putString("t1Name", config.tank1Name);
-    preferences.putString("t2Name", config.tank2Name);
+        // Tank configuration (every slot, so a lowered count keeps its settings)
+        preferences.putUChar("tankCount", config.tankCount);
+        preferences.putUChar("unitSystem", config.unitSystem);
+        preferences.putUChar("autoCal", config.autoCalMode);
+        
+        char key[CONFIG_KEY_SIZE];
+        for (uint8_t i = 0; i < MAX_TANKS; i++) {
+            const TankConfig& tank = config.tanks[i];
+            
+            preferences.putFloat(tankKey(key, i, "t%uEmpty"), tank.emptyCm);
+            preferences.putFloat(tankKey(key, i, "t%uFull"), tank.fullCm);
+            preferences.putString(tankKey(key, i, "t%uName"), tank.name);
+            preferences.putUChar(tankKey(key, i, "t%uDriver"), tank.driver);
+            preferences.putUChar(tankKey(key, i, "trigPin%u"), tank.trigPin);
+            preferences.putUChar(tankKey(key, i, "echoPin%u"), tank.echoPin);
+            preferences.putUChar(tankKey(key, i, "t%uPPin"), tank.pressurePin);
+            preferences.putUChar(tankKey(key, i, "t%uShape"), tank.geometry.shape);
+            preferences.putFloat(tankKey(key, i, "t%uDiam"), tank.geometry.diameterCm);
+            preferences.putFloat(tankKey(key, i, "t%uLen"), tank.geometry.lengthCm);
+            preferences.putFloat(tankKey(key, i, "t%uCone"), tank.geometry.coneHeightCm);
+            preferences.putUShort(tankKey(key, i, "t%uPZero"), tank.pressure.zeroMv);
+            preferences.putUShort(tankKey(key, i, "t%uPFull"), tank.pressure.fullScaleMv);
+            preferences.putUShort(tankKey(key, i, "t%uPRange"), tank.pressure.rangeMm);
+            preferences.putBytes(tankKey(key, i, "t%uClutter"), tank.clutter, CLUTTER_MAP_BYTES);
+            
+            for (uint8_t s = 1; s < MAX_TANK_SENSORS; s++) {
+                const TankSensorConfig& sensor = tank.redundant[s - 1];
+                preferences.putUChar(sensorKey(key, i, s, "t%uS%uDrv"), sensor.driver);
+                preferences.putUChar(sensorKey(key, i, s, "t%uS%uTrig"), sensor.trigPin);
+                preferences.putUChar(sensorKey(key, i, s, "t%uS%uEcho"), sensor.echoPin);
+                preferences.putUChar(sensorKey(key, i, s, "t%uS%uPPin"), sensor.pressurePin);
+                preferences.putFloat(sensorKey(key, i, s, "t%uS%uEmpty"), sensor.emptyCm);
+                preferences.putFloat(sensorKey(key, i, s, "t%uS%uFull"), sensor.fullCm);
+                preferences.putBytes(sensorKey(key, i, s, "t%uS%uClut"), sensor.clutter, CLUTTER_MAP_BYTES);
+            }
+        }
     
     // WiFi configuration
     preferences.putString("wifiSSID", config.wifiSSID);
@@ -138,11 +213,16 @@ bool ConfigManager::saveConfig() {
     preferences.putUInt("mqttInterval", config.mqttPublishInterval);
     
     // Sensor configuration
-    preferences.putUChar("trigPin1", config.trigPin1);
-    preferences.putUChar("echoPin1", config.echoPin1);
-    preferences.putUChar("trigPin2", config.trigPin2);
-    preferences.putUChar("echoPin2", config.echoPin2);
     preferences.putUInt("sensorInt", config.sensorReadInterval);
+    preferences.putUInt("sensorMinInt", config.sensorMinInterval);
+    preferences.putUInt("sensorMaxInt", config.sensorMaxInterval);
+    preferences.putUShort("sensorGuard", config.sensorGuardMs);
+    preferences.putUChar("consK", config.sensorConsensusK);
+    preferences.putUShort("consTol", config.sensorConsensusTolMm);
+    preferences.putUChar("consMax", config.sensorConsensusMaxPings);
+    preferences.putFloat("kalmanQ", config.kalmanProcessNoise);
+    preferences.putFloat("kalmanR", config.kalmanMeasurementNoise);
+    preferences.putFloat("airTemp", config.airTemperatureC);
     
     // Pump configuration
     preferences.putUChar("pumpPin", config.pumpRelayPin);
@@ -151,6 +231,12 @@ bool ConfigManager::saveConfig() {
     preferences.putFloat("pumpOffThr", config.pumpAutoOffThreshold);
     preferences.putUInt("pumpMaxTime", config.pumpMaxRunTime);
     preferences.putUInt("pumpCool", config.pumpCooldownTime);
+    preferences.putBool("pumpPredict", config.pumpPredictiveStop);
+    preferences.putFloat("pumpStallRise", config.pumpStallRise);
+    preferences.putUInt("pumpStallWin", config.pumpStallWindow);
+    preferences.putUChar("pumpWinCnt", config.pumpWindowCount);
+    preferences.putBytes("pumpWindows", config.pumpWindows, sizeof(config.pumpWindows));
+    preferences.putString("timeZone", config.timeZone);
     
     // Display configuration
     preferences.putBool("dispEnabled", config.displayEnabled);
@@ -172,14 +258,12 @@ void ConfigManager::resetToDefaults() {
     DEBUG_PRINTLN("Resetting to factory defaults...");
     
     // Tank defaults
-    config.tankMode = SINGLE_TANK;
+    config.tankCount = DEFAULT_TANK_COUNT;
     config.unitSystem = METRIC_CM;
-    config.tank1EmptyCm = DEFAULT_TANK1_EMPTY_CM;
-    config.tank1FullCm = DEFAULT_TANK1_FULL_CM;
-    config.tank2EmptyCm = DEFAULT_TANK2_EMPTY_CM;
-    config.tank2FullCm = DEFAULT_TANK2_FULL_CM;
-    strcpy(config.tank1Name, "Tank 1");
-    strcpy(config.tank2Name, "Tank 2");
+    config.autoCalMode = DEFAULT_AUTOCAL_MODE;
+    for (uint8_t i = 0; i < MAX_TANKS; i++) {
+        resetTankDefaults(i);
+    }
     
     // WiFi defaults (empty - will trigger AP mode)
     memset(config.wifiSSID, 0, sizeof(config.wifiSSID));
@@ -195,11 +279,16 @@ void ConfigManager::resetToDefaults() {
     config.mqttPublishInterval = MQTT_PUBLISH_INTERVAL;
     
     // Sensor defaults
-    config.trigPin1 = DEFAULT_TRIG_PIN_1;
-    config.echoPin1 = DEFAULT_ECHO_PIN_1;
-    config.trigPin2 = DEFAULT_TRIG_PIN_2;
-    config.echoPin2 = DEFAULT_ECHO_PIN_2;
     config.sensorReadInterval = SENSOR_READ_INTERVAL;
+    config.sensorMinInterval = SENSOR_MIN_INTERVAL;
+    config.sensorMaxInterval = SENSOR_MAX_INTERVAL;
+    config.sensorGuardMs = SENSOR_CROSSTALK_GUARD_MS;
+    config.sensorConsensusK = SENSOR_CONSENSUS_K;
+    config.sensorConsensusTolMm = SENSOR_CONSENSUS_TOL_MM;
+    config.sensorConsensusMaxPings = SENSOR_CONSENSUS_MAX_PINGS;
+    config.kalmanProcessNoise = KALMAN_PROCESS_NOISE;
+    config.kalmanMeasurementNoise = KALMAN_MEASUREMENT_NOISE;
+    config.airTemperatureC = DEFAULT_AIR_TEMPERATURE_C;
     
     // Pump defaults
     config.pumpRelayPin = DEFAULT_PUMP_RELAY_PIN;
@@ -208,6 +297,12 @@ void ConfigManager::resetToDefaults() {
     config.pumpAutoOffThreshold = PUMP_AUTO_OFF_THRESHOLD;
     config.pumpMaxRunTime = PUMP_MAX_RUN_TIME;
     config.pumpCooldownTime = PUMP_COOLDOWN_TIME;
+    config.pumpPredictiveStop = DEFAULT_PUMP_PREDICTIVE;
+    config.pumpStallRise = DEFAULT_PUMP_STALL_RISE;
+    config.pumpStallWindow = DEFAULT_PUMP_STALL_WINDOW;
+    memset(config.pumpWindows, 0, sizeof(config.pumpWindows));
+    config.pumpWindowCount = 0;
+    strcpy(config.timeZone, DEFAULT_TIME_ZONE);
     
     // Display defaults
     config.displayEnabled = true;
@@ -219,6 +314,54 @@ void ConfigManager::resetToDefaults() {
     config.isConfigured = false;
 }
 
+void ConfigManager::resetTankDefaults(uint8_t index) {
+    TankConfig& tank = config.tanks[index];
+    
+    snprintf(tank.name, sizeof(tank.name), "Tank %d", index + 1);
+    tank.emptyCm = DEFAULT_TANK_EMPTY_CM;
+    tank.fullCm = DEFAULT_TANK_FULL_CM;
+    tank.driver = DEFAULT_SENSOR_DRIVER;
+    
+    // Only the first two tanks have board default pins
+    static const uint8_t trigPins[] = {DEFAULT_TRIG_PIN_1, DEFAULT_TRIG_PIN_2};
+    static const uint8_t echoPins[] = {DEFAULT_ECHO_PIN_1, DEFAULT_ECHO_PIN_2};
+    static const uint8_t pressurePins[] = {DEFAULT_PRESSURE_PIN_1, DEFAULT_PRESSURE_PIN_2};
+    tank.trigPin = index < 2 ? trigPins[index] : 255;
+    tank.echoPin = index < 2 ? echoPins[index] : 255;
+    tank.pressurePin = index < 2 ? pressurePins[index] : 255;
+    
+    tank.geometry.shape = DEFAULT_TANK_SHAPE;
+    tank.geometry.diameterCm = DEFAULT_TANK_DIAMETER_CM;
+    tank.geometry.lengthCm = DEFAULT_TANK_LENGTH_CM;
+    tank.geometry.coneHeightCm = DEFAULT_TANK_CONE_CM;
+    tank.pressure.zeroMv = DEFAULT_PRESSURE_ZERO_MV;
+    tank.pressure.fullScaleMv = DEFAULT_PRESSURE_FULL_MV;
+    tank.pressure.rangeMm = DEFAULT_PRESSURE_RANGE_MM;
+    memset(tank.clutter, 0, CLUTTER_MAP_BYTES);
+    
+    // No redundant sensors until configured
+    for (uint8_t s = 0; s < MAX_TANK_SENSORS - 1; s++) {
+        TankSensorConfig& sensor = tank.redundant[s];
+        sensor.driver = DRIVER_NONE;
+        sensor.trigPin = 255;
+        sensor.echoPin = 255;
+        sensor.pressurePin = 255;
+        sensor.emptyCm = DEFAULT_TANK_EMPTY_CM;
+        sensor.fullCm = DEFAULT_TANK_FULL_CM;
+        memset(sensor.clutter, 0, CLUTTER_MAP_BYTES);
+    }
+}
+
+char* ConfigManager::tankKey(char* key, uint8_t index, const char* format) {
+    snprintf(key, CONFIG_KEY_SIZE, format, index + 1);
+    return key;
+}
+
+char* ConfigManager::sensorKey(char* key, uint8_t index, uint8_t sensor, const char* format) {
+    snprintf(key, CONFIG_KEY_SIZE, format, index + 1, sensor + 1);
+    return key;
+}
+
 void ConfigManager::generateDeviceId() {
     #ifdef ESP8266
         uint32_t chipid = ESP.getChipId();
@@ -231,9 +374,30 @@ void ConfigManager::generateDeviceId() {
     DEBUG_PRINTF("Generated Device ID: %s\n", config.deviceId);
 }
 
-bool ConfigManager::setTankMode(TankMode mode) {
-    if (mode != SINGLE_TANK && mode != DUAL_TANK) return false;
-    config.tankMode = mode;
+void ConfigManager::requestSave() {
+    if (savePending) {
+        coalescedSaves++;
+    }
+    savePending = true;
+}
+
+bool ConfigManager::processPendingSave() {
+    if (!savePending) {
+        return false;
+    }
+    
+    if (saveCount > 0 && millis() - lastSaveTime < CONFIG_SAVE_MIN_INTERVAL_MS) {
+        return false; // Too soon, keep coalescing
+    }
+    
+    DEBUG_PRINTF("Config: deferred save (%lu requests coalesced so far)\n", 
+                 (unsigned long)coalescedSaves);
+    return saveConfig();
+}
+
+bool ConfigManager::setTankCount(uint8_t count) {
+    if (count < 1 || count > MAX_TANKS) return false;
+    config.tankCount = count;
     return true;
 }
 
@@ -243,33 +407,21 @@ bool ConfigManager::setUnitSystem(UnitSystem units) {
     return true;
 }
 
-bool ConfigManager::setTank1Calibration(float emptyCm, float fullCm) {
+bool ConfigManager::setTankCalibration(uint8_t index, float emptyCm, float fullCm) {
+    if (index >= MAX_TANKS) return false;
     if (!validateCalibration(emptyCm, fullCm)) return false;
-    config.tank1EmptyCm = emptyCm;
-    config.tank1FullCm = fullCm;
+    config.tanks[index].emptyCm = emptyCm;
+    config.tanks[index].fullCm = fullCm;
     return true;
 }
 
-bool ConfigManager::setTank2Calibration(float emptyCm, float fullCm) {
-    if (!validateCalibration(emptyCm, fullCm)) return false;
-    config.tank2EmptyCm = emptyCm;
-    config.tank2FullCm = fullCm;
+bool ConfigManager::setTankName(uint8_t index, const char* name) {
+    if (index >= MAX_TANKS) return false;
+    strncpy(config.tanks[index].name, name, sizeof(config.tanks[index].name) - 1);
+    config.tanks[index].name[sizeof(config.tanks[index].name) - 1] = '\0';
     return true;
 }
 
-bool ConfigManager::setTankName(uint8_t tankNum, const char* name) {
-    if (tankNum == 1) {
-        strncpy(config.tank1Name, name, sizeof(config.tank1Name) - 1);
-        config.tank1Name[sizeof(config.tank1Name) - 1] = '\0';
-        return true;
-    } else if (tankNum == 2) {
-        strncpy(config.tank2Name, name, sizeof(config.tank2Name) - 1);
-        config.tank2Name[sizeof(config.tank2Name) - 1] = '\0';
-        return true;
-    }
-    return false;
-}
-
 bool ConfigManager::setWiFiCredentials(const char* ssid, const char* password) {
     if (strlen(ssid) == 0 || strlen(ssid) >= sizeof(config.wifiSSID)) return false;
     if (strlen(password) < 8 || strlen(password) >= sizeof(config.wifiPassword)) return false;
@@ -300,19 +452,13 @@ bool ConfigManager::setMQTTTopics(const char* topic, const char* cmdTopic) {
     return true;
 }
 
-bool ConfigManager::setSensorPins(uint8_t tank, uint8_t trigPin, uint8_t echoPin) {
+bool ConfigManager::setSensorPins(uint8_t index, uint8_t trigPin, uint8_t echoPin) {
+    if (index >= MAX_TANKS) return false;
     if (trigPin > 39 || echoPin > 39) return false; // Valid GPIO range for ESP32
     
-    if (tank == 1) {
-        config.trigPin1 = trigPin;
-        config.echoPin1 = echoPin;
-        return true;
-    } else if (tank == 2) {
-        config.trigPin2 = trigPin;
-        config.echoPin2 = echoPin;
-        return true;
-    }
-    return false;
+    config.tanks[index].trigPin = trigPin;
+    config.tanks[index].echoPin = echoPin;
+    return true;
 }
 
 bool ConfigManager::setPumpConfig(PumpMode mode, uint8_t relayPin, float onThreshold, float offThreshold) {
@@ -350,9 +496,13 @@ bool ConfigManager::validateCalibration(float emptyCm, float fullCm) const {
 }
 
 bool ConfigManager::validateConfig() const {
-    if (!validateCalibration(config.tank1EmptyCm, config.tank1FullCm)) return false;
-    if (config.tankMode == DUAL_TANK) {
-        if (!validateCalibration(config.tank2EmptyCm, config.tank2FullCm)) return false;
+    for (uint8_t i = 0; i < config.tankCount; i++) {
+        if (!validateCalibration(config.tanks[i].emptyCm, config.tanks[i].fullCm)) return false;
+        
+        for (uint8_t s = 0; s < MAX_TANK_SENSORS - 1; s++) {
+            const TankSensorConfig& sensor = config.tanks[i].redundant[s];
+            if (sensor.driver != DRIVER_NONE && !validateCalibration(sensor.emptyCm, sensor.fullCm)) return false;
+        }
     }
     return true;
 }
@@ -360,13 +510,18 @@ bool ConfigManager::validateConfig() const {
 void ConfigManager::printConfig() const {
     DEBUG_PRINTLN("\n========== Current Configuration ==========");
     DEBUG_PRINTF("Device ID: %s\n", config.deviceId);
-    DEBUG_PRINTF("Tank Mode: %s\n", config.tankMode == SINGLE_TANK ? "Single" : "Dual");
+    DEBUG_PRINTF("Tanks: %d of %d\n", config.tankCount, MAX_TANKS);
     DEBUG_PRINTF("Unit System: %s\n", config.unitSystem == METRIC_CM ? "Metric (cm)" : "Imperial (in)");
-    DEBUG_PRINTF("Tank 1: %s (Empty: %.1f cm, Full: %.1f cm)\n", 
-                 config.tank1Name, config.tank1EmptyCm, config.tank1FullCm);
-    if (config.tankMode == DUAL_TANK) {
-        DEBUG_PRINTF("Tank 2: %s (Empty: %.1f cm, Full: %.1f cm)\n", 
-                     config.tank2Name, config.tank2EmptyCm, config.tank2FullCm);
+    for (uint8_t i = 0; i < config.tankCount; i++) {
+        DEBUG_PRINTF("Tank %d: %s (Empty: %.1f cm, Full: %.1f cm)\n", 
+                     i + 1, config.tanks[i].name, config.tanks[i].emptyCm, config.tanks[i].fullCm);
+        for (uint8_t s = 0; s < MAX_TANK_SENSORS - 1; s++) {
+            const TankSensorConfig& sensor = config.tanks[i].redundant[s];
+            if (sensor.driver != DRIVER_NONE) {
+                DEBUG_PRINTF("  Redundant sensor %d: driver %d (Empty: %.1f cm, Full: %.1f cm)\n",
+                             s + 2, sensor.driver, sensor.emptyCm, sensor.fullCm);
+            }
+        }
     }
     DEBUG_PRINTF("WiFi: %s%s\n", config.wifiSSID, 
                  strlen(config.wifiSSID) > 0 ? " (configured)" : "(not configured)");
@@ -374,6 +529,14 @@ void ConfigManager::printConfig() const {
     DEBUG_PRINTF("Pump Mode: %s\n", 
                  config.pumpMode == PUMP_MANUAL ? "Manual" : 
                  config.pumpMode == PUMP_AUTOMATIC ? "Automatic" : "Scheduled");
+    DEBUG_PRINTF("Pump Auto-Off: %s\n", config.pumpPredictiveStop ? "Predictive" : "At threshold");
+    DEBUG_PRINTF("Pump Dry-Run: %.1f%% rise in %lu s\n", config.pumpStallRise, (unsigned long)(config.pumpStallWindow / 1000));
+    for (uint8_t i = 0; i < config.pumpWindowCount; i++) {
+        char start[16], end[16];
+        PumpSchedule::formatMinute(start, sizeof(start), config.pumpWindows[i].startMin);
+        PumpSchedule::formatMinute(end, sizeof(end), config.pumpWindows[i].endMin);
+        DEBUG_PRINTF("Pump Window: %s - %s\n", start, end);
+    }
+    DEBUG_PRINTF("Time Zone: %s\n", config.timeZone);
     DEBUG_PRINTLN("==========================================\n");
 }
-
@@ -2,6 +2,11 @@
 #define CONFIG_MANAGER_H
 
 #include <Arduino.h>
+#include "config.h"
+#include "tank_geometry.h"
+#include "clutter_map.h"
+#include "pressure_sensor.h"
+#include "pump_schedule.h"
 
 // ESP32 uses Preferences, ESP8266 will use LittleFS with JSON
 #ifndef ESP8266
@@ -12,11 +17,8 @@
     #include <ArduinoJson.h>
 #endif
 
-// Tank operation mode
-enum TankMode {
-    SINGLE_TANK = 0,
-    DUAL_TANK = 1
-};
+// Storage key buffer (NVS keys are limited to 15 characters)
+#define CONFIG_KEY_SIZE 16
 
 // Unit system
 enum UnitSystem {
@@ -31,17 +33,41 @@ enum PumpMode {
     PUMP_SCHEDULED = 2
 };
 
+// Redundant sensor on a tank (stored under "t<n>S<m>..." keys, m = 2 for the
+// first redundant sensor). It has its own mounting and calibration; a pressure
+// driver uses the tank's transducer scaling.
+struct TankSensorConfig {
+    uint8_t driver;                  // SensorDriver, DRIVER_NONE = not fitted
+    uint8_t trigPin;                 // 255 = not wired
+    uint8_t echoPin;
+    uint8_t pressurePin;
+    float emptyCm;
+    float fullCm;
+    uint8_t clutter[CLUTTER_MAP_BYTES];
+};
+
+// Per-tank configuration (stored under "t<n>..." keys, n = index + 1)
+struct TankConfig {
+    char name[32];
+    float emptyCm;
+    float fullCm;
+    uint8_t driver;                  // SensorDriver: pulse timing / JSN-SR04T serial / pressure
+    uint8_t trigPin;                 // 255 = not wired
+    uint8_t echoPin;
+    uint8_t pressurePin;             // ADC pin (pressure driver), 255 = none
+    TankGeometryConfig geometry;
+    PressureSensorConfig pressure;   // Transducer scaling (pressure driver)
+    uint8_t clutter[CLUTTER_MAP_BYTES];  // Learned false-echo bins
+    TankSensorConfig redundant[MAX_TANK_SENSORS - 1];  // Fused with the primary sensor
+};
+
 // Configuration structure
 struct SystemConfig {
     // Tank configuration
-    TankMode tankMode;
+    uint8_t tankCount;               // Tanks in use, 1..MAX_TANKS
     UnitSystem unitSystem;
-    float tank1EmptyCm;
-    float tank1FullCm;
-    float tank2EmptyCm;
-    float tank2FullCm;
-    char tank1Name[32];
-    char tank2Name[32];
+    TankConfig tanks[MAX_TANKS];
+    uint8_t autoCalMode;             // AutoCalMode: off / propose / apply
     
     // WiFi configuration
     char wifiSSID[64];
@@ -57,11 +83,16 @@ struct SystemConfig {
     uint32_t mqttPublishInterval;
     
     // Sensor configuration
-    uint8_t trigPin1;
-    uint8_t echoPin1;
-    uint8_t trigPin2;
-    uint8_t echoPin2;
     uint32_t sensorReadInterval;
+    uint32_t sensorMinInterval;      // Adaptive sampling floor (ms)
+    uint32_t sensorMaxInterval;      // Adaptive sampling ceiling (ms)
+    uint16_t sensorGuardMs;          // Trigger offset between sensors (crosstalk guard)
+    uint8_t sensorConsensusK;        // Agreeing samples that end a burst (0 = fixed count)
+    uint16_t sensorConsensusTolMm;   // Consensus agreement band (mm)
+    uint8_t sensorConsensusMaxPings; // Burst cap while samples disagree
+    float kalmanProcessNoise;        // Level estimator process noise (%²/s³)
+    float kalmanMeasurementNoise;    // Level estimator measurement noise (%²)
+    float airTemperatureC;           // Fixed air temperature for speed of sound
     
     // Pump configuration
     uint8_t pumpRelayPin;
@@ -70,6 +101,12 @@ struct SystemConfig {
     float pumpAutoOffThreshold;
     uint32_t pumpMaxRunTime;
     uint32_t pumpCooldownTime;
+    bool pumpPredictiveStop;         // Auto-off ahead of the threshold from the fill rate
+    float pumpStallRise;             // Dry-run detection: required level rise (%)...
+    uint32_t pumpStallWindow;        // ...within this time of running (ms, 0 = off)
+    PumpWindow pumpWindows[PUMP_SCHEDULE_MAX_WINDOWS];  // Scheduled mode, local time
+    uint8_t pumpWindowCount;
+    char timeZone[48];               // POSIX TZ for local time (NTP)
     
     // Display configuration
     bool displayEnabled;
@@ -95,6 +132,15 @@ public:
     // Save configuration to NVS
     bool saveConfig();
     
+    // Deferred, rate-limited save for values learned at runtime (clutter,
+    // auto-calibration): requests are coalesced and written at most once
+    // per CONFIG_SAVE_MIN_INTERVAL_MS
+    void requestSave();
+    bool processPendingSave();
+    bool isSavePending() const { return savePending; }
+    uint32_t getSaveCount() const { return saveCount; }
+    uint32_t getCoalescedSaveCount() const { return coalescedSaves; }
+    
     // Reset to factory defaults
     void resetToDefaults();
     
@@ -103,15 +149,15 @@ public:
     SystemConfig& getConfigRef() { return config; }
     
     // Configuration setters (with validation)
-    bool setTankMode(TankMode mode);
+    // Tanks are addressed by 0-based index (shown to users as tank index + 1)
+    bool setTankCount(uint8_t count);
     bool setUnitSystem(UnitSystem units);
-    bool setTank1Calibration(float emptyCm, float fullCm);
-    bool setTank2Calibration(float emptyCm, float fullCm);
-    bool setTankName(uint8_t tankNum, const char* name);
+    bool setTankCalibration(uint8_t index, float emptyCm, float fullCm);
+    bool setTankName(uint8_t index, const char* name);
     bool setWiFiCredentials(const char* ssid, const char* password);
     bool setMQTTConfig(const char* broker, uint16_t port, const char* user, const char* password);
     bool setMQTTTopics(const char* topic, const char* cmdTopic);
-    bool setSensorPins(uint8_t tank, uint8_t trigPin, uint8_t echoPin);
+    bool setSensorPins(uint8_t index, uint8_t trigPin, uint8_t echoPin);
     bool setPumpConfig(PumpMode mode, uint8_t relayPin, float onThreshold, float offThreshold);
     bool setDisplayConfig(bool enabled, uint32_t timeout);
     
@@ -126,6 +172,12 @@ public:
 private:
     SystemConfig config;
     
+    // Deferred save state
+    bool savePending;
+    uint32_t lastSaveTime;
+    uint32_t saveCount;
+    uint32_t coalescedSaves;
+    
     #ifndef ESP8266
         Preferences preferences;
     #else
@@ -135,7 +187,16 @@ private:
     
     // Internal helpers
     void generateDeviceId();
+    void resetTankDefaults(uint8_t index);
     bool validateConfig() const;
+    
+    // Storage key of a per-tank setting, e.g. tankKey(key, 0, "t%uEmpty") -> "t1Empty"
+    // (non-const, so ArduinoJson copies it rather than keeping the pointer)
+    static char* tankKey(char* key, uint8_t index, const char* format);
+    
+    // Storage key of a redundant sensor setting (sensor 1 = first redundant),
+    // e.g. sensorKey(key, 0, 1, "t%uS%uDrv") -> "t1S2Drv"
+    static char* sensorKey(char* key, uint8_t index, uint8_t sensor, const char* format);
 };
 
 #endif // CONFIG_MANAGER_H
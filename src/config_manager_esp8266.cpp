@@ -4,6 +4,31 @@
 #include "config_manager.h"
 #include "config.h"
 
+// Config document capacity (per-tank keys and clutter maps dominate)
+#define CONFIG_JSON_SIZE (2048 + MAX_TANKS * MAX_TANK_SENSORS * 512)
+
+// Clutter bitmaps are stored as hex strings
+static void bitmapToHex(const uint8_t* bitmap, char* hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (uint8_t i = 0; i < CLUTTER_MAP_BYTES; i++) {
+        hex[i * 2] = digits[bitmap[i] >> 4];
+        hex[i * 2 + 1] = digits[bitmap[i] & 0x0F];
+    }
+    hex[CLUTTER_MAP_BYTES * 2] = '\0';
+}
+
+static void hexToBitmap(const char* hex, uint8_t* bitmap) {
+    memset(bitmap, 0, CLUTTER_MAP_BYTES);
+    if (strlen(hex) != CLUTTER_MAP_BYTES * 2) {
+        return;
+    }
+    for (uint8_t i = 0; i < CLUTTER_MAP_BYTES * 2; i++) {
+        char c = hex[i];
+        uint8_t nibble = (c >= 'a') ? c - 'a' + 10 : (c >= 'A') ? c - 'A' + 10 : c - '0';
+        bitmap[i / 2] |= (nibble & 0x0F) << ((i % 2) ? 0 : 4);
+    }
+}
+
 bool ConfigManager::loadFromLittleFS() {
     DEBUG_PRINTLN("Loading configuration from LittleFS...");
     
@@ -13,7 +38,7 @@ bool ConfigManager::loadFromLittleFS() {
         return false;
     }
     
-    StaticJsonDocument<1536> doc;
+    DynamicJsonDocument doc(CONFIG_JSON_SIZE); // Heap: too large for the ESP8266 stack
     DeserializationError error = deserializeJson(doc, file);
     file.close();
     
@@ -23,14 +48,47 @@ bool ConfigManager::loadFromLittleFS() {
     }
     
     // Load all settings from JSON - using correct field names from SystemConfig
-    config.tankMode = (TankMode)doc["tankMode"].as<int>();
+    // Older firmware stored single/dual as "tankMode"
+    uint8_t legacyCount = (doc["tankMode"] | 0) + 1;
+    config.tankCount = constrain(doc["tankCount"] | legacyCount, 1, MAX_TANKS);
     config.unitSystem = (UnitSystem)doc["unitSystem"].as<int>();
-    config.tank1EmptyCm = doc["t1Empty"].as<float>();
-    config.tank1FullCm = doc["t1Full"].as<float>();
-    config.tank2EmptyCm = doc["t2Empty"].as<float>();
-    config.tank2FullCm = doc["t2Full"].as<float>();
-    strlcpy(config.tank1Name, doc["t1Name"] | "Tank 1", sizeof(config.tank1Name));
-    strlcpy(config.tank2Name, doc["t2Name"] | "Tank 2", sizeof(config.tank2Name));
+    config.autoCalMode = doc["autoCal"] | DEFAULT_AUTOCAL_MODE;
+    
+    char key[CONFIG_KEY_SIZE];
+    for (uint8_t i = 0; i < MAX_TANKS; i++) {
+        TankConfig& tank = config.tanks[i];
+        resetTankDefaults(i);
+        
+        tank.emptyCm = doc[tankKey(key, i, "t%uEmpty")] | tank.emptyCm;
+        tank.fullCm = doc[tankKey(key, i, "t%uFull")] | tank.fullCm;
+        const char* name = doc[tankKey(key, i, "t%uName")];
+        if (name) {
+            strlcpy(tank.name, name, sizeof(tank.name));
+        }
+        tank.driver = doc[tankKey(key, i, "t%uDriver")] | tank.driver;
+        tank.trigPin = doc[tankKey(key, i, "trigPin%u")] | tank.trigPin;
+        tank.echoPin = doc[tankKey(key, i, "echoPin%u")] | tank.echoPin;
+        tank.pressurePin = doc[tankKey(key, i, "t%uPPin")] | tank.pressurePin;
+        tank.geometry.shape = doc[tankKey(key, i, "t%uShape")] | tank.geometry.shape;
+        tank.geometry.diameterCm = doc[tankKey(key, i, "t%uDiam")] | tank.geometry.diameterCm;
+        tank.geometry.lengthCm = doc[tankKey(key, i, "t%uLen")] | tank.geometry.lengthCm;
+        tank.geometry.coneHeightCm = doc[tankKey(key, i, "t%uCone")] | tank.geometry.coneHeightCm;
+        tank.pressure.zeroMv = doc[tankKey(key, i, "t%uPZero")] | tank.pressure.zeroMv;
+        tank.pressure.fullScaleMv = doc[tankKey(key, i, "t%uPFull")] | tank.pressure.fullScaleMv;
+        tank.pressure.rangeMm = doc[tankKey(key, i, "t%uPRange")] | tank.pressure.rangeMm;
+        hexToBitmap(doc[tankKey(key, i, "t%uClutter")] | "", tank.clutter);
+        
+        for (uint8_t s = 1; s < MAX_TANK_SENSORS; s++) {
+            TankSensorConfig& sensor = tank.redundant[s - 1];
+            sensor.driver = doc[sensorKey(key, i, s, "t%uS%uDrv")] | sensor.driver;
+            sensor.trigPin = doc[sensorKey(key, i, s, "t%uS%uTrig")] | sensor.trigPin;
+            sensor.echoPin = doc[sensorKey(key, i, s, "t%uS%uEcho")] | sensor.echoPin;
+            sensor.pressurePin = doc[sensorKey(key, i, s, "t%uS%uPPin")] | sensor.pressurePin;
+            sensor.emptyCm = doc[sensorKey(key, i, s, "t%uS%uEmpty")] | sensor.emptyCm;
+            sensor.fullCm = doc[sensorKey(key, i, s, "t%uS%uFull")] | sensor.fullCm;
+            hexToBitmap(doc[sensorKey(key, i, s, "t%uS%uClut")] | "", sensor.clutter);
+        }
+    }
     
     strlcpy(config.wifiSSID, doc["wifiSSID"] | "", sizeof(config.wifiSSID));
     strlcpy(config.wifiPassword, doc["wifiPass"] | "", sizeof(config.wifiPassword));
@@ -43,16 +101,31 @@ bool ConfigManager::loadFromLittleFS() {
     strlcpy(config.mqttCmdTopic, doc["mqttCmdTopic"] | "", sizeof(config.mqttCmdTopic));
     config.mqttPublishInterval = doc["mqttInterval"].as<uint32_t>();
     
-    config.trigPin1 = doc["trigPin1"].as<uint8_t>();
-    config.echoPin1 = doc["echoPin1"].as<uint8_t>();
-    config.trigPin2 = doc["trigPin2"].as<uint8_t>();
-    config.echoPin2 = doc["echoPin2"].as<uint8_t>();
+    config.sensorGuardMs = doc["sensorGuard"] | SENSOR_CROSSTALK_GUARD_MS;
+    config.sensorConsensusK = doc["consK"] | SENSOR_CONSENSUS_K;
+    config.sensorConsensusTolMm = doc["consTol"] | SENSOR_CONSENSUS_TOL_MM;
+    config.sensorConsensusMaxPings = doc["consMax"] | SENSOR_CONSENSUS_MAX_PINGS;
+    config.sensorMinInterval = doc["sensorMinInt"] | SENSOR_MIN_INTERVAL;
+    config.sensorMaxInterval = doc["sensorMaxInt"] | SENSOR_MAX_INTERVAL;
+    config.kalmanProcessNoise = doc["kalmanQ"] | KALMAN_PROCESS_NOISE;
+    config.kalmanMeasurementNoise = doc["kalmanR"] | KALMAN_MEASUREMENT_NOISE;
+    config.airTemperatureC = doc["airTemp"] | DEFAULT_AIR_TEMPERATURE_C;
     
     config.pumpMode = (PumpMode)doc["pumpMode"].as<int>();
     config.pumpAutoOnThreshold = doc["pumpOnThresh"].as<float>();
     config.pumpAutoOffThreshold = doc["pumpOffThresh"].as<float>();
     config.pumpMaxRunTime = doc["pumpMaxRun"].as<uint32_t>();
     config.pumpCooldownTime = doc["pumpCool"].as<uint32_t>();
+    config.pumpPredictiveStop = doc["pumpPredict"] | DEFAULT_PUMP_PREDICTIVE;
+    config.pumpStallRise = doc["pumpStallRise"] | DEFAULT_PUMP_STALL_RISE;
+    config.pumpStallWindow = doc["pumpStallWin"] | DEFAULT_PUMP_STALL_WINDOW;
+    config.pumpWindowCount = 0;
+    for (JsonArrayConst window : doc["pumpWindows"].as<JsonArrayConst>()) {
+        if (config.pumpWindowCount >= PUMP_SCHEDULE_MAX_WINDOWS) break;
+        config.pumpWindows[config.pumpWindowCount].startMin = window[0];
+        config.pumpWindows[config.pumpWindowCount++].endMin = window[1];
+    }
+    strlcpy(config.timeZone, doc["timeZone"] | DEFAULT_TIME_ZONE, sizeof(config.timeZone));
     config.pumpRelayPin = doc["pumpPin"].as<uint8_t>();
     
     config.displayEnabled = doc["dispEnabled"].as<bool>();
@@ -75,17 +148,48 @@ bool ConfigManager::loadFromLittleFS() {
 bool ConfigManager::saveToLittleFS() {
     DEBUG_PRINTLN("Saving configuration to LittleFS...");
     
-    StaticJsonDocument<1536> doc;
+    DynamicJsonDocument doc(CONFIG_JSON_SIZE); // Heap: too large for the ESP8266 stack
     
     // Save all settings to JSON - using correct field names from SystemConfig
-    doc["tankMode"] = config.tankMode;
+    doc["tankCount"] = config.tankCount;
     doc["unitSystem"] = config.unitSystem;
-    doc["t1Empty"] = config.tank1EmptyCm;
-    doc["t1Full"] = config.tank1FullCm;
-    doc["t2Empty"] = config.tank2EmptyCm;
-    doc["t2Full"] = config.tank2FullCm;
-    doc["t1Name"] = config.tank1Name;
-    doc["t2Name"] = config.tank2Name;
+    doc["autoCal"] = config.autoCalMode;
+    
+    // Every slot, so a lowered count keeps its settings
+    char key[CONFIG_KEY_SIZE];
+    char clutterHex[CLUTTER_MAP_BYTES * 2 + 1];
+    for (uint8_t i = 0; i < MAX_TANKS; i++) {
+        const TankConfig& tank = config.tanks[i];
+        
+        doc[tankKey(key, i, "t%uEmpty")] = tank.emptyCm;  // Keys are copied into the document
+        doc[tankKey(key, i, "t%uFull")] = tank.fullCm;
+        doc[tankKey(key, i, "t%uName")] = tank.name;
+        doc[tankKey(key, i, "t%uDriver")] = tank.driver;
+        doc[tankKey(key, i, "trigPin%u")] = tank.trigPin;
+        doc[tankKey(key, i, "echoPin%u")] = tank.echoPin;
+        doc[tankKey(key, i, "t%uPPin")] = tank.pressurePin;
+        doc[tankKey(key, i, "t%uShape")] = tank.geometry.shape;
+        doc[tankKey(key, i, "t%uDiam")] = tank.geometry.diameterCm;
+        doc[tankKey(key, i, "t%uLen")] = tank.geometry.lengthCm;
+        doc[tankKey(key, i, "t%uCone")] = tank.geometry.coneHeightCm;
+        doc[tankKey(key, i, "t%uPZero")] = tank.pressure.zeroMv;
+        doc[tankKey(key, i, "t%uPFull")] = tank.pressure.fullScaleMv;
+        doc[tankKey(key, i, "t%uPRange")] = tank.pressure.rangeMm;
+        bitmapToHex(tank.clutter, clutterHex);
+        doc[tankKey(key, i, "t%uClutter")] = clutterHex;
+        
+        for (uint8_t s = 1; s < MAX_TANK_SENSORS; s++) {
+            const TankSensorConfig& sensor = tank.redundant[s - 1];
+            doc[sensorKey(key, i, s, "t%uS%uDrv")] = sensor.driver;
+            doc[sensorKey(key, i, s, "t%uS%uTrig")] = sensor.trigPin;
+            doc[sensorKey(key, i, s, "t%uS%uEcho")] = sensor.echoPin;
+            doc[sensorKey(key, i, s, "t%uS%uPPin")] = sensor.pressurePin;
+            doc[sensorKey(key, i, s, "t%uS%uEmpty")] = sensor.emptyCm;
+            doc[sensorKey(key, i, s, "t%uS%uFull")] = sensor.fullCm;
+            bitmapToHex(sensor.clutter, clutterHex);
+            doc[sensorKey(key, i, s, "t%uS%uClut")] = clutterHex;
+        }
+    }
     
     doc["wifiSSID"] = config.wifiSSID;
     doc["wifiPass"] = config.wifiPassword;
@@ -98,16 +202,31 @@ bool ConfigManager::saveToLittleFS() {
     doc["mqttCmdTopic"] = config.mqttCmdTopic;
     doc["mqttInterval"] = config.mqttPublishInterval;
     
-    doc["trigPin1"] = config.trigPin1;
-    doc["echoPin1"] = config.echoPin1;
-    doc["trigPin2"] = config.trigPin2;
-    doc["echoPin2"] = config.echoPin2;
+    doc["sensorGuard"] = config.sensorGuardMs;
+    doc["consK"] = config.sensorConsensusK;
+    doc["consTol"] = config.sensorConsensusTolMm;
+    doc["consMax"] = config.sensorConsensusMaxPings;
+    doc["sensorMinInt"] = config.sensorMinInterval;
+    doc["sensorMaxInt"] = config.sensorMaxInterval;
+    doc["kalmanQ"] = config.kalmanProcessNoise;
+    doc["kalmanR"] = config.kalmanMeasurementNoise;
+    doc["airTemp"] = config.airTemperatureC;
     
     doc["pumpMode"] = config.pumpMode;
     doc["pumpOnThresh"] = config.pumpAutoOnThreshold;
     doc["pumpOffThresh"] = config.pumpAutoOffThreshold;
     doc["pumpMaxRun"] = config.pumpMaxRunTime;
     doc["pumpCool"] = config.pumpCooldownTime;
+    doc["pumpPredict"] = config.pumpPredictiveStop;
+    doc["pumpStallRise"] = config.pumpStallRise;
+    doc["pumpStallWin"] = config.pumpStallWindow;
+    JsonArray windows = doc.createNestedArray("pumpWindows");
+    for (uint8_t i = 0; i < config.pumpWindowCount; i++) {
+        JsonArray window = windows.createNestedArray();
+        window.add(config.pumpWindows[i].startMin);
+        window.add(config.pumpWindows[i].endMin);
+    }
+    doc["timeZone"] = config.timeZone;
     doc["pumpPin"] = config.pumpRelayPin;
     
     doc["dispEnabled"] = config.displayEnabled;
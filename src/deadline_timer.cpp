@@ -0,0 +1,86 @@
+#include "deadline_timer.h"
+#include "config.h"
+#include <Arduino.h>
+#include <time.h>
+
+DeadlineTimers::DeadlineTimers() : armedMask(0) {
+    for (uint8_t i = 0; i < DEADLINE_TIMER_SLOTS; i++) {
+        deadlines[i] = 0;
+    }
+}
+
+void DeadlineTimers::arm(uint8_t id, uint32_t deadlineMs) {
+    if (id >= DEADLINE_TIMER_SLOTS) {
+        return;
+    }
+    deadlines[id] = deadlineMs;
+    armedMask |= (1 << id);
+}
+
+void DeadlineTimers::cancel(uint8_t id) {
+    if (id < DEADLINE_TIMER_SLOTS) {
+        armedMask &= ~(1 << id);
+    }
+}
+
+bool DeadlineTimers::nextIn(uint32_t now, uint32_t& ms) const {
+    bool found = false;
+    int32_t earliest = 0;
+    
+    for (uint8_t i = 0; i < DEADLINE_TIMER_SLOTS; i++) {
+        if (!(armedMask & (1 << i))) {
+            continue;
+        }
+        int32_t remaining = (int32_t)(deadlines[i] - now);
+        if (!found || remaining < earliest) {
+            earliest = remaining;
+            found = true;
+        }
+    }
+    
+    ms = (found && earliest > 0) ? (uint32_t)earliest : 0;
+    return found;
+}
+
+bool DeadlineTimers::popExpired(uint32_t now, uint8_t& id) {
+    bool found = false;
+    int32_t latest = 0;
+    
+    // Most overdue first, so transitions happen in deadline order
+    for (uint8_t i = 0; i < DEADLINE_TIMER_SLOTS; i++) {
+        if (!(armedMask & (1 << i))) {
+            continue;
+        }
+        int32_t overdue = (int32_t)(now - deadlines[i]);
+        if (overdue >= 0 && (!found || overdue > latest)) {
+            latest = overdue;
+            id = i;
+            found = true;
+        }
+    }
+    
+    if (found) {
+        armedMask &= ~(1 << id);
+    }
+    return found;
+}
+
+uint32_t SystemClock::nowMs() const {
+    return millis();
+}
+
+uint32_t SystemClock::nowUs() const {
+    return micros();
+}
+
+bool SystemClock::localSecondOfWeek(uint32_t& second) const {
+    time_t now = time(nullptr);
+    if (now < CLOCK_VALID_EPOCH) {
+        return false; // Not synced yet
+    }
+    
+    struct tm local;
+    localtime_r(&now, &local);
+    second = (uint32_t)local.tm_wday * 86400 + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef DEADLINE_TIMER_H
+#define DEADLINE_TIMER_H
+
+#include <stdint.h>
+
+#define DEADLINE_TIMER_SLOTS 4
+#define SECONDS_PER_WEEK 604800UL
+
+// Millisecond time source for deadline timers
+class Clock {
+public:
+    virtual ~Clock() {}
+    
+    virtual uint32_t nowMs() const = 0;
+    virtual uint32_t nowUs() const { return nowMs() * 1000; }
+    
+    // Local wall time as seconds since Sunday 00:00; false while unset
+    virtual bool localSecondOfWeek(uint32_t& /*second*/) const { return false; }
+};
+
+// millis(), and the system time (NTP) in the configured time zone
+class SystemClock : public Clock {
+public:
+    uint32_t nowMs() const override;
+    uint32_t nowUs() const override;
+    bool localSecondOfWeek(uint32_t& second) const override;
+};
+
+// Clock that only moves when told to (host simulation of timed logic)
+class VirtualClock : public Clock {
+public:
+    VirtualClock(uint32_t startMs = 0) : now(startMs), wallSet(false), wallBase(0), wallBaseMs(0) {}
+    
+    uint32_t nowMs() const override { return now; }
+    void set(uint32_t ms) { now = ms; }
+    void advance(uint32_t ms) { now += ms; }
+    
+    // Wall time from now on, moving with the millisecond clock
+    void setWallTime(uint32_t secondOfWeek) { wallSet = true; wallBase = secondOfWeek; wallBaseMs = now; }
+    bool localSecondOfWeek(uint32_t& second) const override {
+        second = (wallBase + (now - wallBaseMs) / 1000) % SECONDS_PER_WEEK;
+        return wallSet;
+    }
+
+private:
+    uint32_t now;
+    bool wallSet;
+    uint32_t wallBase;
+    uint32_t wallBaseMs;
+};
+
+/**
+ * A handful of one-shot deadlines, identified by small integer ids.
+ *
+ * Deadlines are absolute millisecond times compared with wrap-safe
+ * arithmetic. The owner asks how long until the earliest one and arms a
+ * single hardware-backed timer for it, then pops whatever is due when it
+ * fires; with this few slots a scan beats a wheel.
+ */
+class DeadlineTimers {
+public:
+    DeadlineTimers();
+    
+    void arm(uint8_t id, uint32_t deadlineMs);
+    void cancel(uint8_t id);
+    void cancelAll() { armedMask = 0; }
+    bool isArmed(uint8_t id) const { return id < DEADLINE_TIMER_SLOTS && (armedMask & (1 << id)); }
+    uint32_t getDeadline(uint8_t id) const { return deadlines[id]; }
+    
+    // Time from now to the earliest armed deadline (0 if already due);
+    // false when nothing is armed
+    bool nextIn(uint32_t now, uint32_t& ms) const;
+    
+    // Disarm and return the earliest due timer; false when none is due
+    bool popExpired(uint32_t now, uint8_t& id);
+
+private:
+    uint32_t deadlines[DEADLINE_TIMER_SLOTS];
+    uint8_t armedMask;
+};
+
+#endif // DEADLINE_TIMER_H
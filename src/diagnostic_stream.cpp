@@ -0,0 +1,98 @@
+#include "diagnostic_stream.h"
+
+DiagnosticStream::DiagnosticStream()
+    : head(0), tail(0), active(false), tank(0), deadline(0), echoWindowUs(0),
+      lastPingMs(0), sequence(0), dropped(0) {
+}
+
+void DiagnosticStream::start(uint8_t tank, uint32_t durationMs, uint32_t now) {
+    if (durationMs == 0 || durationMs > DIAG_MAX_SECONDS * 1000UL) {
+        durationMs = durationMs == 0 ? DIAG_DEFAULT_SECONDS * 1000UL : DIAG_MAX_SECONDS * 1000UL;
+    }
+    
+    // Everything is set up before the sensor task can see the stream; the
+    // ring itself belongs to the sensor and network tasks and is left alone
+    active.store(false, std::memory_order_release);
+    this->tank = tank;
+    this->deadline = now + durationMs;
+    lastPingMs = now;
+    sequence = 0;
+    dropped = 0;
+    active.store(true, std::memory_order_release);
+}
+
+void DiagnosticStream::stop() {
+    active.store(false, std::memory_order_release);
+}
+
+uint32_t DiagnosticStream::getRemainingMs(uint32_t now) const {
+    if (!isActive() || (int32_t)(deadline - now) <= 0) {
+        return 0;
+    }
+    return deadline - now;
+}
+
+bool DiagnosticStream::checkExpiry(uint32_t now) {
+    if (isActive() && (int32_t)(now - deadline) >= 0) {
+        stop();
+        return true;
+    }
+    return false;
+}
+
+void DiagnosticStream::record(uint32_t timeMs, uint8_t status, uint32_t widthUs) {
+    uint8_t h = head.load(std::memory_order_relaxed);
+    uint8_t next = (h + 1) & (DIAG_RING_SIZE - 1);
+    
+    uint32_t gap = timeMs - lastPingMs;
+    lastPingMs = timeMs;
+    
+    if (next == tail.load(std::memory_order_acquire)) {
+        if (dropped < UINT16_MAX) dropped++; // Nobody is draining fast enough
+        return;
+    }
+    
+    DiagPing& ping = ring[h];
+    ping.widthUs = widthUs > UINT16_MAX ? UINT16_MAX : (uint16_t)widthUs;
+    ping.status = status;
+    ping.gapMs = gap > 255 ? 255 : (uint8_t)gap;
+    head.store(next, std::memory_order_release);
+}
+
+size_t DiagnosticStream::buildFrame(uint8_t* frame, uint32_t now) {
+    uint8_t t = tail.load(std::memory_order_relaxed);
+    uint8_t h = head.load(std::memory_order_acquire);
+    if (t == h) {
+        return 0;
+    }
+    
+    uint8_t count = 0;
+    uint8_t* out = frame + DIAG_FRAME_HEADER_SIZE;
+    while (t != h && count < DIAG_FRAME_MAX_PINGS) {
+        const DiagPing& ping = ring[t];
+        putU16(out, ping.widthUs);
+        out[2] = ping.status;
+        out[3] = ping.gapMs;
+        out += DIAG_PING_SIZE;
+        count++;
+        t = (t + 1) & (DIAG_RING_SIZE - 1);
+    }
+    tail.store(t, std::memory_order_release);
+    
+    frame[0] = DIAG_FRAME_MAGIC;
+    frame[1] = DIAG_FRAME_VERSION;
+    frame[2] = tank + 1;
+    frame[3] = count;
+    putU16(frame + 4, sequence);
+    putU16(frame + 6, (uint16_t)((getRemainingMs(now) + 999) / 1000));
+    putU16(frame + 8, (uint16_t)dropped);
+    putU16(frame + 10, echoWindowUs > UINT16_MAX ? UINT16_MAX : (uint16_t)echoWindowUs);
+    
+    sequence += count;
+    return DIAG_FRAME_HEADER_SIZE + count * DIAG_PING_SIZE;
+}
+
+void DiagnosticStream::putU16(uint8_t* at, uint16_t value) {
+    at[0] = value & 0xFF;
+    at[1] = value >> 8;
+}
@@ -0,0 +1,79 @@
+#ifndef DIAGNOSTIC_STREAM_H
+#define DIAGNOSTIC_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "config.h"
+
+// Binary frame layout (little endian)
+#define DIAG_FRAME_MAGIC        0xD1
+#define DIAG_FRAME_VERSION      1
+#define DIAG_FRAME_HEADER_SIZE  12
+#define DIAG_PING_SIZE          4
+#define DIAG_FRAME_SIZE         (DIAG_FRAME_HEADER_SIZE + DIAG_FRAME_MAX_PINGS * DIAG_PING_SIZE)
+
+// One raw ping as buffered and sent
+struct DiagPing {
+    uint16_t widthUs;       // Echo pulse width, 0 unless status is ECHO_OK
+    uint8_t status;         // EchoStatus
+    uint8_t gapMs;          // Since the previous ping (255 = 255 ms or more)
+};
+
+/**
+ * Time-limited stream of raw pings for installers.
+ *
+ * The sensor task records every ping into a fixed lock-free ring; the
+ * network task drains it into caller-owned frames. Nothing is allocated
+ * while streaming, and the stream stops by itself at its deadline.
+ *
+ * Frame (12-byte header, then 4 bytes per ping):
+ *
+ *     0  u8  magic 0xD1        6  u16 seconds remaining
+ *     1  u8  version 1         8  u16 pings dropped (ring full, saturating)
+ *     2  u8  tank (1-based)   10  u16 echo window (µs)
+ *     3  u8  ping count       12  per ping: u16 width µs, u8 status, u8 gap ms
+ *     4  u16 sequence of the first ping
+ */
+class DiagnosticStream {
+public:
+    DiagnosticStream();
+    
+    // Stream one tank (0-based) for durationMs, clamped to DIAG_MAX_SECONDS
+    void start(uint8_t tank, uint32_t durationMs, uint32_t now);
+    void stop();
+    
+    bool isActive() const { return active.load(std::memory_order_acquire); }
+    uint8_t getTank() const { return tank; }
+    uint32_t getRemainingMs(uint32_t now) const;
+    
+    // Stops the stream once its deadline has passed; true if it did
+    bool checkExpiry(uint32_t now);
+    
+    // Producer (sensor task)
+    void setEchoWindow(uint32_t timeoutUs) { echoWindowUs = timeoutUs; }
+    void record(uint32_t timeMs, uint8_t status, uint32_t widthUs);
+    
+    // Consumer: drain up to DIAG_FRAME_MAX_PINGS pings into a frame of at
+    // least DIAG_FRAME_SIZE bytes; returns its length, 0 if nothing is pending
+    size_t buildFrame(uint8_t* frame, uint32_t now);
+    
+    uint32_t getDroppedCount() const { return dropped; }
+
+private:
+    DiagPing ring[DIAG_RING_SIZE];
+    std::atomic<uint8_t> head;      // Written by the sensor task
+    std::atomic<uint8_t> tail;      // Written by the network task
+    std::atomic<bool> active;
+    
+    uint8_t tank;
+    uint32_t deadline;
+    uint32_t echoWindowUs;
+    uint32_t lastPingMs;
+    uint16_t sequence;              // Of the next ping to be sent
+    uint32_t dropped;
+    
+    static void putU16(uint8_t* at, uint16_t value);
+};
+
+#endif // DIAGNOSTIC_STREAM_H
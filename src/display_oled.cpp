@@ -160,10 +160,10 @@ void DisplayOLED::showSensorDetails(const SensorReading& reading1, const SensorR
     // Tank 1
     display.println("Tank 1:");
     display.print("  Dist: ");
-    display.print(reading1.distanceCm, 1);
+    display.print(mmToCm(reading1.distanceMm), 1);
     display.println(" cm");
     display.print("  Level: ");
-    display.print(reading1.levelPercent, 1);
+    display.print(centiToPercent(reading1.levelCenti), 1);
     display.println("%");
     display.print("  Valid: ");
     display.println(reading1.isValid ? "Yes" : "No");
@@ -172,10 +172,10 @@ void DisplayOLED::showSensorDetails(const SensorReading& reading1, const SensorR
         display.println();
         display.println("Tank 2:");
         display.print("  Dist: ");
-        display.print(reading2->distanceCm, 1);
+        display.print(mmToCm(reading2->distanceMm), 1);
         display.println(" cm");
         display.print("  Level: ");
-        display.print(reading2->levelPercent, 1);
+        display.print(centiToPercent(reading2->levelCenti), 1);
         display.println("%");
         display.print("  Valid: ");
         display.println(reading2->isValid ? "Yes" : "No");
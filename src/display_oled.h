@@ -4,7 +4,7 @@
 #include <Arduino.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
-#include "sensor_ultrasonic.h"
+#include "level_sensor.h"
 
 // Display screen modes
 enum DisplayScreen {
@@ -0,0 +1,86 @@
+#include "echo_capture.h"
+
+// ============================================================================
+// PULSE RING
+// ============================================================================
+bool ECHO_ISR_ATTR EchoPulseRing::push(const EchoPulse& pulse) {
+    uint8_t h = head.load(std::memory_order_relaxed);
+    uint8_t next = (h + 1) & (ECHO_RING_SIZE - 1);
+
+    if (next == tail.load(std::memory_order_acquire)) {
+        return false; // Full - consumer is not keeping up
+    }
+
+    slots[h] = pulse;
+    head.store(next, std::memory_order_release);
+    return true;
+}
+
+bool EchoPulseRing::pop(EchoPulse& pulse) {
+    uint8_t t = tail.load(std::memory_order_relaxed);
+
+    if (t == head.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    pulse = slots[t];
+    tail.store((t + 1) & (ECHO_RING_SIZE - 1), std::memory_order_release);
+    return true;
+}
+
+// ============================================================================
+// CAPTURE STATE MACHINE
+// ============================================================================
+EchoCapture::EchoCapture()
+    : state(STATE_IDLE), armCycles(0), riseCycles(0), timeoutCycles(0) {
+}
+
+void EchoCapture::arm(uint32_t nowCycles, uint32_t timeoutCycles) {
+    // Drop any stale result from a previous cycle
+    ring.clear();
+
+    this->armCycles = nowCycles;
+    this->timeoutCycles = timeoutCycles;
+    state.store(STATE_ARMED, std::memory_order_release);
+}
+
+void ECHO_ISR_ATTR EchoCapture::onEdge(bool level, uint32_t cycles) {
+    uint8_t current = state.load(std::memory_order_acquire);
+
+    if (level && current == STATE_ARMED) {
+        riseCycles = cycles;
+        state.store(STATE_IN_PULSE, std::memory_order_release);
+    } else if (!level && current == STATE_IN_PULSE) {
+        complete(STATE_IN_PULSE, cycles - riseCycles, ECHO_OK);
+    }
+    // Edges while idle (ringing, noise) are ignored
+}
+
+bool EchoCapture::expire(uint32_t nowCycles) {
+    uint8_t current = state.load(std::memory_order_acquire);
+
+    if (current == STATE_IDLE) {
+        return false;
+    }
+
+    // Unsigned subtraction handles cycle counter wrap-around
+    if (nowCycles - armCycles < timeoutCycles) {
+        return false;
+    }
+
+    // A pulse in progress means the sensor is alive but the echo is late
+    return complete(current, 0, current == STATE_IN_PULSE ? ECHO_WINDOW_EXPIRED : ECHO_TIMEOUT);
+}
+
+bool ECHO_ISR_ATTR EchoCapture::complete(uint8_t expected, uint32_t widthCycles, uint8_t status) {
+    // Only one of the ISR (falling edge) and expire() may finish a cycle
+    if (!state.compare_exchange_strong(expected, STATE_IDLE, std::memory_order_acq_rel)) {
+        return false;
+    }
+
+    EchoPulse pulse;
+    pulse.riseCycles = riseCycles;
+    pulse.widthCycles = widthCycles;
+    pulse.status = status;
+    return ring.push(pulse);
+}
@@ -0,0 +1,125 @@
+#ifndef ECHO_CAPTURE_H
+#define ECHO_CAPTURE_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Capture ring depth (must be a power of two)
+#define ECHO_RING_SIZE 8
+
+// Edge handlers run from the GPIO interrupt and must live in IRAM on target.
+// On a host build there is no IRAM, so the attribute collapses to nothing.
+#if defined(ARDUINO)
+    #include <Arduino.h>
+    #define ECHO_ISR_ATTR IRAM_ATTR
+#else
+    #define ECHO_ISR_ATTR
+#endif
+
+// Result of one trigger/echo cycle
+enum EchoStatus {
+    ECHO_OK = 0,
+    ECHO_TIMEOUT = 1,       // No rising edge: the sensor never answered the trigger
+    ECHO_WINDOW_EXPIRED = 2 // Pulse started but no echo returned within the window
+};
+
+// Completed echo pulse (cycle counter timestamps)
+struct EchoPulse {
+    uint32_t riseCycles;    // Cycle count at the rising edge
+    uint32_t widthCycles;   // Rising to falling edge, in CPU cycles
+    uint8_t status;         // EchoStatus
+};
+
+// Lock-free single-producer/single-consumer ring of completed pulses.
+// At most one producer (edge ISR or expire()) is active per armed cycle,
+// so head only ever has one writer at a time.
+class EchoPulseRing {
+public:
+    EchoPulseRing() : head(0), tail(0) {}
+
+    bool push(const EchoPulse& pulse);
+    bool pop(EchoPulse& pulse);
+    void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+    bool isEmpty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    EchoPulse slots[ECHO_RING_SIZE];
+    std::atomic<uint8_t> head;  // Written by producer
+    std::atomic<uint8_t> tail;  // Written by consumer
+};
+
+// Echo timing state machine, fed by edges from a capture HAL.
+// Platform independent so it can be driven by a simulated edge source.
+class EchoCapture {
+public:
+    EchoCapture();
+
+    // Prepare for one echo; must be called before the trigger pulse
+    void arm(uint32_t nowCycles, uint32_t timeoutCycles);
+
+    // Edge notification (called from the GPIO interrupt)
+    void onEdge(bool level, uint32_t cycles);
+
+    // Push a timeout result if the deadline has passed (called from the task)
+    bool expire(uint32_t nowCycles);
+
+    // Fetch the next completed pulse
+    bool pop(EchoPulse& pulse) { return ring.pop(pulse); }
+
+    bool isArmed() const { return state.load(std::memory_order_acquire) != STATE_IDLE; }
+
+private:
+    enum State {
+        STATE_IDLE = 0,
+        STATE_ARMED = 1,      // Waiting for rising edge
+        STATE_IN_PULSE = 2    // Waiting for falling edge
+    };
+
+    std::atomic<uint8_t> state;
+    volatile uint32_t armCycles;
+    volatile uint32_t riseCycles;
+    volatile uint32_t timeoutCycles;
+    EchoPulseRing ring;
+
+    bool complete(uint8_t expected, uint32_t widthCycles, uint8_t status);
+};
+
+// Hardware abstraction for the capture engine: trigger output, edge source,
+// cycle counter and a way to give up the CPU while the echo is in flight.
+class EchoCaptureHal {
+public:
+    virtual ~EchoCaptureHal() {}
+
+    virtual bool begin(EchoCapture* capture) = 0;
+    virtual void end() = 0;
+    virtual void trigger() = 0;
+    virtual uint32_t cycleCount() const = 0;
+    virtual uint32_t cyclesPerUs() const = 0;
+    virtual void waitMs(uint32_t ms) = 0;
+    virtual bool echoLevel() const = 0;     // Echo pin is HIGH (module still listening)
+};
+
+// GPIO edge-interrupt implementation (ESP32 / ESP8266)
+class GpioEchoCaptureHal : public EchoCaptureHal {
+public:
+    GpioEchoCaptureHal(uint8_t trigPin, uint8_t echoPin);
+
+    bool begin(EchoCapture* capture) override;
+    void end() override;
+    void trigger() override;
+    uint32_t cycleCount() const override;
+    uint32_t cyclesPerUs() const override;
+    void waitMs(uint32_t ms) override;
+    bool echoLevel() const override;
+
+private:
+    uint8_t trigPin;
+    uint8_t echoPin;
+    EchoCapture* capture;
+
+    static void onEchoEdge(void* arg);
+};
+
+#endif // ECHO_CAPTURE_H
@@ -0,0 +1,98 @@
+// GPIO edge-interrupt backend for the echo capture engine
+#include "echo_capture.h"
+#include "config.h"
+
+#if !defined(ARDUINO)
+    #include <Arduino.h>    // Host build: the native test stand-in
+#elif !defined(ESP8266)
+    #include <soc/gpio_struct.h>
+#endif
+
+#if defined(ARDUINO)
+// Xtensa cycle counter (ESP8266, ESP32 and ESP32-S2 are all Xtensa cores)
+static inline uint32_t ECHO_ISR_ATTR readCycleCount() {
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+    return ccount;
+}
+
+// Direct register read - digitalRead() is not guaranteed to be in IRAM
+static inline bool ECHO_ISR_ATTR readEchoLevel(uint8_t pin) {
+    #ifdef ESP8266
+        return pin < 16 ? (GPI & (1UL << pin)) != 0 : (GP16I & 0x01) != 0;
+    #else
+        return pin < 32 ? ((GPIO.in >> pin) & 0x1) != 0
+                        : ((GPIO.in1.val >> (pin - 32)) & 0x1) != 0;
+    #endif
+}
+#else
+// Host build: no cycle counter or GPIO registers (tests plug in their own HAL)
+static inline uint32_t readCycleCount() {
+    return micros();
+}
+
+static inline bool readEchoLevel(uint8_t pin) {
+    return digitalRead(pin) == HIGH;
+}
+#endif
+
+GpioEchoCaptureHal::GpioEchoCaptureHal(uint8_t trigPin, uint8_t echoPin)
+    : trigPin(trigPin), echoPin(echoPin), capture(nullptr) {
+}
+
+bool GpioEchoCaptureHal::begin(EchoCapture* capture) {
+    this->capture = capture;
+
+    pinMode(trigPin, OUTPUT);
+    pinMode(echoPin, INPUT);
+    digitalWrite(trigPin, LOW);
+
+    attachInterruptArg(digitalPinToInterrupt(echoPin), onEchoEdge, this, CHANGE);
+    return true;
+}
+
+void GpioEchoCaptureHal::end() {
+    detachInterrupt(digitalPinToInterrupt(echoPin));
+    capture = nullptr;
+}
+
+void GpioEchoCaptureHal::trigger() {
+    // Send 10μs pulse
+    digitalWrite(trigPin, LOW);
+    delayMicroseconds(2);
+    digitalWrite(trigPin, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(trigPin, LOW);
+}
+
+uint32_t GpioEchoCaptureHal::cycleCount() const {
+    return readCycleCount();
+}
+
+uint32_t GpioEchoCaptureHal::cyclesPerUs() const {
+    #if defined(ESP8266)
+        return ESP.getCpuFreqMHz();
+    #elif defined(ARDUINO)
+        return getCpuFrequencyMhz();
+    #else
+        return 1;   // Host: micros()
+    #endif
+}
+
+void GpioEchoCaptureHal::waitMs(uint32_t ms) {
+    // delay() yields to the scheduler on both platforms
+    delay(ms);
+}
+
+bool GpioEchoCaptureHal::echoLevel() const {
+    return readEchoLevel(echoPin);
+}
+
+void ECHO_ISR_ATTR GpioEchoCaptureHal::onEchoEdge(void* arg) {
+    GpioEchoCaptureHal* hal = static_cast<GpioEchoCaptureHal*>(arg);
+    uint32_t now = readCycleCount();
+
+    if (hal->capture) {
+        hal->capture->onEdge(readEchoLevel(hal->echoPin), now);
+    }
+}
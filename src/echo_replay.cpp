@@ -0,0 +1,70 @@
+#include "echo_replay.h"
+#include "config.h"
+
+ReplayEchoCaptureHal::ReplayEchoCaptureHal(EchoTraceSource* source)
+    : source(source), capture(nullptr), nowUs(0), riseUs(0), fallUs(0),
+      risePending(false), fallPending(false), lineHigh(false), exhausted(false), pings(0), ignoredTriggers(0) {
+    current.timeMs = 0;
+    current.durationUs = 0;
+    current.status = ECHO_TIMEOUT;
+    current.truthMm = 0;
+}
+
+bool ReplayEchoCaptureHal::begin(EchoCapture* capture) {
+    this->capture = capture;
+    return source != nullptr;
+}
+
+void ReplayEchoCaptureHal::trigger() {
+    if (lineHigh) {
+        // The module ignores triggers until it drops the echo pin
+        ignoredTriggers++;
+        return;
+    }
+    risePending = false;
+    fallPending = false;
+    
+    if (!source || !source->next(current)) {
+        // Past the end the sensor simply stops answering
+        exhausted = true;
+        current.status = ECHO_TIMEOUT;
+        current.durationUs = 0;
+        current.truthMm = 0;
+        return;
+    }
+    pings++;
+    
+    // A timeout has no edges; an expired window falls only when the
+    // module gives up, long after the sensor stopped listening
+    if (current.status != ECHO_TIMEOUT) {
+        riseUs = nowUs + REPLAY_RISE_DELAY_US;
+        risePending = true;
+        fallUs = current.status == ECHO_OK ? riseUs + current.durationUs
+                                           : nowUs + SENSOR_MODULE_TIMEOUT_US;
+        fallPending = true;
+    }
+}
+
+void ReplayEchoCaptureHal::waitMs(uint32_t ms) {
+    nowUs += ms * 1000;
+    deliverEdges();
+}
+
+void ReplayEchoCaptureHal::deliverEdges() {
+    if (!capture) {
+        return;
+    }
+    
+    // Same as the ISR: edges are stamped with the time they happened,
+    // whenever the task next looks
+    if (risePending && (int32_t)(nowUs - riseUs) >= 0) {
+        risePending = false;
+        lineHigh = true;
+        capture->onEdge(true, riseUs);
+    }
+    if (!risePending && fallPending && (int32_t)(nowUs - fallUs) >= 0) {
+        fallPending = false;
+        lineHigh = false;
+        capture->onEdge(false, fallUs);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef ECHO_REPLAY_H
+#define ECHO_REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "echo_capture.h"
+#include "echo_trace.h"
+
+// Trigger to rising edge of a replayed echo (the JSN-SR04T answers in ~0.5 ms)
+#define REPLAY_RISE_DELAY_US 500
+
+// Supplies recorded pings in order
+class EchoTraceSource {
+public:
+    virtual ~EchoTraceSource() {}
+    
+    // Next ping; false once the trace is exhausted
+    virtual bool next(EchoTraceRecord& record) = 0;
+};
+
+// Pings held in memory (e.g. parsed from a trace file)
+class MemoryTraceSource : public EchoTraceSource {
+public:
+    MemoryTraceSource(const EchoTraceRecord* records, size_t count)
+        : records(records), count(count), position(0) {}
+    
+    bool next(EchoTraceRecord& record) override {
+        if (position >= count) {
+            return false;
+        }
+        record = records[position++];
+        return true;
+    }
+    
+    void rewind() { position = 0; }
+
+private:
+    const EchoTraceRecord* records;
+    size_t count;
+    size_t position;
+};
+
+/**
+ * Capture backend that plays a recorded trace instead of listening to GPIO.
+ *
+ * Each trigger takes the next ping and schedules its edges on a virtual
+ * microsecond clock relative to the trigger. A ping whose window expired
+ * keeps the echo pin HIGH until the module's own timeout, as on the device. The clock only moves when the
+ * sensor waits, so edges land in the same order relative to the echo window
+ * as they did on the device (recorded timestamps are kept for reference).
+ * Plugged into UltrasonicSensor::setCaptureHal(), replayed pings run through
+ * the unchanged burst path: window expiry, clutter and Hampel rejection,
+ * consensus, median filter and level conversion. On a host, drive the burst
+ * with beginBurst() / pollPing() / endBurst() and settle with waitMs(), as
+ * test_echo_replay does; readDistance() settles with delay(), which does not
+ * move the replay clock.
+ */
+class ReplayEchoCaptureHal : public EchoCaptureHal {
+public:
+    ReplayEchoCaptureHal(EchoTraceSource* source);
+    
+    bool begin(EchoCapture* capture) override;
+    void end() override { capture = nullptr; }
+    void trigger() override;
+    uint32_t cycleCount() const override { return nowUs; }
+    uint32_t cyclesPerUs() const override { return 1; }   // Virtual clock counts µs
+    void waitMs(uint32_t ms) override;
+    bool echoLevel() const override { return lineHigh; }
+    
+    // The ping last triggered (for scoring against truthMm)
+    const EchoTraceRecord& getLastRecord() const { return current; }
+    bool isExhausted() const { return exhausted; }
+    uint32_t getPingCount() const { return pings; }
+    uint32_t getIgnoredTriggers() const { return ignoredTriggers; }   // Fired while the pin was held
+
+private:
+    EchoTraceSource* source;
+    EchoCapture* capture;
+    EchoTraceRecord current;
+    uint32_t nowUs;
+    uint32_t riseUs;
+    uint32_t fallUs;
+    bool risePending;
+    bool fallPending;
+    bool lineHigh;
+    bool exhausted;
+    uint32_t pings;
+    uint32_t ignoredTriggers;
+    
+    void deliverEdges();
+};
+
+#endif // ECHO_REPLAY_H
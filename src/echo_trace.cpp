@@ -0,0 +1,131 @@
+#include "echo_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+EchoTraceParser::EchoTraceParser() {
+    reset();
+}
+
+void EchoTraceParser::reset() {
+    memset(&header, 0, sizeof(header));
+    records = 0;
+    skipped = 0;
+}
+
+bool EchoTraceParser::parseLine(const char* line, EchoTraceRecord& record) {
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    
+    if (*line == '#') {
+        parseHeader(line + 1);
+        return false;
+    }
+    
+    // Pings start with their timestamp; anything else is log noise
+    if (*line < '0' || *line > '9') {
+        if (*line != '\0' && *line != '\r' && *line != '\n') {
+            skipped++;
+        }
+        return false;
+    }
+    
+    char* end;
+    unsigned long timeMs = strtoul(line, &end, 10);
+    char* next;
+    unsigned long status = strtoul(end, &next, 10);
+    if (next == end || status > 2) {
+        skipped++;
+        return false;
+    }
+    unsigned long durationUs = strtoul(next, &end, 10);
+    if (end == next) {
+        skipped++;
+        return false;
+    }
+    unsigned long truthMm = strtoul(end, &next, 10); // Optional, 0 when absent
+    
+    record.timeMs = (uint32_t)timeMs;
+    record.status = (uint8_t)status;
+    record.durationUs = status == 0 ? (uint32_t)durationUs : 0;
+    record.truthMm = (uint16_t)(truthMm > UINT16_MAX ? 0 : truthMm);
+    records++;
+    return true;
+}
+
+void EchoTraceParser::parseHeader(const char* text) {
+    // Space separated key=value pairs; unknown keys and free text are ignored
+    while (*text) {
+        while (*text == ' ' || *text == '\t') {
+            text++;
+        }
+        
+        const char* equals = text;
+        while (*equals && *equals != '=' && *equals != ' ') {
+            equals++;
+        }
+        if (*equals != '=') {
+            text = *equals ? equals + 1 : equals;
+            continue;
+        }
+        
+        size_t keyLength = equals - text;
+        const char* value = equals + 1;
+        if (keyLength == 4 && strncmp(text, "tank", 4) == 0) {
+            header.tank = (uint8_t)strtoul(value, nullptr, 10);
+        } else if (keyLength == 8 && strncmp(text, "empty_mm", 8) == 0) {
+            header.emptyMm = (uint16_t)strtoul(value, nullptr, 10);
+        } else if (keyLength == 7 && strncmp(text, "full_mm", 7) == 0) {
+            header.fullMm = (uint16_t)strtoul(value, nullptr, 10);
+        } else if (keyLength == 10 && strncmp(text, "timeout_us", 10) == 0) {
+            header.timeoutUs = (uint32_t)strtoul(value, nullptr, 10);
+        } else if (keyLength == 6 && strncmp(text, "temp_c", 6) == 0) {
+            float celsius = strtof(value, nullptr);
+            header.celsiusTenths = (int16_t)(celsius * 10.0f + (celsius < 0 ? -0.5f : 0.5f));
+            header.hasTemperature = true;
+        }
+        
+        text = value;
+        while (*text && *text != ' ') {
+            text++;
+        }
+    }
+}
+
+size_t EchoTraceParser::formatRecord(char* line, size_t size, const EchoTraceRecord& record) {
+    int length = record.truthMm > 0
+        ? snprintf(line, size, "%lu %u %lu %u\n", (unsigned long)record.timeMs, record.status,
+                   (unsigned long)record.durationUs, record.truthMm)
+        : snprintf(line, size, "%lu %u %lu\n", (unsigned long)record.timeMs, record.status,
+                   (unsigned long)record.durationUs);
+    return length < 0 ? 0 : ((size_t)length < size ? (size_t)length : size - 1);
+}
+
+size_t EchoTraceParser::formatHeader(char* text, size_t size, const EchoTraceHeader& header) {
+    int length;
+    if (header.hasTemperature) {
+        int tenths = abs(header.celsiusTenths);
+        length = snprintf(text, size, "# echo-trace v1\n# tank=%u empty_mm=%u full_mm=%u timeout_us=%lu temp_c=%s%d.%d\n",
+                          header.tank, header.emptyMm, header.fullMm, (unsigned long)header.timeoutUs,
+                          header.celsiusTenths < 0 ? "-" : "", tenths / 10, tenths % 10);
+    } else {
+        length = snprintf(text, size, "# echo-trace v1\n# tank=%u empty_mm=%u full_mm=%u timeout_us=%lu\n",
+                          header.tank, header.emptyMm, header.fullMm, (unsigned long)header.timeoutUs);
+    }
+    return length < 0 ? 0 : ((size_t)length < size ? (size_t)length : size - 1);
+}
+
+#if defined(ARDUINO)
+void StreamTraceSink::begin(const EchoTraceHeader& header) {
+    char text[ECHO_TRACE_LINE_SIZE * 2];
+    EchoTraceParser::formatHeader(text, sizeof(text), header);
+    out.print(text);
+}
+
+void StreamTraceSink::record(const EchoTraceRecord& record) {
+    char line[ECHO_TRACE_LINE_SIZE];
+    EchoTraceParser::formatRecord(line, sizeof(line), record);
+    out.print(line);
+}
+#endif
@@ -0,0 +1,95 @@
+#ifndef ECHO_TRACE_H
+#define ECHO_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Longest trace line the parser accepts (header lines included)
+#define ECHO_TRACE_LINE_SIZE 96
+
+// One recorded ping
+struct EchoTraceRecord {
+    uint32_t timeMs;        // Trigger time (millis() on the recording device)
+    uint32_t durationUs;    // Echo pulse width; 0 unless status is ECHO_OK
+    uint8_t status;         // EchoStatus (0 echo, 1 timeout, 2 window expired)
+    uint16_t truthMm;       // Reference distance for synthetic traces, 0 = unknown
+};
+
+// Recording conditions (0 = not stated in the trace)
+struct EchoTraceHeader {
+    uint8_t tank;
+    uint16_t emptyMm;
+    uint16_t fullMm;
+    uint32_t timeoutUs;
+    int16_t celsiusTenths;
+    bool hasTemperature;
+};
+
+/**
+ * Text format for recorded ultrasonic pings.
+ *
+ *     # echo-trace v1
+ *     # tank=1 empty_mm=2000 full_mm=100 timeout_us=13411 temp_c=18.5
+ *     <time_ms> <status> <duration_us> [truth_mm]
+ *
+ * One ping per line, as captured from the sensor: an echo carries its pulse
+ * width, a timeout (no answer) or an expired window (answer, no echo) carries
+ * 0. Synthetic traces may add the true distance so replayed readings can be
+ * scored. "# key=value" lines set the header; any other line is skipped, so a
+ * raw serial log with debug output interleaved replays as captured.
+ *
+ * Platform independent so traces can be parsed and replayed on a host.
+ */
+class EchoTraceParser {
+public:
+    EchoTraceParser();
+    
+    void reset();
+    
+    // Parse one line (without or with its newline); true when it was a ping
+    bool parseLine(const char* line, EchoTraceRecord& record);
+    
+    const EchoTraceHeader& getHeader() const { return header; }
+    
+    // Lifetime counters
+    uint32_t getRecordCount() const { return records; }
+    uint32_t getSkippedLines() const { return skipped; }
+    
+    // Format one ping / the header lines; return the length written
+    static size_t formatRecord(char* line, size_t size, const EchoTraceRecord& record);
+    static size_t formatHeader(char* text, size_t size, const EchoTraceHeader& header);
+
+private:
+    EchoTraceHeader header;
+    uint32_t records;
+    uint32_t skipped;
+    
+    void parseHeader(const char* text);
+};
+
+// Receives pings as they are measured (see UltrasonicSensor::setTraceSink)
+class EchoTraceSink {
+public:
+    virtual ~EchoTraceSink() {}
+    
+    virtual void begin(const EchoTraceHeader& header) = 0;
+    virtual void record(const EchoTraceRecord& record) = 0;
+};
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+
+// Writes the trace to a stream (e.g. Serial) for capture with a terminal logger
+class StreamTraceSink : public EchoTraceSink {
+public:
+    StreamTraceSink(Print& out) : out(out) {}
+    
+    void begin(const EchoTraceHeader& header) override;
+    void record(const EchoTraceRecord& record) override;
+
+private:
+    Print& out;
+};
+#endif
+
+#endif // ECHO_TRACE_H
@@ -0,0 +1,67 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// FIXED-POINT MEASUREMENT UNITS
+// ============================================================================
+// The measurement pipeline (echo -> distance -> level -> thresholds) runs in
+// integers so FPU-less targets (ESP8266) do not pay for soft-float calls.
+// Float conversions belong at the edges: configuration, display and JSON.
+
+typedef uint16_t DistanceMm;    // Sensor to water surface, millimetres
+typedef int16_t CentiPercent;   // Level in 0.01 % steps (0..10000)
+
+#define CENTI_PERCENT_FULL 10000
+
+// Compile-time conversion of percent constants (folded by the compiler)
+#define PERCENT_TO_CENTI(p) ((CentiPercent)((p) * 100 + 0.5))
+
+// Edge conversions
+inline CentiPercent percentToCenti(float percent) {
+    if (percent <= 0) return 0;
+    if (percent >= 100) return CENTI_PERCENT_FULL;
+    return (CentiPercent)(percent * 100.0f + 0.5f);
+}
+
+inline float centiToPercent(int32_t centi) {
+    return centi / 100.0f;
+}
+
+inline DistanceMm cmToMm(float cm) {
+    if (cm <= 0) return 0;
+    if (cm >= 6553.5f) return UINT16_MAX;
+    return (DistanceMm)(cm * 10.0f + 0.5f);
+}
+
+inline float mmToCm(int32_t mm) {
+    return mm / 10.0f;
+}
+
+// Format a value with implied decimals (1234, 2 -> "12.34") without
+// going through printf's float formatting
+inline char* formatFixed(char* buffer, size_t size, int32_t value, uint8_t decimals) {
+    char digits[12];
+    uint8_t n = 0;
+    bool negative = value < 0;
+    uint32_t magnitude = negative ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    
+    do {
+        digits[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0 || n <= decimals);
+    
+    size_t pos = 0;
+    if (negative && pos + 1 < size) buffer[pos++] = '-';
+    while (n > 0 && pos + 1 < size) {
+        if (n == decimals && pos + 1 < size) buffer[pos++] = '.';
+        if (pos + 1 < size) buffer[pos++] = digits[--n];
+    }
+    buffer[pos] = '\0';
+    
+    return buffer;
+}
+
+#endif // FIXED_POINT_H
@@ -0,0 +1,54 @@
+#include "jsn_frame_parser.h"
+
+JsnFrameParser::JsnFrameParser()
+    : length(0), distanceMm(0), frames(0), checksumErrors(0), droppedBytes(0) {
+}
+
+bool JsnFrameParser::feed(uint8_t byte) {
+    // Hunt for the header between frames
+    if (length == 0 && byte != JSN_FRAME_HEADER) {
+        droppedBytes++;
+        return false;
+    }
+    
+    buffer[length++] = byte;
+    if (length < JSN_FRAME_SIZE) {
+        return false;
+    }
+    
+    uint8_t sum = (uint8_t)(buffer[0] + buffer[1] + buffer[2]);
+    if (sum != buffer[3]) {
+        checksumErrors++;
+        resync();
+        return false;
+    }
+    
+    distanceMm = ((uint16_t)buffer[1] << 8) | buffer[2];
+    frames++;
+    length = 0;
+    return true;
+}
+
+size_t JsnFrameParser::feed(const uint8_t* data, size_t count) {
+    size_t completed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (feed(data[i])) {
+            completed++;
+        }
+    }
+    return completed;
+}
+
+void JsnFrameParser::resync() {
+    // Restart from the next buffered header, if any
+    uint8_t start = 1;
+    while (start < length && buffer[start] != JSN_FRAME_HEADER) {
+        start++;
+    }
+    
+    droppedBytes += start;
+    for (uint8_t i = start; i < length; i++) {
+        buffer[i - start] = buffer[i];
+    }
+    length -= start;
+}
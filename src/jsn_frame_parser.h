@@ -0,0 +1,55 @@
+#ifndef JSN_FRAME_PARSER_H
+#define JSN_FRAME_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// JSN-SR04T serial frame: 0xFF, distance high, distance low, checksum
+#define JSN_FRAME_HEADER    0xFF
+#define JSN_FRAME_SIZE      4
+
+/**
+ * Incremental parser for JSN-SR04T serial output (modes 2 and 3).
+ *
+ * Bytes are fed one at a time as they arrive in the RX buffer; nothing
+ * blocks and no byte is consumed twice. The checksum is the low byte of
+ * header + high + low. When a frame fails the checksum the parser
+ * resynchronises on the next 0xFF already buffered, so a distance byte
+ * that happens to be 0xFF cannot lock it out of step.
+ *
+ * Platform independent so it can be fed captured byte streams on a host.
+ */
+class JsnFrameParser {
+public:
+    JsnFrameParser();
+    
+    // Feed one byte; true when it completed a valid frame
+    bool feed(uint8_t byte);
+    
+    // Feed a buffer; returns the number of valid frames it completed
+    // (the last distance is kept)
+    size_t feed(const uint8_t* data, size_t count);
+    
+    void reset() { length = 0; }
+    
+    // Distance of the last valid frame (0 = module saw no echo)
+    uint16_t getDistanceMm() const { return distanceMm; }
+    
+    // Lifetime counters
+    uint32_t getFrameCount() const { return frames; }
+    uint32_t getChecksumErrors() const { return checksumErrors; }
+    uint32_t getDroppedBytes() const { return droppedBytes; }
+    
+private:
+    uint8_t buffer[JSN_FRAME_SIZE];
+    uint8_t length;
+    uint16_t distanceMm;
+    
+    uint32_t frames;
+    uint32_t checksumErrors;
+    uint32_t droppedBytes;
+    
+    void resync();
+};
+
+#endif // JSN_FRAME_PARSER_H
@@ -0,0 +1,71 @@
+#include "jsn_uart_sensor.h"
+#include "config.h"
+
+JsnUartSensor::JsnUartSensor(uint8_t uart, uint8_t rxPin, uint8_t txPin, bool controlled, 
+                             float emptyCm, float fullCm)
+    : LevelSensor(emptyCm, fullCm), uart(uart), rxPin(rxPin), txPin(txPin), 
+      controlled(controlled),
+      #ifdef ESP8266
+      serial(rxPin, txPin),
+      #else
+      serial(uart),
+      #endif
+      stream(&serial), pingStartMs(0) {
+}
+
+bool JsnUartSensor::begin() {
+    #ifdef ESP8266
+        serial.begin(JSN_UART_BAUD);
+    #else
+        #ifdef SOC_UART_NUM
+        if (uart == 0 || uart >= SOC_UART_NUM) {
+            DEBUG_PRINTF("JSN UART sensor: UART%d not available\n", uart);
+            return false;
+        }
+        #endif
+        serial.begin(JSN_UART_BAUD, SERIAL_8N1, rxPin, txPin);
+    #endif
+    
+    parser.reset();
+    
+    DEBUG_PRINTF("JSN UART sensor initialized (RX: %d, TX: %d, %s mode)\n", 
+                 rxPin, txPin, controlled ? "controlled" : "auto");
+    return true;
+}
+
+void JsnUartSensor::startPing() {
+    // Anything already buffered predates this ping; parse it to stay in
+    // frame sync but do not use it
+    while (stream->available() > 0) {
+        parser.feed((uint8_t)stream->read());
+    }
+    
+    if (controlled) {
+        stream->write((uint8_t)JSN_UART_TRIGGER);
+    }
+    pingStartMs = millis();
+}
+
+bool JsnUartSensor::pollPing() {
+    while (stream->available() > 0) {
+        if (parser.feed((uint8_t)stream->read())) {
+            // The module reports 0 when it heard no echo
+            DistanceMm distance = parser.getDistanceMm();
+            recordPing(distance > 0 ? PING_ECHO : PING_NO_ECHO, distance);
+            return true;
+        }
+    }
+    
+    if (millis() - pingStartMs >= JSN_UART_TIMEOUT_MS) {
+        parser.reset(); // A partial frame belongs to no ping
+        recordPing(PING_NO_RESPONSE);
+        return true;
+    }
+    
+    return false;
+}
+
+void JsnUartSensor::setStream(Stream* stream) {
+    this->stream = stream ? stream : &serial;
+    parser.reset();
+}
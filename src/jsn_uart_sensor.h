@@ -0,0 +1,61 @@
+#ifndef JSN_UART_SENSOR_H
+#define JSN_UART_SENSOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "level_sensor.h"
+#include "jsn_frame_parser.h"
+
+#ifdef ESP8266
+    #include <SoftwareSerial.h>
+#endif
+
+/**
+ * JSN-SR04T in serial output mode.
+ *
+ * The module times its own echo and sends 4-byte frames, either
+ * continuously (auto mode) or in answer to a 0x55 request (controlled
+ * mode). Pings are serviced by draining the RX buffer into the frame
+ * parser, so the CPU does no echo timing at all.
+ */
+class JsnUartSensor : public LevelSensor {
+public:
+    // uart selects the hardware port on ESP32 (ignored on ESP8266, which
+    // uses a software serial port on the same pins)
+    JsnUartSensor(uint8_t uart, uint8_t rxPin, uint8_t txPin, bool controlled, 
+                  float emptyCm, float fullCm);
+    
+    // Initialize sensor
+    bool begin() override;
+    
+    // One frame request/wait
+    void startPing() override;
+    bool pollPing() override;
+    
+    uint32_t getTimeout() const override { return JSN_UART_TIMEOUT_MS * 1000UL; }
+    uint8_t getDriver() const override { return controlled ? DRIVER_UART_CONTROLLED : DRIVER_UART_AUTO; }
+    
+    // Frame statistics
+    const JsnFrameParser& getParser() const { return parser; }
+    
+    // Replace the serial port (e.g. with a captured byte stream)
+    void setStream(Stream* stream);
+    
+private:
+    uint8_t uart;
+    uint8_t rxPin;
+    uint8_t txPin;
+    bool controlled;
+    
+    #ifdef ESP8266
+    SoftwareSerial serial;
+    #else
+    HardwareSerial serial;
+    #endif
+    Stream* stream;
+    
+    JsnFrameParser parser;
+    uint32_t pingStartMs;
+};
+
+#endif // JSN_UART_SENSOR_H
@@ -0,0 +1,87 @@
+#include "level_estimator.h"
+#include "config.h"
+
+LevelEstimator::LevelEstimator()
+    : level(0), rate(0), p00(0), p01(0), p11(0),
+      processNoise(KALMAN_PROCESS_NOISE),
+      measurementNoise(KALMAN_MEASUREMENT_NOISE),
+      lastTimestamp(0),
+      initialized(false) {
+}
+
+void LevelEstimator::setNoise(float processNoise, float measurementNoise) {
+    if (processNoise > 0) this->processNoise = processNoise;
+    if (measurementNoise > 0) this->measurementNoise = measurementNoise;
+}
+
+void LevelEstimator::reset() {
+    initialized = false;
+}
+
+void LevelEstimator::initialize(float measuredLevel, uint32_t timestamp) {
+    level = measuredLevel;
+    rate = 0;
+    p00 = measurementNoise;
+    p01 = 0;
+    p11 = KALMAN_INITIAL_RATE_VAR;
+    lastTimestamp = timestamp;
+    initialized = true;
+}
+
+void LevelEstimator::update(SensorReading& reading) {
+    if (!reading.isValid) {
+        return;
+    }
+    
+    float z = centiToPercent(reading.levelCenti);
+    
+    if (!initialized) {
+        initialize(z, reading.timestamp);
+    } else {
+        float dt = (reading.timestamp - lastTimestamp) / 1000.0f;
+        lastTimestamp = reading.timestamp;
+        
+        // Predict: x = F x, P = F P F' + Q
+        float q = processNoise;
+        level += rate * dt;
+        p00 += dt * (2.0f * p01 + dt * p11) + q * dt * dt * dt / 3.0f;
+        p01 += dt * p11 + q * dt * dt / 2.0f;
+        p11 += q * dt;
+        
+        // Update with the measured level
+        float innovation = z - level;
+        float s = p00 + measurementNoise;
+        
+        if (innovation * innovation > KALMAN_RESET_SIGMA * KALMAN_RESET_SIGMA * s) {
+            // Far outside the model (recalibration, sensor swap) - restart
+            #if DEBUG_SENSOR
+            DEBUG_PRINTF("Kalman: innovation %.1f%% too large, re-initializing\n", innovation);
+            #endif
+            initialize(z, reading.timestamp);
+        } else {
+            float k0 = p00 / s;
+            float k1 = p01 / s;
+            
+            level += k0 * innovation;
+            rate += k1 * innovation;
+            
+            p11 -= k1 * p01;
+            p01 *= (1.0f - k0);
+            p00 *= (1.0f - k0);
+        }
+    }
+    
+    reading.filteredCenti = percentToCenti(level);
+    reading.rateCentiPerMin = (int16_t)constrain(lroundf(getRatePerMin() * 100.0f), -32767L, 32767L);
+    reading.confidence = (uint8_t)(getConfidence() + 0.5f);
+}
+
+float LevelEstimator::getConfidence() const {
+    if (!initialized) {
+        return 0;
+    }
+    
+    // 50% when the estimate is as uncertain as a single raw reading,
+    // approaching 100% as the covariance shrinks below it
+    return 100.0f * measurementNoise / (measurementNoise + p00);
+}
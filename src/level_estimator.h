@@ -0,0 +1,48 @@
+#ifndef LEVEL_ESTIMATOR_H
+#define LEVEL_ESTIMATOR_H
+
+#include <Arduino.h>
+#include "level_sensor.h"
+
+/**
+ * Constant-velocity Kalman filter on tank level.
+ *
+ * State is [level %, rate %/s]. Process noise models random changes in
+ * fill/drain rate (white acceleration), measurement noise is the variance
+ * of the median-filtered level. Fills the filtered level, rate and
+ * confidence fields of each valid SensorReading.
+ *
+ * This is the one float stage in the measurement pipeline: the covariance
+ * terms span too many decades for a single Q format, and it runs once per
+ * reading. Inputs and outputs are the fixed-point reading fields.
+ */
+class LevelEstimator {
+public:
+    LevelEstimator();
+    
+    // Noise configuration (process: %²/s³, measurement: %²)
+    void setNoise(float processNoise, float measurementNoise);
+    
+    // Feed a reading and annotate it with the estimate
+    void update(SensorReading& reading);
+    void reset();
+    
+    // Current estimate
+    bool isInitialized() const { return initialized; }
+    float getLevel() const { return level; }
+    float getRatePerMin() const { return rate * 60.0f; }
+    float getConfidence() const;
+    
+private:
+    float level;        // %
+    float rate;         // %/s
+    float p00, p01, p11; // Covariance (symmetric)
+    float processNoise;
+    float measurementNoise;
+    uint32_t lastTimestamp;
+    bool initialized;
+    
+    void initialize(float measuredLevel, uint32_t timestamp);
+};
+
+#endif // LEVEL_ESTIMATOR_H
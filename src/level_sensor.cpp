@@ -0,0 +1,338 @@
+#include "level_sensor.h"
+#include "config.h"
+#include <string.h>
+
+struct FilterProfileParams {
+    uint8_t window;
+    float hampelK;
+    int32_t hampelMinMm;
+};
+
+static const FilterProfileParams FILTER_PROFILES[FILTER_PROFILE_COUNT] = {
+    { SENSOR_FILTER_WINDOW, SENSOR_HAMPEL_K, SENSOR_HAMPEL_MIN_MM },   // Rest
+    { FILL_FILTER_WINDOW,   FILL_HAMPEL_K,   FILL_HAMPEL_MIN_MM }      // Filling
+};
+
+LevelSensor::LevelSensor(float emptyCm, float fullCm)
+    : emptyMm(cmToMm(emptyCm)), fullMm(cmToMm(fullCm)),
+      sampleCount(SENSOR_SAMPLES),
+      consensusK(SENSOR_CONSENSUS_K), consensusToleranceMm(SENSOR_CONSENSUS_TOL_MM),
+      maxPings(SENSOR_CONSENSUS_MAX_PINGS), recentHead(0), recentCount(0),
+      totalPings(0), totalBursts(0),
+      filter(SENSOR_FILTER_WINDOW), filterProfile(FILTER_PROFILE_REST), clutterEnabled(true), consecutiveClutter(0), clutterRejects(0),
+      burstPings(0), burstEchoes(0), burstWindowMisses(0), validSamples(0),
+      noResponseCount(0), noEchoCount(0),
+      consecutiveErrors(0) {
+    
+    memset(profileStats, 0, sizeof(profileStats));
+    filter.setHampel(true, SENSOR_HAMPEL_K, SENSOR_HAMPEL_MIN_MM);
+    profileStats[FILTER_PROFILE_REST].activations = 1;
+    
+    // Prismatic until told otherwise (linear distance to percent)
+    geometryConfig.shape = SHAPE_VERTICAL;
+    geometryConfig.diameterCm = 0;
+    geometryConfig.lengthCm = 0;
+    geometryConfig.coneHeightCm = 0;
+    
+    lastReading.distanceMm = 0;
+    lastReading.volumeDl = 0;
+    lastReading.levelCenti = 0;
+    lastReading.filteredCenti = 0;
+    lastReading.rateCentiPerMin = 0;
+    lastReading.confidence = 0;
+    lastReading.pings = 0;
+    lastReading.isValid = false;
+    lastReading.timestamp = 0;
+    lastReading.errorCode = ERROR_NONE;
+}
+
+SensorReading LevelSensor::readDistance() {
+    beginBurst();
+    
+    // One ping per reading once the filter window is warm
+    while (!burstComplete()) {
+        startPing();
+        while (!pollPing()) {
+            waitMs(1);
+        }
+        
+        delay(SENSOR_SETTLE_MS); // Let the transducer ring down
+    }
+    
+    return endBurst(millis());
+}
+
+void LevelSensor::setFilterProfile(uint8_t profile) {
+    if (profile >= FILTER_PROFILE_COUNT || profile == filterProfile) {
+        return;
+    }
+    
+    const FilterProfileParams& params = FILTER_PROFILES[profile];
+    filter.setWindow(params.window);
+    filter.setHampel(true, params.hampelK, params.hampelMinMm);
+    filterProfile = profile;
+    profileStats[profile].activations++;
+    
+    #if DEBUG_SENSOR
+    DEBUG_PRINTF("Sensor filter: %s profile (window %d)\n",
+                 profile == FILTER_PROFILE_FILLING ? "filling" : "rest", params.window);
+    #endif
+}
+
+void LevelSensor::beginBurst() {
+    burstPings = 0;
+    burstEchoes = 0;
+    burstWindowMisses = 0;
+    validSamples = 0;
+    
+    onBurstStart();
+}
+
+bool LevelSensor::burstComplete() const {
+    if (burstPings >= maxPings) {
+        return true; // Give up on a dead, blocked or noisy sensor
+    }
+    
+    // Keep pinging while the window is still warming up
+    if (filter.size() < SENSOR_FILTER_MIN_FILL) {
+        return false;
+    }
+    
+    if (consensusK > 0) {
+        return validSamples > 0 && hasConsensus(); // Needs a fresh sample that agrees
+    }
+    return burstPings >= sampleCount;
+}
+
+void LevelSensor::recordPing(uint8_t outcome, DistanceMm distance) {
+    burstPings++;
+    
+    if (outcome == PING_NO_ECHO) {
+        burstWindowMisses++;
+        noEchoCount++;
+        return;
+    } else if (outcome != PING_ECHO) {
+        noResponseCount++;
+        return;
+    }
+    burstEchoes++;
+    
+    if (validateDistance(distance) && !(clutterEnabled && rejectClutter(distance))) {
+        // Hampel outliers are counted, not stored, and do not make the
+        // burst's reading fresh
+        if (filter.push(distance)) {
+            validSamples++;
+            profileStats[filterProfile].accepted++;
+        } else {
+            profileStats[filterProfile].rejected++;
+        }
+        
+        // Outliers still count towards consensus: they are disagreement
+        recent[recentHead] = distance;
+        recentHead = (recentHead + 1) % SENSOR_CONSENSUS_MAX_K;
+        if (recentCount < SENSOR_CONSENSUS_MAX_K) recentCount++;
+    }
+}
+
+bool LevelSensor::rejectClutter(DistanceMm distance) {
+    bool warm = filter.size() >= SENSOR_FILTER_MIN_FILL;
+    bool aboveSurface = warm && distance + CLUTTER_GUARD_MM < filter.median();
+    
+    clutter.observe(distance, aboveSurface);
+    
+    // Only returns from above the surface can be clutter; with a cold
+    // window there is no surface yet, so trust the map
+    if (!clutter.isClutter(distance) || (warm && !aboveSurface)) {
+        consecutiveClutter = 0;
+        return false;
+    }
+    
+    // Nothing but "clutter" for a long run: the surface has reached the
+    // fitting, so stop hiding it
+    if (consecutiveClutter < UINT8_MAX) {
+        consecutiveClutter++;
+    }
+    if (consecutiveClutter > CLUTTER_MAX_REJECTS) {
+        return false;
+    }
+    
+    clutterRejects++;
+    return true;
+}
+
+bool LevelSensor::hasConsensus() const {
+    if (recentCount < consensusK) {
+        return false;
+    }
+    
+    // Span of the last k accepted distances (including previous bursts,
+    // so a calm tank needs a single ping that agrees with the history)
+    DistanceMm lo = UINT16_MAX, hi = 0;
+    for (uint8_t i = 0; i < consensusK; i++) {
+        DistanceMm d = recent[(recentHead + SENSOR_CONSENSUS_MAX_K - 1 - i) % SENSOR_CONSENSUS_MAX_K];
+        lo = min(lo, d);
+        hi = max(hi, d);
+    }
+    
+    return hi - lo <= consensusToleranceMm;
+}
+
+SensorReading LevelSensor::endBurst(uint32_t timestamp) {
+    SensorReading reading;
+    reading.timestamp = timestamp;
+    reading.pings = burstPings;
+    
+    totalPings += burstPings;
+    totalBursts++;
+    
+    FilterProfileStats& stats = profileStats[filterProfile];
+    stats.pings += burstPings;
+    
+    // Need a sample accepted into the window this burst and a warm window
+    if (validSamples > 0 && filter.size() >= SENSOR_FILTER_MIN_FILL) {
+        reading.distanceMm = filter.median();
+        reading.levelCenti = distanceToCenti(reading.distanceMm);
+        reading.volumeDl = geometry.isBuilt() ? geometry.distanceToDecilitres(reading.distanceMm) : 0;
+        reading.filteredCenti = reading.levelCenti; // Until an estimator refines it
+        reading.rateCentiPerMin = 0;
+        reading.confidence = 0;
+        reading.isValid = true;
+        reading.errorCode = ERROR_NONE;
+        
+        consecutiveErrors = 0;
+        lastReading = reading;
+        
+        stats.readings++;
+        stats.spreadSumMm += filter.mad();
+        
+        #if DEBUG_SENSOR
+        DEBUG_PRINTF("Sensor reading: %u mm (%d.%02d%%) [%d pings, window %d]\n",
+                     reading.distanceMm, reading.levelCenti / 100, reading.levelCenti % 100,
+                     burstPings, filter.size());
+        #endif
+    } else {
+        // Not enough valid samples
+        reading.distanceMm = 0;
+        reading.levelCenti = 0;
+        reading.volumeDl = 0;
+        reading.filteredCenti = 0;
+        reading.rateCentiPerMin = 0;
+        reading.confidence = 0;
+        reading.isValid = false;
+        if (burstEchoes > 0) {
+            reading.errorCode = ERROR_OUT_OF_RANGE;
+        } else if (burstWindowMisses > 0) {
+            reading.errorCode = ERROR_NO_ECHO;    // Alive, but nothing within range
+        } else {
+            reading.errorCode = ERROR_TIMEOUT;    // Sensor not answering at all
+        }
+        
+        consecutiveErrors++;
+        
+        // Do not resume from a stale window after a long outage
+        if (!isHealthy()) {
+            filter.reset();
+            recentCount = 0;
+        }
+        
+        #if DEBUG_SENSOR
+        DEBUG_PRINTF("Sensor error: %d (valid samples: %d)\n", reading.errorCode, validSamples);
+        #endif
+    }
+    
+    return reading;
+}
+
+bool LevelSensor::validateDistance(DistanceMm distance) const {
+    // Check if distance is within reasonable sensor range (JSN-SR04T: 25-450cm typical)
+    if (distance < 50 || distance > 5000) {
+        return false;
+    }
+    
+    // Check if distance is within calibrated range (with some tolerance)
+    const DistanceMm tolerance = 100; // 10cm tolerance
+    if (distance + tolerance < fullMm || distance > emptyMm + tolerance) {
+        #if DEBUG_SENSOR
+        DEBUG_PRINTF("Distance %u mm out of calibrated range (%u - %u mm)\n",
+                     distance, fullMm, emptyMm);
+        #endif
+        // Still return true, just log the warning
+    }
+    
+    return true;
+}
+
+CentiPercent LevelSensor::distanceToCenti(DistanceMm distance) const {
+    // When distance is small = tank is full (high percentage)
+    // When distance is large = tank is empty (low percentage)
+    
+    if (geometry.isBuilt()) {
+        return geometry.distanceToCenti(distance);
+    }
+    
+    if (distance <= fullMm) {
+        return CENTI_PERCENT_FULL;
+    } else if (distance >= emptyMm) {
+        return 0;
+    }
+    
+    uint32_t range = emptyMm - fullMm;
+    return (CentiPercent)(((uint32_t)(emptyMm - distance) * CENTI_PERCENT_FULL + range / 2) / range);
+}
+
+DistanceMm LevelSensor::centiToDistance(CentiPercent level) const {
+    if (geometry.isBuilt()) {
+        return geometry.centiToDistance(level);
+    }
+    
+    int32_t clamped = constrain((int32_t)level, (int32_t)0, (int32_t)CENTI_PERCENT_FULL);
+    
+    uint32_t range = emptyMm - fullMm;
+    return emptyMm - (DistanceMm)((clamped * range + CENTI_PERCENT_FULL / 2) / CENTI_PERCENT_FULL);
+}
+
+void LevelSensor::setCalibration(float emptyCm, float fullCm) {
+    if (emptyCm > fullCm && emptyCm > 0 && fullCm > 0) {
+        this->emptyMm = cmToMm(emptyCm);
+        this->fullMm = cmToMm(fullCm);
+        DEBUG_PRINTF("Calibration updated: Empty=%.1f cm, Full=%.1f cm\n", emptyCm, fullCm);
+        
+        onCalibrationChanged();
+        
+        // Table heights are relative to the calibration
+        if (geometry.isBuilt()) {
+            geometry.build(geometryConfig, emptyCm, fullCm);
+        }
+    }
+}
+
+void LevelSensor::setGeometry(const TankGeometryConfig& config) {
+    geometryConfig = config;
+    geometry.build(geometryConfig, mmToCm(emptyMm), mmToCm(fullMm));
+}
+
+void LevelSensor::getCalibration(float& emptyCm, float& fullCm) const {
+    emptyCm = mmToCm(this->emptyMm);
+    fullCm = mmToCm(this->fullMm);
+}
+
+void LevelSensor::setSampleCount(uint8_t count) {
+    sampleCount = constrain(count, 1, SENSOR_MAX_SAMPLES);
+}
+
+void LevelSensor::setConsensus(uint8_t k, DistanceMm toleranceMm, uint8_t maxPings) {
+    consensusK = min(k, (uint8_t)SENSOR_CONSENSUS_MAX_K);
+    consensusToleranceMm = toleranceMm;
+    
+    // The cap must leave room to warm the filter and to reach k in one burst
+    if (consensusK > 0) {
+        uint8_t minPings = max((uint8_t)SENSOR_FILTER_MIN_FILL, consensusK);
+        this->maxPings = constrain(maxPings, minPings, (uint8_t)SENSOR_MAX_SAMPLES);
+    } else {
+        this->maxPings = SENSOR_MAX_SAMPLES;
+    }
+}
+
+float LevelSensor::getAveragePings() const {
+    return totalBursts > 0 ? (float)totalPings / totalBursts : 0;
+}
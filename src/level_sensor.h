@@ -0,0 +1,203 @@
+#ifndef LEVEL_SENSOR_H
+#define LEVEL_SENSOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "fixed_point.h"
+#include "median_filter.h"
+#include "tank_geometry.h"
+#include "clutter_map.h"
+
+// Sensor reading structure (fixed point, see fixed_point.h)
+struct SensorReading {
+    DistanceMm distanceMm;
+    CentiPercent levelCenti;    // Raw level (volume %) from the median-filtered distance
+    uint32_t volumeDl;          // Raw volume in dL (0 when tank dimensions are unknown)
+    CentiPercent filteredCenti; // Kalman-filtered level (what consumers should use)
+    int16_t rateCentiPerMin;    // Fill (+) / drain (-) rate, 0.01 %/min
+    uint8_t confidence;         // Estimator confidence, 0-100%
+    uint8_t pings;              // Pings used to produce this reading
+    bool isValid;
+    uint32_t timestamp;
+    uint8_t errorCode;
+};
+
+// Error codes
+enum SensorError {
+    ERROR_NONE = 0,
+    ERROR_TIMEOUT = 1,
+    ERROR_OUT_OF_RANGE = 2,
+    ERROR_HARDWARE = 3,
+    ERROR_NO_ECHO = 4           // Sensor answered but no echo within the expected window
+};
+
+// Filter strength, chosen per tank from its inflow (see TankRegistry::setInflow)
+enum FilterProfile {
+    FILTER_PROFILE_REST = 0,    // SENSOR_FILTER_WINDOW, calm surface
+    FILTER_PROFILE_FILLING = 1, // Short FILL_FILTER_WINDOW, ripple-tolerant rejection
+    FILTER_PROFILE_COUNT = 2
+};
+
+// What a filter profile has done while it was active
+struct FilterProfileStats {
+    uint32_t activations;       // Times the profile was switched to
+    uint32_t readings;          // Valid readings produced
+    uint32_t pings;
+    uint32_t accepted;          // Samples that entered the window
+    uint32_t rejected;          // Hampel outliers
+    uint32_t spreadSumMm;       // Window MAD summed over readings (noise level)
+};
+
+// Sensor driver, selectable per tank
+enum SensorDriver {
+    DRIVER_PULSE = 0,           // Trigger/echo pulse timing
+    DRIVER_UART_AUTO = 1,       // JSN-SR04T streaming serial frames (mode 2)
+    DRIVER_UART_CONTROLLED = 2, // JSN-SR04T serial frame on request (mode 3)
+    DRIVER_PRESSURE = 3,        // Hydrostatic pressure transducer on an ADC pin
+    DRIVER_NONE = 255           // Redundant sensor slot not fitted
+};
+
+/**
+ * Common distance-to-level pipeline for tank sensors.
+ *
+ * A driver only produces raw distance samples through startPing() /
+ * pollPing() and hands each outcome to recordPing(). Calibration, tank
+ * geometry, clutter rejection, the sliding median filter and consensus
+ * sampling are shared, so every driver yields the same kind of reading.
+ */
+class LevelSensor {
+public:
+    LevelSensor(float emptyCm, float fullCm);
+    virtual ~LevelSensor() {}
+    
+    // Initialize sensor
+    virtual bool begin() = 0;
+    
+    // Read distance through the sliding median filter (blocking burst)
+    SensorReading readDistance();
+    
+    // Step-wise burst API, used to interleave pings across sensors
+    void beginBurst();
+    virtual void startPing() = 0;               // Request one distance sample
+    virtual bool pollPing() = 0;                // True once the sample has finished
+    bool burstComplete() const;
+    SensorReading endBurst(uint32_t timestamp); // Filter samples into a reading
+    
+    // Longest wait for one sample (µs)
+    virtual uint32_t getTimeout() const = 0;
+    virtual uint8_t getDriver() const = 0;
+    
+    // Update calibration values
+    void setCalibration(float emptyCm, float fullCm);
+    void getCalibration(float& emptyCm, float& fullCm) const;
+    
+    // Tank shape; percentages become volume fractions instead of height
+    void setGeometry(const TankGeometryConfig& config);
+    const TankGeometry& getGeometry() const { return geometry; }
+    
+    // Convert distance to level
+    CentiPercent distanceToCenti(DistanceMm distance) const;
+    DistanceMm centiToDistance(CentiPercent level) const;
+    
+    // Get last valid reading
+    const SensorReading& getLastReading() const { return lastReading; }
+    
+    // Sensor status
+    bool isHealthy() const { return consecutiveErrors < 5; }
+    uint8_t getErrorCount() const { return consecutiveErrors; }
+    void resetErrorCount() { consecutiveErrors = 0; }
+    
+    // Configuration
+    void setSampleCount(uint8_t count);
+    void setFilterWindow(uint8_t window) { filter.setWindow(window); }
+    
+    // Switch filter strength; the window keeps its samples (shrinking drops
+    // the oldest, growing fills up from new pings)
+    void setFilterProfile(uint8_t profile);
+    uint8_t getFilterProfile() const { return filterProfile; }
+    const FilterProfileStats& getProfileStats(uint8_t profile) const { return profileStats[profile]; }
+    
+    // Consensus sampling: a burst ends once the last k samples agree within
+    // toleranceMm, and is extended up to maxPings while they disagree
+    // (k = 0 falls back to a fixed sampleCount per burst)
+    void setConsensus(uint8_t k, DistanceMm toleranceMm, uint8_t maxPings);
+    float getAveragePings() const;
+    
+    // Lifetime ping outcome counters
+    uint32_t getNoResponseCount() const { return noResponseCount; }  // Sensor did not answer
+    uint32_t getNoEchoCount() const { return noEchoCount; }          // Answered without an echo
+    
+    // Filter state and statistics
+    const SlidingMedianFilter& getFilter() const { return filter; }
+    
+    // Learned false-echo map (persisted with the calibration)
+    ClutterMap& getClutterMap() { return clutter; }
+    const ClutterMap& getClutterMap() const { return clutter; }
+    uint32_t getClutterRejectCount() const { return clutterRejects; }
+
+protected:
+    // Outcome of one ping, reported by the driver
+    enum PingOutcome {
+        PING_ECHO = 0,
+        PING_NO_ECHO = 1,       // Sensor alive, nothing returned in range
+        PING_NO_RESPONSE = 2    // Sensor did not answer at all
+    };
+    
+    void recordPing(uint8_t outcome, DistanceMm distance = 0);
+    
+    // Driver hooks
+    virtual void onBurstStart() {}
+    virtual void onCalibrationChanged() {}
+    virtual void waitMs(uint32_t ms) { delay(ms); }
+    
+    // Drivers without false echoes (e.g. pressure) opt out of the clutter map
+    void setClutterRejection(bool enabled) { clutterEnabled = enabled; }
+    
+    // Calibration
+    DistanceMm emptyMm;  // Distance when tank is empty (sensor to bottom)
+    DistanceMm fullMm;   // Distance when tank is full (sensor to water surface)
+
+private:
+    TankGeometryConfig geometryConfig;
+    TankGeometry geometry;
+    
+    // Sensor parameters
+    uint8_t sampleCount;
+    
+    // Consensus sampling over the most recent accepted distances
+    uint8_t consensusK;
+    DistanceMm consensusToleranceMm;
+    uint8_t maxPings;
+    DistanceMm recent[SENSOR_CONSENSUS_MAX_K];
+    uint8_t recentHead;
+    uint8_t recentCount;
+    uint32_t totalPings;
+    uint32_t totalBursts;
+    
+    // Persistent filter and current burst
+    SlidingMedianFilter filter;
+    uint8_t filterProfile;
+    FilterProfileStats profileStats[FILTER_PROFILE_COUNT];
+    ClutterMap clutter;
+    bool clutterEnabled;
+    uint8_t consecutiveClutter;
+    uint32_t clutterRejects;
+    uint8_t burstPings;
+    uint8_t burstEchoes;
+    uint8_t burstWindowMisses;
+    uint8_t validSamples;       // Accepted into the filter window this burst
+    
+    uint32_t noResponseCount;
+    uint32_t noEchoCount;
+    
+    // State tracking
+    SensorReading lastReading;
+    uint8_t consecutiveErrors;
+    
+    // Internal methods
+    bool hasConsensus() const;
+    bool rejectClutter(DistanceMm distance);
+    bool validateDistance(DistanceMm distance) const;
+};
+
+#endif // LEVEL_SENSOR_H
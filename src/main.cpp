@@ -21,13 +21,17 @@
 
 #include "config.h"
 #include "config_manager.h"
-#include "sensor_ultrasonic.h"
+#include "tank_registry.h"
+#include "acquisition_scheduler.h"
+#include "sampling_policy.h"
+#include "temperature_source.h"
 #include "display_oled.h"
 #include "wifi_ionconnect.h"
 #include "web_server.h"
 #include "mqtt_client.h"
 #include "ble_service.h"
 #include "pump_controller.h"
+#include "diagnostic_stream.h"
 
 // ============================================================================
 // GLOBAL INSTANCES
@@ -40,9 +44,22 @@ WaterLevelBLE bleService(configManager);
 PumpController pumpController(configManager);
 DisplayOLED display;
 
-// Sensors (dynamically allocated based on configuration)
-UltrasonicSensor* sensor1 = nullptr;
-UltrasonicSensor* sensor2 = nullptr;
+// Tanks: sensors (created from configuration), estimators, calibration
+// learning and latest readings, up to MAX_TANKS
+TankRegistry tanks(configManager);
+AcquisitionScheduler acquisition;
+
+// Air temperature for speed-of-sound compensation (configured constant)
+FixedTemperatureSource airTemperature(DEFAULT_AIR_TEMPERATURE_C);
+
+// Adaptive sensor sampling interval
+SamplingPolicy sampling;
+
+// Raw ping traces for the "trace" command (replayed with ReplayEchoCaptureHal)
+StreamTraceSink serialTrace(Serial);
+
+// Raw echo stream for installers (web socket, pauses normal readings)
+DiagnosticStream diagnostics;
 
 // ============================================================================
 // ESP8266 FREERTOS COMPATIBILITY
@@ -53,6 +70,8 @@ UltrasonicSensor* sensor2 = nullptr;
     #define vTaskDelay(ms) delay(ms)
     #define portTICK_PERIOD_MS 1
     #define vTaskSuspend(x) do {} while(0)
+    #define xTaskNotifyGive(task) do {} while(0)
+    #define ulTaskNotifyTake(clear, ticks) (delay(ticks), 0)
     // ESP8266 doesn't have true FreeRTOS tasks in the same way
     // We'll use the Schedule library for pseudo-tasks
 #endif
@@ -64,30 +83,41 @@ UltrasonicSensor* sensor2 = nullptr;
     TaskHandle_t sensorTaskHandle = NULL;
     TaskHandle_t displayTaskHandle = NULL;
     TaskHandle_t networkTaskHandle = NULL;
+    TaskHandle_t pumpTaskHandle = NULL;
 #else
     // ESP8266 doesn't expose TaskHandle_t
     void* sensorTaskHandle = NULL;
     void* displayTaskHandle = NULL;
     void* networkTaskHandle = NULL;
+    void* pumpTaskHandle = NULL;
 #endif
 
 // ============================================================================
 // GLOBAL STATE
 // ============================================================================
-SensorReading tank1Reading;
-SensorReading tank2Reading;
 bool systemInitialized = false;
 uint32_t lastMQTTPublish = 0;
 
+// Pump commands received over MQTT whose outcome is still to be published
+// (network task only: the MQTT callback runs inside mqttClient.loop())
+uint32_t mqttPumpTickets[PUMP_ACK_RING_SIZE];
+uint8_t mqttPumpTicketCount = 0;
+
 // ============================================================================
 // FUNCTION PROTOTYPES
 // ============================================================================
 void setupOTA();
 void setupSensors();
+void setupTime();
 void sensorTask(void* parameter);
 void displayTask(void* parameter);
 void networkTask(void* parameter);
+void pumpTask(void* parameter);
+void notifyPumpTask();
+void runDiagnostics();
 void mqttCallback(char* topic, byte* payload, unsigned int length);
+void trackMqttPumpCommand(uint32_t ticket);
+void publishPumpAcks();
 ConnectionStatus getConnectionStatus();
 
 // ============================================================================
@@ -134,6 +164,7 @@ void setup() {
     // Initialize pump controller
     DEBUG_PRINTLN("Initializing pump controller...");
     pumpController.begin();
+    pumpController.setCommandNotify(notifyPumpTask);
     
     // Initialize WiFi with IonConnect
     DEBUG_PRINTLN("Initializing WiFi with IonConnect...");
@@ -142,6 +173,9 @@ void setup() {
     }
     DEBUG_PRINTLN("IonConnect will handle connection and captive portal automatically");
     
+    // Local time for pump schedule windows (syncs once WiFi is up)
+    setupTime();
+    
     // Show initial status on display
     if (configManager.isWiFiConfigured()) {
         display.showConfigMode("Connecting...", "Please wait");
@@ -156,9 +190,10 @@ void setup() {
     
     // Initialize web server
     DEBUG_PRINTLN("Initializing web server...");
-    webServer.setSensor1(sensor1);
-    webServer.setSensor2(sensor2);
+    webServer.setTankRegistry(&tanks);
     webServer.setPumpController(&pumpController);
+    webServer.setSamplingPolicy(&sampling);
+    webServer.setDiagnosticStream(&diagnostics);
     webServer.begin();
     
     // Initialize MQTT client if WiFi is connected
@@ -216,11 +251,22 @@ void setup() {
             &networkTaskHandle,
             1  // Core 1
         );
+        
+        xTaskCreatePinnedToCore(
+            pumpTask,
+            "PumpTask",
+            PUMP_TASK_STACK,
+            NULL,
+            PUMP_TASK_PRIORITY,
+            &pumpTaskHandle,
+            1  // Core 1
+        );
     #elif defined(ESP8266)
         // ESP8266: Use Schedule library for cooperative multitasking
         schedule_function([]() { sensorTask(NULL); });
         schedule_function([]() { displayTask(NULL); });
         schedule_function([]() { networkTask(NULL); });
+        // No pump task: commands are applied as they are posted (see notifyPumpTask)
         DEBUG_PRINTLN("ESP8266: Using scheduled functions instead of FreeRTOS tasks");
     #else
         // ESP32-S2: Single core - all tasks on core 0
@@ -250,6 +296,15 @@ void setup() {
             NETWORK_TASK_PRIORITY,
             &networkTaskHandle
         );
+        
+        xTaskCreate(
+            pumpTask,
+            "PumpTask",
+            PUMP_TASK_STACK,
+            NULL,
+            PUMP_TASK_PRIORITY,
+            &pumpTaskHandle
+        );
     #endif
     
     systemInitialized = true;
@@ -282,39 +337,46 @@ void sensorTask(void* parameter) {
     
     DEBUG_PRINTLN("Sensor task started");
     
+    SensorReading readings[MAX_SCHEDULED_SENSORS];
+    
     while (1) {
-        // Read sensor 1
-        if (sensor1) {
-            tank1Reading = sensor1->readDistance();
-            
-            if (!tank1Reading.isValid) {
-                DEBUG_PRINTLN("WARNING: Tank 1 sensor reading invalid");
-            }
+        // Installer diagnostics replace normal readings until they end
+        if (diagnostics.isActive()) {
+            runDiagnostics();
+            continue;
         }
         
-        // Read sensor 2 if in dual-tank mode
-        if (config.tankMode == DUAL_TANK && sensor2) {
-            tank2Reading = sensor2->readDistance();
-            
-            if (!tank2Reading.isValid) {
-                DEBUG_PRINTLN("WARNING: Tank 2 sensor reading invalid");
-            }
+        // Commands from other tasks that touch sensor state (MQTT resets)
+        tanks.applyRequests();
+        
+        // Inflow splashes the target tank's surface; filter it harder
+        tanks.setInflow(PUMP_TARGET_TANK, pumpController.isRunning());
+        
+        // Read all sensors in one interleaved, time-aligned cycle
+        acquisition.setGuardInterval(config.sensorGuardMs);
+        acquisition.runCycle(readings);
+        
+        // Estimate, persist learned clutter, learn tank bounds (opt-in);
+        // a level leaving its trend is published without waiting for the interval
+        if (tanks.update(readings) && networkTaskHandle) {
+            xTaskNotifyGive(networkTaskHandle);
         }
         
-        // Update pump controller (automatic mode)
-        if (tank1Reading.isValid) {
-            float sourceLevel = (config.tankMode == DUAL_TANK && tank2Reading.isValid) 
-                                ? tank2Reading.levelPercent 
-                                : 100.0;
-            pumpController.update(tank1Reading.levelPercent, sourceLevel);
+        // Rate-limited write of anything learned above
+        configManager.processPendingSave();
+        
+        // Hand the reading to the pump task (automatic control, dry-run check)
+        const SensorReading* target = tanks.getValidReading(PUMP_TARGET_TANK);
+        if (target) {
+            const SensorReading* source = tanks.getValidReading(PUMP_SOURCE_TANK);
+            pumpController.postReading(*target, source ? source->filteredCenti : CENTI_PERCENT_FULL);
         }
         
         // Update BLE characteristics
-        if (tank1Reading.isValid) {
-            bleService.updateTank1Level(tank1Reading.levelPercent);
-        }
-        if (config.tankMode == DUAL_TANK && tank2Reading.isValid) {
-            bleService.updateTank2Level(tank2Reading.levelPercent);
+        for (uint8_t i = 0; i < tanks.count(); i++) {
+            if (tanks.get(i).reading.isValid) {
+                bleService.updateTankLevel(i, tanks.get(i).reading.filteredCenti);
+            }
         }
         bleService.updatePumpStatus(pumpController.isRunning());
         
@@ -323,8 +385,79 @@ void sensorTask(void* parameter) {
         vTaskDelay(50 / portTICK_PERIOD_MS);
         digitalWrite(STATUS_LED_PIN, LOW);
         
-        // Wait for next reading
-        vTaskDelay(config.sensorReadInterval / portTICK_PERIOD_MS);
+        // Pick the next interval from pump state and level dynamics
+        sampling.setIntervals(config.sensorMinInterval, config.sensorReadInterval, config.sensorMaxInterval);
+        
+        int16_t rate;
+        bool anyValid = tanks.getMaxRate(rate);
+        bool pumpRunning = pumpController.isRunning();
+        uint32_t interval = sampling.next(pumpRunning, anyValid, rate);
+        
+        // Confirm (or dismiss) a suspected change at the fastest rate
+        if (tanks.isChangeSuspected()) {
+            interval = min(interval, sampling.getFloor());
+        }
+        pumpController.setDecisionInterval(interval);
+        
+        #if DEBUG_SENSOR
+        DEBUG_PRINTF("Next reading in %lu ms (decision %d)\n", 
+                     (unsigned long)interval, sampling.getLastDecision());
+        #endif
+        
+        // Wait for next reading, in floor-sized slices so a pump start or
+        // stop cuts a long backoff short
+        uint32_t slept = 50;
+        while (slept < interval && pumpController.isRunning() == pumpRunning) {
+            uint32_t step = min(interval - slept, sampling.getFloor());
+            vTaskDelay(step / portTICK_PERIOD_MS);
+            slept += step;
+        }
+    }
+}
+
+// Ping one tank's pulse sensor at a fixed rate and hand every raw echo to the
+// diagnostic stream. Levels, fusion and learning are left untouched; the web
+// server only starts this while the pump is off, and it ends as soon as the
+// pump runs so that pump supervision resumes.
+void runDiagnostics() {
+    uint8_t tank = diagnostics.getTank();
+    UltrasonicSensor* sensor = tanks.getPulseSensor(tank);
+    if (!sensor) {
+        diagnostics.stop();
+        return;
+    }
+    
+    DEBUG_PRINTF("Diagnostics: streaming tank %d for %lu s\n", tank + 1,
+                 (unsigned long)(diagnostics.getRemainingMs(millis()) / 1000));
+    diagnostics.setEchoWindow(sensor->getTimeout());
+    
+    // A restart for another tank picks up the new sensor on the next call
+    while (diagnostics.isActive() && diagnostics.getTank() == tank) {
+        uint32_t start = millis();
+        if (diagnostics.checkExpiry(start)) {
+            break;
+        }
+        if (pumpController.isRunning()) {
+            diagnostics.stop();
+            break;
+        }
+        
+        sensor->startPing();
+        uint32_t durationUs;
+        uint8_t status;
+        while (!sensor->pollEcho(durationUs, status)) {
+            vTaskDelay(1);
+        }
+        diagnostics.record(start, status, durationUs);
+        
+        uint32_t elapsed = millis() - start;
+        if (elapsed < DIAG_PING_INTERVAL_MS) {
+            vTaskDelay((DIAG_PING_INTERVAL_MS - elapsed) / portTICK_PERIOD_MS);
+        }
+    }
+    
+    if (!diagnostics.isActive()) {
+        DEBUG_PRINTLN("Diagnostics: ended, resuming readings");
     }
 }
 
@@ -336,6 +469,10 @@ void displayTask(void* parameter) {
     
     DEBUG_PRINTLN("Display task started");
     
+    // Two tanks fit on one page; larger installations page through them
+    uint8_t firstTank = 0;
+    uint32_t lastPageChange = millis();
+    
     while (1) {
         if (!config.displayEnabled) {
             vTaskDelay(1000 / portTICK_PERIOD_MS);
@@ -347,21 +484,30 @@ void displayTask(void* parameter) {
         // Show appropriate screen based on mode
         if (wifiManager.isAPMode()) {
             display.showConfigMode(AP_SSID, wifiManager.getAPIP().c_str());
-        } else if (config.tankMode == SINGLE_TANK) {
-            display.showSingleTankMain(
-                config.tank1Name,
-                tank1Reading.levelPercent,
-                tank1Reading.distanceCm,
-                status
-            );
         } else {
-            display.showDualTankMain(
-                config.tank1Name,
-                tank1Reading.levelPercent,
-                config.tank2Name,
-                tank2Reading.levelPercent,
-                status
-            );
+            if (millis() - lastPageChange >= SCREEN_ROTATION_INTERVAL) {
+                firstTank = (firstTank + 2 < tanks.count()) ? firstTank + 2 : 0;
+                lastPageChange = millis();
+            }
+            
+            const TankDescriptor& first = tanks.get(firstTank);
+            if (firstTank + 1 < tanks.count()) {
+                const TankDescriptor& second = tanks.get(firstTank + 1);
+                display.showDualTankMain(
+                    first.config->name,
+                    centiToPercent(first.reading.filteredCenti),
+                    second.config->name,
+                    centiToPercent(second.reading.filteredCenti),
+                    status
+                );
+            } else {
+                display.showSingleTankMain(
+                    first.config->name,
+                    centiToPercent(first.reading.filteredCenti),
+                    mmToCm(first.reading.distanceMm),
+                    status
+                );
+            }
         }
         
         // Check for auto-rotation
@@ -395,20 +541,54 @@ void networkTask(void* parameter) {
             // Process MQTT messages
             mqttClient.loop();
             
-            // Publish sensor data periodically
-            if (tank1Reading.isValid) {
-                const SystemConfig& config = configManager.getConfig();
-                const SensorReading* tank2Ptr = (config.tankMode == DUAL_TANK && tank2Reading.isValid) 
-                                                ? &tank2Reading 
-                                                : nullptr;
-                mqttClient.publishSensorData(tank1Reading, tank2Ptr);
+            // Outcome of each pump command received over MQTT
+            publishPumpAcks();
+            
+            // Level changes first, then the periodic reading
+            ChangeEvent event;
+            while (tanks.takeChangeEvent(event)) {
+                mqttClient.publishChangeEvent(event, tanks);
             }
+            mqttClient.publishSensorData(tanks);
         }
         
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+        // Raw echo frames go to local web clients too (AP mode included)
+        webServer.streamDiagnostics();
+        
+        // Sleeps 100 ms unless the sensor task reports a level change
+        ulTaskNotifyTake(pdTRUE, 100 / portTICK_PERIOD_MS);
+    }
+}
+
+// ============================================================================
+// PUMP TASK
+// ============================================================================
+// The only task that changes the pump: commands from the web, MQTT and BLE
+// callbacks, sensor readings and the deadline timer are applied here in order.
+void pumpTask(void* parameter) {
+    DEBUG_PRINTLN("Pump task started");
+    
+    while (1) {
+        // Woken by each post; the timeout only covers a missed notification
+        ulTaskNotifyTake(pdTRUE, PUMP_TASK_IDLE_MS / portTICK_PERIOD_MS);
+        pumpController.processCommands();
     }
 }
 
+void notifyPumpTask() {
+    #ifdef ESP8266
+        // The scheduled sensor function never returns, so a pump task would
+        // never run, and there are no task notifications to wake it. Apply
+        // the command here instead: loop, timer and network callbacks never
+        // preempt one another, so this is still the only owner
+        pumpController.processCommands();
+    #else
+        if (pumpTaskHandle) {
+            xTaskNotifyGive(pumpTaskHandle);
+        }
+    #endif
+}
+
 // ============================================================================
 // SETUP FUNCTIONS
 // ============================================================================
@@ -417,29 +597,25 @@ void setupSensors() {
     
     DEBUG_PRINTLN("Initializing sensors...");
     
-    // Initialize sensor 1 (always present)
-    sensor1 = new UltrasonicSensor(
-        config.trigPin1,
-        config.echoPin1,
-        config.tank1EmptyCm,
-        config.tank1FullCm
-    );
-    sensor1->begin();
-    
-    // Initialize sensor 2 if in dual-tank mode
-    if (config.tankMode == DUAL_TANK) {
-        sensor2 = new UltrasonicSensor(
-            config.trigPin2,
-            config.echoPin2,
-            config.tank2EmptyCm,
-            config.tank2FullCm
-        );
-        sensor2->begin();
-    }
+    airTemperature.setTemperature(config.airTemperatureC);
+    
+    tanks.begin(acquisition, &airTemperature);
+    acquisition.setGuardInterval(config.sensorGuardMs);
     
     DEBUG_PRINTLN("Sensors initialized");
 }
 
+void setupTime() {
+    const SystemConfig& config = configManager.getConfig();
+    
+    #ifdef ESP8266
+        configTime(config.timeZone, NTP_SERVER);
+    #else
+        configTzTime(config.timeZone, NTP_SERVER);
+    #endif
+    DEBUG_PRINTF("Time: NTP %s, zone %s\n", NTP_SERVER, config.timeZone);
+}
+
 void setupOTA() {
     ArduinoOTA.setHostname(OTA_HOSTNAME);
     ArduinoOTA.setPassword(OTA_PASSWORD);
@@ -513,18 +689,101 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
     // Handle commands
     if (strcmp(topic, config.mqttCmdTopic) == 0) {
         // Parse JSON command
-        DynamicJsonDocument doc(256);
+        DynamicJsonDocument doc(768);    // Room for a pump_schedule window list
         DeserializationError error = deserializeJson(doc, message);
         
         if (!error) {
             const char* cmd = doc["command"];
             
+            uint32_t ticket;
             if (cmd && strcmp(cmd, "pump_on") == 0) {
                 DEBUG_PRINTLN("MQTT: Pump ON command received");
-                pumpController.turnOn();
+                if (pumpController.post(PUMP_CMD_ON, PUMP_ORIGIN_MQTT, &ticket)) {
+                    trackMqttPumpCommand(ticket);
+                }
             } else if (cmd && strcmp(cmd, "pump_off") == 0) {
                 DEBUG_PRINTLN("MQTT: Pump OFF command received");
-                pumpController.turnOff();
+                if (pumpController.post(PUMP_CMD_OFF, PUMP_ORIGIN_MQTT, &ticket)) {
+                    trackMqttPumpCommand(ticket);
+                }
+            } else if (cmd && strcmp(cmd, "pump_reset") == 0) {
+                // Clear a pump fault (dry run, max run time) once the cause is fixed
+                DEBUG_PRINTLN("MQTT: Pump fault reset received");
+                if (pumpController.post(PUMP_CMD_RESET, PUMP_ORIGIN_MQTT, &ticket)) {
+                    trackMqttPumpCommand(ticket);
+                }
+            } else if (cmd && strcmp(cmd, "clutter_reset") == 0) {
+                // Forget learned false echoes (e.g. after refitting the tank);
+                // the sensor task clears and persists the maps between cycles
+                DEBUG_PRINTLN("MQTT: Clutter map reset");
+                tanks.requestClutterReset();
+            } else if (cmd && strcmp(cmd, "autocal") == 0) {
+                // Switch calibration learning mode (0 off, 1 propose, 2 apply)
+                uint8_t mode = doc["mode"] | (uint8_t)AUTOCAL_OFF;
+                if (mode <= AUTOCAL_APPLY) {
+                    DEBUG_PRINTF("MQTT: Auto-calibration mode %d\n", mode);
+                    configManager.getConfigRef().autoCalMode = mode;
+                    configManager.requestSave();
+                    if (mode == AUTOCAL_OFF) {
+                        tanks.requestAutoCalReset();    // Histograms belong to the sensor task
+                    }
+                }
+            } else if (cmd && strcmp(cmd, "pump_predict") == 0) {
+                // Predictive auto-off (stop ahead of the threshold from the fill rate)
+                bool enable = doc["enable"] | true;
+                DEBUG_PRINTF("MQTT: Predictive pump stop %s\n", enable ? "on" : "off");
+                configManager.getConfigRef().pumpPredictiveStop = enable;
+                configManager.requestSave();
+            } else if (cmd && strcmp(cmd, "pump_stall") == 0) {
+                // Dry-run detection: required rise (%) within a window of running (s, 0 = off)
+                float rise = doc["rise"] | config.pumpStallRise;
+                uint32_t seconds = doc["window"] | (config.pumpStallWindow / 1000);
+                if (rise > 0 && rise <= 100 && seconds <= UINT32_MAX / 1000) {
+                    DEBUG_PRINTF("MQTT: Pump stall %.1f%% in %lu s\n", rise, (unsigned long)seconds);
+                    configManager.getConfigRef().pumpStallRise = rise;
+                    configManager.getConfigRef().pumpStallWindow = seconds * 1000;
+                    configManager.requestSave();
+                }
+            } else if (cmd && strcmp(cmd, "pump_schedule") == 0) {
+                // Scheduled mode windows, e.g. [{"day": 1, "start": "23:00", "end": "07:00"}]
+                // (day 0 = Sunday, 7 = every day), and/or a POSIX time zone
+                const char* tz = doc["tz"];
+                if (tz && strlen(tz) < sizeof(config.timeZone)) {
+                    strcpy(configManager.getConfigRef().timeZone, tz);
+                    setupTime();
+                    configManager.requestSave();
+                }
+                
+                // New windows are stored and persisted by the pump task
+                if (doc.containsKey("windows")) {
+                    bool valid = true;
+                    PumpWindow windows[PUMP_SCHEDULE_MAX_WINDOWS];
+                    uint8_t count = 0;
+                    for (JsonObject window : doc["windows"].as<JsonArray>()) {
+                        uint8_t added = PumpSchedule::makeWindows(window["day"] | SCHEDULE_EVERY_DAY,
+                                                                  window["start"] | "", window["end"] | "",
+                                                                  windows + count, PUMP_SCHEDULE_MAX_WINDOWS - count);
+                        if (added == 0) {
+                            valid = false;
+                            break;
+                        }
+                        count += added;
+                    }
+                    if (valid && pumpController.setSchedule(windows, count, PUMP_ORIGIN_MQTT, &ticket)) {
+                        trackMqttPumpCommand(ticket);
+                    } else {
+                        DEBUG_PRINTLN("MQTT: Pump schedule rejected (invalid or busy)");
+                    }
+                } else if (pumpController.post(PUMP_CMD_SCHEDULE, PUMP_ORIGIN_MQTT, &ticket)) {
+                    trackMqttPumpCommand(ticket);
+                }
+            } else if (cmd && strcmp(cmd, "trace") == 0) {
+                // Stream a tank's raw pings to the serial port for replay on a host
+                uint8_t tank = doc["tank"] | 1;
+                bool enable = doc["enable"] | true;
+                if (tank >= 1 && tanks.requestTraceSink(tank - 1, enable ? &serialTrace : nullptr)) {
+                    DEBUG_PRINTF("MQTT: Ping trace %s for tank %d\n", enable ? "on" : "off", tank);
+                }
             } else if (cmd && strcmp(cmd, "status") == 0) {
                 DEBUG_PRINTLN("MQTT: Status request received");
                 mqttClient.publishStatus(
@@ -538,3 +797,27 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
     }
 }
 
+void trackMqttPumpCommand(uint32_t ticket) {
+    if (mqttPumpTicketCount < PUMP_ACK_RING_SIZE) {
+        mqttPumpTickets[mqttPumpTicketCount++] = ticket;
+    }
+}
+
+void publishPumpAcks() {
+    const PumpCommandQueue& queue = pumpController.getCommandQueue();
+    
+    // One ack per command, in the order received; keep the ones not applied yet
+    uint8_t waiting = 0;
+    for (uint8_t i = 0; i < mqttPumpTicketCount; i++) {
+        PumpCommandAck ack;
+        if (queue.getAck(mqttPumpTickets[i], ack)) {
+            mqttClient.publishPumpAck(ack);
+        } else if (queue.isPending(mqttPumpTickets[i])) {
+            mqttPumpTickets[waiting++] = mqttPumpTickets[i];
+        } else {
+            DEBUG_PRINTF("MQTT: Pump command %lu outcome no longer kept\n", (unsigned long)mqttPumpTickets[i]);
+        }
+    }
+    mqttPumpTicketCount = waiting;
+}
+
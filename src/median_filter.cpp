@@ -0,0 +1,152 @@
+#include "median_filter.h"
+#include <string.h>
+
+// Scale factor that makes the MAD a consistent estimator of sigma (1.4826, Q8)
+#define MAD_TO_SIGMA_Q8 380
+
+SlidingMedianFilter::SlidingMedianFilter(uint8_t window)
+    : head(0), count(0), window(1),
+      hampelEnabled(false), hampelThresholdQ8(3 << 8), hampelMinSpread(5),
+      consecutiveRejects(0), accepted(0), rejected(0) {
+    setWindow(window);
+}
+
+void SlidingMedianFilter::setWindow(uint8_t window) {
+    if (window < 1) window = 1;
+    if (window > FILTER_WINDOW_MAX) window = FILTER_WINDOW_MAX;
+    
+    // Shrinking drops the oldest samples
+    while (count > window) {
+        uint8_t oldest = (head + FILTER_WINDOW_MAX - count) % FILTER_WINDOW_MAX;
+        removeSorted(ring[oldest]);
+        count--;
+    }
+    
+    this->window = window;
+}
+
+void SlidingMedianFilter::setHampel(bool enabled, float threshold, int32_t minSpread) {
+    hampelEnabled = enabled;
+    hampelThresholdQ8 = (int32_t)(threshold * 256.0f + 0.5f); // Converted once, at configuration
+    hampelMinSpread = minSpread;
+}
+
+bool SlidingMedianFilter::push(int32_t value) {
+    if (hampelEnabled && isOutlier(value)) {
+        // A run of "outliers" longer than half the window is a real step
+        // change (e.g. a fill starting), so the window restarts from it
+        if (++consecutiveRejects <= window / 2) {
+            rejected++;
+            return false;
+        }
+        reset();
+    }
+    consecutiveRejects = 0;
+    
+    if (count == window) {
+        uint8_t oldest = (head + FILTER_WINDOW_MAX - count) % FILTER_WINDOW_MAX;
+        removeSorted(ring[oldest]);
+        count--;
+    }
+    
+    ring[head] = value;
+    head = (head + 1) % FILTER_WINDOW_MAX;
+    insertSorted(value);
+    count++;
+    accepted++;
+    
+    return true;
+}
+
+void SlidingMedianFilter::reset() {
+    head = 0;
+    count = 0;
+    consecutiveRejects = 0;
+}
+
+int32_t SlidingMedianFilter::median() const {
+    if (count == 0) return 0;
+    
+    if (count % 2 == 0) {
+        return (sorted[count/2 - 1] + sorted[count/2] + 1) / 2;
+    }
+    return sorted[count/2];
+}
+
+int32_t SlidingMedianFilter::mad() const {
+    if (count == 0) return 0;
+    
+    // Deviations below and above the median are each already sorted when
+    // walked outwards from the middle, so merging them yields the k-th
+    // smallest deviation in O(n) without another sort
+    int32_t m = median();
+    int8_t lo = (count - 1) / 2;
+    int8_t hi = count / 2;
+    if (lo == hi) {      // Odd count: the median itself has deviation 0
+        lo--;
+        hi++;
+    }
+    
+    uint8_t target = count / 2;
+    int32_t deviation = 0;
+    uint8_t taken = (count % 2) ? 1 : 0;
+    
+    while (taken <= target) {
+        int32_t dLo = (lo >= 0) ? m - sorted[lo] : INT32_MAX;
+        int32_t dHi = (hi < count) ? sorted[hi] - m : INT32_MAX;
+        
+        if (dLo <= dHi) {
+            deviation = dLo;
+            lo--;
+        } else {
+            deviation = dHi;
+            hi++;
+        }
+        taken++;
+    }
+    
+    return deviation;
+}
+
+bool SlidingMedianFilter::isOutlier(int32_t value) const {
+    if (count < 3) {
+        return false; // Not enough history to judge
+    }
+    
+    int32_t spread = (MAD_TO_SIGMA_Q8 * mad()) >> 8;
+    if (spread < hampelMinSpread) {
+        spread = hampelMinSpread;
+    }
+    
+    int32_t deviation = value - median();
+    if (deviation < 0) {
+        deviation = -deviation;
+    }
+    
+    return deviation > ((hampelThresholdQ8 * spread) >> 8);
+}
+
+void SlidingMedianFilter::insertSorted(int32_t value) {
+    // Upper bound keeps equal values in insertion order
+    uint8_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        if (sorted[mid] <= value) lo = mid + 1;
+        else hi = mid;
+    }
+    
+    memmove(&sorted[lo + 1], &sorted[lo], (count - lo) * sizeof(int32_t));
+    sorted[lo] = value;
+}
+
+void SlidingMedianFilter::removeSorted(int32_t value) {
+    uint8_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        if (sorted[mid] < value) lo = mid + 1;
+        else hi = mid;
+    }
+    
+    if (lo >= count) return;
+    memmove(&sorted[lo], &sorted[lo + 1], (count - lo - 1) * sizeof(int32_t));
+}
@@ -0,0 +1,59 @@
+#ifndef MEDIAN_FILTER_H
+#define MEDIAN_FILTER_H
+
+#include <stdint.h>
+
+#define FILTER_WINDOW_MAX 15
+
+/**
+ * Persistent sliding-window median with Hampel outlier rejection.
+ *
+ * Samples are kept in insertion order (ring) and in a sorted index that is
+ * updated incrementally: the oldest value is removed and the new one
+ * inserted with a binary search, so no sort runs per sample. Samples are
+ * integers (millimetres in the sensor pipeline) so no float math runs
+ * per sample either.
+ */
+class SlidingMedianFilter {
+public:
+    SlidingMedianFilter(uint8_t window = 5);
+    
+    // Configuration
+    void setWindow(uint8_t window);
+    uint8_t getWindow() const { return window; }
+    void setHampel(bool enabled, float threshold = 3.0f, int32_t minSpread = 5);
+    
+    // Add a sample; returns false if it was rejected as an outlier
+    bool push(int32_t value);
+    void reset();
+    
+    // Window statistics
+    uint8_t size() const { return count; }
+    int32_t median() const;
+    int32_t mad() const;  // Median absolute deviation from the median
+    
+    // Lifetime counters
+    uint32_t getAcceptedCount() const { return accepted; }
+    uint32_t getRejectedCount() const { return rejected; }
+    
+private:
+    int32_t ring[FILTER_WINDOW_MAX];    // Insertion order
+    int32_t sorted[FILTER_WINDOW_MAX];  // Ascending order
+    uint8_t head;                     // Next ring slot to write
+    uint8_t count;
+    uint8_t window;
+    
+    bool hampelEnabled;
+    int32_t hampelThresholdQ8;        // Rejection threshold in scaled MADs (Q8)
+    int32_t hampelMinSpread;          // Lower bound for the scaled MAD
+    uint8_t consecutiveRejects;
+    
+    uint32_t accepted;
+    uint32_t rejected;
+    
+    bool isOutlier(int32_t value) const;
+    void insertSorted(int32_t value);
+    void removeSorted(int32_t value);
+};
+
+#endif // MEDIAN_FILTER_H
@@ -1,5 +1,6 @@
 #include "mqtt_client.h"
 #include "config.h"
+#include "pump_controller.h"
 
 MQTTClient::MQTTClient(ConfigManager& configManager)
     : configManager(configManager),
@@ -21,7 +22,7 @@ bool MQTTClient::begin() {
     }
     
     client.setServer(config.mqttBroker, config.mqttPort);
-    client.setBufferSize(512); // Increase buffer for JSON payloads
+    client.setBufferSize(MQTT_PAYLOAD_SIZE); // Increase buffer for JSON payloads
     
     DEBUG_PRINTF("MQTT: Configured for %s:%d\n", config.mqttBroker, config.mqttPort);
     return true;
@@ -121,22 +122,48 @@ bool MQTTClient::publish(const char* topic, const char* payload, bool retained)
     return success;
 }
 
-bool MQTTClient::publishSensorData(const SensorReading& tank1, const SensorReading* tank2) {
+bool MQTTClient::publishSensorData(const TankRegistry& tanks, bool force) {
     const SystemConfig& config = configManager.getConfig();
     
-    if (!client.connected() || !tank1.isValid) {
-        return false;
+    int16_t rate;
+    if (!client.connected() || !tanks.getMaxRate(rate)) {
+        return false; // Nothing valid to publish
     }
     
     // Check if it's time to publish
-    if (millis() - lastPublish < config.mqttPublishInterval) {
+    if (!force && millis() - lastPublish < config.mqttPublishInterval) {
         return true; // Not an error, just too soon
     }
     
-    String payload = createDevicePayload(tank1, tank2);
+    String payload = createDevicePayload(tanks);
     return publish(config.mqttTopic, payload.c_str());
 }
 
+bool MQTTClient::publishChangeEvent(const ChangeEvent& event, const TankRegistry& tanks) {
+    const SystemConfig& config = configManager.getConfig();
+    
+    DynamicJsonDocument doc(256);
+    doc["device_id"] = config.deviceId;
+    doc["tank"] = event.tank + 1;
+    doc["name"] = tanks.get(event.tank).config->name;
+    doc["event"] = event.direction == CHANGE_RISE ? "rise" : "drop";
+    doc["from_percent"] = centiToPercent(event.fromCenti);
+    doc["level_percent"] = centiToPercent(event.levelCenti);
+    doc["rate_per_min"] = event.rateCentiPerMin / 100.0f;
+    doc["timestamp"] = event.timestamp / 1000;
+    
+    String payload;
+    serializeJson(doc, payload);
+    
+    char topic[150];
+    snprintf(topic, sizeof(topic), "%s/event", config.mqttTopic);
+    
+    // Followed by a full reading so dashboards catch up at once
+    bool success = publish(topic, payload.c_str());
+    publishSensorData(tanks, true);
+    return success;
+}
+
 bool MQTTClient::publishStatus(bool wifi, bool mqtt, bool ble, bool pump) {
     const SystemConfig& config = configManager.getConfig();
     
@@ -157,6 +184,31 @@ bool MQTTClient::publishStatus(bool wifi, bool mqtt, bool ble, bool pump) {
     return publish(topic, payload.c_str());
 }
 
+bool MQTTClient::publishPumpAck(const PumpCommandAck& ack) {
+    const SystemConfig& config = configManager.getConfig();
+    static const char* commands[] = {"pump_on", "pump_off", "reading", "service", "mode", "pump_schedule", "pump_schedule", "pump_reset"};
+    static const char* states[] = {"off", "on", "cooldown", "error"};
+    
+    DynamicJsonDocument doc(256);
+    doc["device_id"] = config.deviceId;
+    doc["command"] = ack.type <= PUMP_CMD_RESET ? commands[ack.type] : "unknown";
+    doc["ticket"] = ack.ticket;
+    doc["accepted"] = ack.accepted;
+    doc["state"] = ack.state <= PUMP_ERROR ? states[ack.state] : "unknown";
+    if (ack.fault) {
+        doc["fault"] = ack.fault;
+    }
+    doc["latency_us"] = ack.latencyUs;
+    
+    String payload;
+    serializeJson(doc, payload);
+    
+    char topic[150];
+    snprintf(topic, sizeof(topic), "%s/pump/ack", config.mqttTopic);
+    
+    return publish(topic, payload.c_str());
+}
+
 bool MQTTClient::subscribe(const char* topic) {
     if (!client.connected()) {
         return false;
@@ -213,29 +265,50 @@ bool MQTTClient::publishBuffered() {
     return success;
 }
 
-String MQTTClient::createDevicePayload(const SensorReading& tank1, const SensorReading* tank2) {
+String MQTTClient::createDevicePayload(const TankRegistry& tanks) {
     const SystemConfig& config = configManager.getConfig();
     
-    DynamicJsonDocument doc(512);
+    DynamicJsonDocument doc(MQTT_PAYLOAD_SIZE);
     
     doc["device_id"] = config.deviceId;
     doc["timestamp"] = millis() / 1000;
-    doc["tank_mode"] = config.tankMode == SINGLE_TANK ? "single" : "dual";
-    
-    // Tank 1 data
-    JsonObject t1 = doc.createNestedObject("tank1");
-    t1["name"] = config.tank1Name;
-    t1["level_percent"] = round(tank1.levelPercent * 10) / 10.0;
-    t1["distance_cm"] = round(tank1.distanceCm * 10) / 10.0;
-    t1["valid"] = tank1.isValid;
-    
-    // Tank 2 data (if dual mode)
-    if (config.tankMode == DUAL_TANK && tank2 && tank2->isValid) {
-        JsonObject t2 = doc.createNestedObject("tank2");
-        t2["name"] = config.tank2Name;
-        t2["level_percent"] = round(tank2->levelPercent * 10) / 10.0;
-        t2["distance_cm"] = round(tank2->distanceCm * 10) / 10.0;
-        t2["valid"] = tank2->isValid;
+    doc["tank_count"] = tanks.count();
+    
+    // "tank1" .. "tankN"; tanks without a valid reading are left out
+    for (uint8_t i = 0; i < tanks.count(); i++) {
+        const TankDescriptor& tank = tanks.get(i);
+        const SensorReading& reading = tank.reading;
+        if (!reading.isValid) {
+            continue;
+        }
+        
+        char key[8];
+        snprintf(key, sizeof(key), "tank%d", i + 1);
+        JsonObject t = doc.createNestedObject(key);
+        t["name"] = tank.config->name;
+        t["level_percent"] = ((reading.filteredCenti + 5) / 10) / 10.0f;
+        t["level_raw_percent"] = ((reading.levelCenti + 5) / 10) / 10.0f;
+        t["rate_per_min"] = reading.rateCentiPerMin / 100.0f;
+        t["confidence"] = reading.confidence;
+        t["distance_cm"] = mmToCm(reading.distanceMm);
+        t["volume_l"] = reading.volumeDl / 10.0f;
+        t["pings"] = reading.pings;
+        t["valid"] = reading.isValid;
+        
+        // Fused tanks also carry each sensor's raw level and share
+        if (tank.sensorCount > 1) {
+            t["failovers"] = tank.fusion.getFailoverCount();
+            JsonArray sensors = t.createNestedArray("sensors");
+            for (uint8_t s = 0; s < MAX_TANK_SENSORS; s++) {
+                if (!tank.sensors[s]) {
+                    continue;
+                }
+                JsonObject input = sensors.createNestedObject();
+                input["level_raw_percent"] = ((tank.inputs[s].levelCenti + 5) / 10) / 10.0f;
+                input["valid"] = tank.inputs[s].isValid;
+                input["weight_percent"] = tank.fusion.getWeightPermille(s) / 10.0f;
+            }
+        }
     }
     
     String output;
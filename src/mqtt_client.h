@@ -13,7 +13,9 @@
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 #include "config_manager.h"
-#include "sensor_ultrasonic.h"
+#include "level_sensor.h"
+#include "tank_registry.h"
+#include "pump_command_queue.h"
 
 // MQTT callback function type
 typedef void (*MQTTCallback)(char* topic, byte* payload, unsigned int length);
@@ -36,8 +38,10 @@ public:
     
     // Publishing
     bool publish(const char* topic, const char* payload, bool retained = false);
-    bool publishSensorData(const SensorReading& tank1, const SensorReading* tank2 = nullptr);
+    bool publishSensorData(const TankRegistry& tanks, bool force = false);  // force: ignore the interval
+    bool publishChangeEvent(const ChangeEvent& event, const TankRegistry& tanks);
     bool publishStatus(bool wifi, bool mqtt, bool ble, bool pump);
+    bool publishPumpAck(const PumpCommandAck& ack);
     
     // Subscribing
     bool subscribe(const char* topic);
@@ -69,10 +73,10 @@ private:
     // Message buffering
     bool hasLastMessage;
     char lastMessageTopic[128];
-    char lastMessagePayload[512];
+    char lastMessagePayload[MQTT_PAYLOAD_SIZE];
     
     // Internal helpers
-    String createDevicePayload(const SensorReading& tank1, const SensorReading* tank2 = nullptr);
+    String createDevicePayload(const TankRegistry& tanks);
     bool validateConnection();
 };
 
@@ -0,0 +1,139 @@
+#include "pressure_sensor.h"
+#include "config.h"
+
+// ============================================================================
+// SAMPLE RING
+// ============================================================================
+bool AdcSampleRing::push(uint16_t sample) {
+    uint8_t h = head.load(std::memory_order_relaxed);
+    uint8_t next = (h + 1) & (PRESSURE_RING_SIZE - 1);
+    
+    if (next == tail.load(std::memory_order_acquire)) {
+        overruns++; // Task is not keeping up - drop
+        return false;
+    }
+    
+    slots[h] = sample;
+    head.store(next, std::memory_order_release);
+    return true;
+}
+
+bool AdcSampleRing::pop(uint16_t& sample) {
+    uint8_t t = tail.load(std::memory_order_relaxed);
+    
+    if (t == head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    
+    sample = slots[t];
+    tail.store((t + 1) & (PRESSURE_RING_SIZE - 1), std::memory_order_release);
+    return true;
+}
+
+// ============================================================================
+// PRESSURE SENSOR
+// ============================================================================
+PressureSensor::PressureSensor(uint8_t adcPin, const PressureSensorConfig& scaling, 
+                               float emptyCm, float fullCm)
+    : LevelSensor(emptyCm, fullCm), adcPin(adcPin), scaling(scaling), sampling(false),
+      decimator(PRESSURE_CIC_STAGES, PRESSURE_CIC_LOG2_RATIO, PRESSURE_OVERSAMPLE_BITS),
+      lastMillivoltsQ(0), pingStartMs(0) {
+    
+    // A settled output needs stages + 1 decimation periods; allow one more
+    sampleTimeoutMs = (uint32_t)decimator.getRatio() * PRESSURE_ADC_PERIOD_MS * 
+                      (decimator.getStages() + 2);
+    
+    setClutterRejection(false); // No false echoes from a pressure cell
+}
+
+PressureSensor::~PressureSensor() {
+    sampler.detach();
+}
+
+bool PressureSensor::begin() {
+    if (adcPin == 255 || scaling.fullScaleMv <= scaling.zeroMv || scaling.rangeMm == 0) {
+        DEBUG_PRINTLN("Pressure sensor: no ADC pin or invalid scaling");
+        return false;
+    }
+    
+    #ifndef ESP8266
+        analogSetPinAttenuation(adcPin, ADC_11db); // ~0-3.1 V input range
+    #endif
+    
+    sampler.attach_ms(PRESSURE_ADC_PERIOD_MS, onSampleTimer, this);
+    
+    DEBUG_PRINTF("Pressure sensor initialized (ADC: %d, %u-%u mV = 0-%u mm)\n", 
+                 adcPin, scaling.zeroMv, scaling.fullScaleMv, scaling.rangeMm);
+    return true;
+}
+
+void PressureSensor::onSampleTimer(PressureSensor* sensor) {
+    if (!sensor->sampling.load(std::memory_order_acquire)) {
+        return; // Keep the ADC free between readings
+    }
+    
+    #ifdef ESP8266
+        uint16_t mv = (uint32_t)analogRead(sensor->adcPin) * PRESSURE_ADC_FULL_SCALE_MV / 1024;
+    #else
+        uint16_t mv = analogReadMilliVolts(sensor->adcPin); // eFuse-calibrated
+    #endif
+    sensor->ring.push(mv);
+}
+
+void PressureSensor::startPing() {
+    // Restart the decimator so every output covers only this ping
+    sampling.store(false, std::memory_order_release);
+    ring.clear();
+    decimator.reset();
+    pingStartMs = millis();
+    sampling.store(true, std::memory_order_release);
+}
+
+bool PressureSensor::pollPing() {
+    uint16_t sample;
+    while (ring.pop(sample)) {
+        int32_t output;
+        if (!decimator.push(sample, output) || !decimator.isSettled()) {
+            continue;
+        }
+        lastMillivoltsQ = output;
+        sampling.store(false, std::memory_order_release);
+        
+        // Well below the zero point means no loop current / unplugged cell
+        int32_t floorQ = ((int32_t)scaling.zeroMv - PRESSURE_FAULT_MARGIN_MV) << decimator.getExtraBits();
+        if (output < floorQ) {
+            recordPing(PING_NO_RESPONSE);
+            return true;
+        }
+        
+        int32_t headMm = millivoltsToHeadMm(output, decimator.getExtraBits(), scaling);
+        headMm = max(headMm, (int32_t)0);
+        
+        // Above the empty reference is out of range (validation rejects 0)
+        DistanceMm distance = headMm < emptyMm ? emptyMm - headMm : 0;
+        recordPing(PING_ECHO, distance);
+        return true;
+    }
+    
+    if (millis() - pingStartMs >= sampleTimeoutMs) {
+        sampling.store(false, std::memory_order_release);
+        recordPing(PING_NO_RESPONSE); // Sampling timer stalled
+        return true;
+    }
+    
+    return false;
+}
+
+int32_t PressureSensor::millivoltsToHeadMm(int32_t millivoltsQ, uint8_t fractionBits, 
+                                           const PressureSensorConfig& scaling) {
+    // Linear transducer: head = (V - Vzero) * range / (Vfull - Vzero)
+    int32_t spanQ = ((int32_t)scaling.fullScaleMv - scaling.zeroMv) << fractionBits;
+    int32_t offsetQ = millivoltsQ - ((int32_t)scaling.zeroMv << fractionBits);
+    
+    int64_t scaled = (int64_t)offsetQ * scaling.rangeMm;
+    return (int32_t)((scaled + (scaled >= 0 ? spanQ / 2 : -spanQ / 2)) / spanQ);
+}
+
+float PressureSensor::getLastMillivolts() const {
+    return (float)lastMillivoltsQ / (1 << decimator.getExtraBits());
+}
@@ -0,0 +1,91 @@
+#ifndef PRESSURE_SENSOR_H
+#define PRESSURE_SENSOR_H
+
+#include <Arduino.h>
+#include <Ticker.h>
+#include <atomic>
+#include "config.h"
+#include "level_sensor.h"
+#include "cic_decimator.h"
+
+// Raw ADC ring depth (must be a power of two)
+#define PRESSURE_RING_SIZE 64
+
+// Per-tank transducer scaling (stored in SystemConfig)
+struct PressureSensorConfig {
+    uint16_t zeroMv;        // ADC pin voltage at zero head
+    uint16_t fullScaleMv;   // ADC pin voltage at full-scale head
+    uint16_t rangeMm;       // Water head at full scale
+};
+
+// Lock-free single-producer/single-consumer ring of raw ADC samples (mV)
+class AdcSampleRing {
+public:
+    AdcSampleRing() : head(0), tail(0), overruns(0) {}
+    
+    bool push(uint16_t sample);
+    bool pop(uint16_t& sample);
+    void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+    uint32_t getOverruns() const { return overruns; }
+    
+private:
+    uint16_t slots[PRESSURE_RING_SIZE];
+    std::atomic<uint8_t> head;  // Written by the sampling timer
+    std::atomic<uint8_t> tail;  // Written by the sensor task
+    volatile uint32_t overruns;
+};
+
+/**
+ * Hydrostatic pressure transducer at the tank bottom.
+ *
+ * A timer samples the ADC at a fixed rate into a ring while a ping is in
+ * flight; the task drains it through an integer CIC decimator, so mains hum and ADC noise are
+ * averaged out with the oversampling gain kept as extra resolution. The
+ * head of water is reported as the distance from a virtual sensor at the
+ * empty calibration distance (emptyMm - head), so calibration, tank
+ * geometry and the shared filter work exactly as for ultrasonic sensors.
+ */
+class PressureSensor : public LevelSensor {
+public:
+    PressureSensor(uint8_t adcPin, const PressureSensorConfig& scaling, float emptyCm, float fullCm);
+    ~PressureSensor();
+    
+    // Initialize sensor (starts the sampling timer)
+    bool begin() override;
+    
+    // One decimated pressure sample
+    void startPing() override;
+    bool pollPing() override;
+    
+    uint32_t getTimeout() const override { return sampleTimeoutMs * 1000UL; }
+    uint8_t getDriver() const override { return DRIVER_PRESSURE; }
+    
+    // Transducer scaling
+    void setScaling(const PressureSensorConfig& scaling) { this->scaling = scaling; }
+    const PressureSensorConfig& getScaling() const { return scaling; }
+    
+    // Last decimated pin voltage (mV) and sampler statistics
+    float getLastMillivolts() const;
+    uint32_t getOverrunCount() const { return ring.getOverruns(); }
+    
+    // Decimated pin voltage (mV in Q(fractionBits)) to water head (mm);
+    // negative below zero, beyond rangeMm above full scale
+    static int32_t millivoltsToHeadMm(int32_t millivoltsQ, uint8_t fractionBits, 
+                                      const PressureSensorConfig& scaling);
+    
+private:
+    uint8_t adcPin;
+    PressureSensorConfig scaling;
+    
+    Ticker sampler;
+    AdcSampleRing ring;
+    std::atomic<bool> sampling;     // Timer only queues samples during a ping
+    CicDecimator decimator;
+    int32_t lastMillivoltsQ;
+    uint32_t pingStartMs;
+    uint32_t sampleTimeoutMs;
+    
+    static void onSampleTimer(PressureSensor* sensor);
+};
+
+#endif // PRESSURE_SENSOR_H
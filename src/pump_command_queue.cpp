@@ -0,0 +1,90 @@
+#include "pump_command_queue.h"
+
+PumpCommandQueue::PumpCommandQueue()
+    : enqueuePos(0), dequeuePos(0), dropped(0),
+      applied(0), avgLatencyUs(0), maxLatencyUs(0), lastLatencyUs(0) {
+    // Slot i is free for the producer that claims position i
+    for (uint32_t i = 0; i < PUMP_QUEUE_SIZE; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    for (uint32_t i = 0; i < PUMP_ACK_RING_SIZE; i++) {
+        acks[i].version.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool PumpCommandQueue::post(PumpCommand& command, uint32_t nowUs) {
+    uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[pos & (PUMP_QUEUE_SIZE - 1)];
+        int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            // Free: claim it unless another producer got there first
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);   // Full: the consumer is a lap behind
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    
+    command.ticket = pos;
+    command.postedUs = nowUs;
+    slot->command = command;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool PumpCommandQueue::take(PumpCommand& command) {
+    Slot& slot = slots[dequeuePos & (PUMP_QUEUE_SIZE - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+        return false; // Empty, or claimed but not yet written
+    }
+    
+    command = slot.command;
+    slot.sequence.store(dequeuePos + PUMP_QUEUE_SIZE, std::memory_order_release);
+    dequeuePos++;
+    return true;
+}
+
+void PumpCommandQueue::acknowledge(const PumpCommand& command, bool accepted, uint8_t state,
+                                   uint8_t fault, uint32_t nowUs) {
+    uint32_t latency = nowUs - command.postedUs;
+    uint32_t count = applied.load(std::memory_order_relaxed);
+    lastLatencyUs = latency;
+    if (latency > maxLatencyUs) {
+        maxLatencyUs = latency;
+    }
+    avgLatencyUs = count == 0 ? latency : avgLatencyUs + ((int32_t)(latency - avgLatencyUs) >> 3);
+    
+    AckSlot& slot = acks[command.ticket & (PUMP_ACK_RING_SIZE - 1)];
+    uint32_t version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.ack.ticket = command.ticket;
+    slot.ack.type = command.type;
+    slot.ack.origin = command.origin;
+    slot.ack.accepted = accepted;
+    slot.ack.state = state;
+    slot.ack.fault = fault;
+    slot.ack.latencyUs = latency;
+    slot.version.store(version + 2, std::memory_order_release);
+    
+    // Tickets are taken in order, so this one and all before it are done
+    applied.store(count + 1, std::memory_order_release);
+}
+
+bool PumpCommandQueue::getAck(uint32_t ticket, PumpCommandAck& ack) const {
+    const AckSlot& slot = acks[ticket & (PUMP_ACK_RING_SIZE - 1)];
+    uint32_t before, after;
+    do {
+        before = slot.version.load(std::memory_order_acquire);
+        ack = slot.ack;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = slot.version.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);  // Retry a read torn by the owner
+    return before != 0 && ack.ticket == ticket;
+}
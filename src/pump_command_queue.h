@@ -0,0 +1,122 @@
+#ifndef PUMP_COMMAND_QUEUE_H
+#define PUMP_COMMAND_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+#include "config.h"
+#include "level_sensor.h"
+
+// Slots are indexed by masking the position, which needs a power of two
+static_assert(PUMP_QUEUE_SIZE >= 2 && (PUMP_QUEUE_SIZE & (PUMP_QUEUE_SIZE - 1)) == 0,
+              "PUMP_QUEUE_SIZE must be a power of two");
+static_assert(PUMP_ACK_RING_SIZE >= 2 && (PUMP_ACK_RING_SIZE & (PUMP_ACK_RING_SIZE - 1)) == 0,
+              "PUMP_ACK_RING_SIZE must be a power of two");
+
+// What a command asks of the pump
+enum PumpCommandType {
+    PUMP_CMD_ON = 0,
+    PUMP_CMD_OFF = 1,
+    PUMP_CMD_READING = 2,       // New target reading for automatic control
+    PUMP_CMD_SERVICE = 3,       // A deadline is due
+    PUMP_CMD_MODE = 4,
+    PUMP_CMD_SCHEDULE = 5,      // Time zone or clock changed: look at the windows again
+    PUMP_CMD_WINDOWS = 6,       // New windows waiting in the controller's staging buffer
+    PUMP_CMD_RESET = 7          // Clear a fault (PUMP_ERROR back to PUMP_OFF)
+};
+
+// Who posted it
+enum PumpCommandOrigin {
+    PUMP_ORIGIN_WEB = 0,
+    PUMP_ORIGIN_MQTT = 1,
+    PUMP_ORIGIN_BLE = 2,
+    PUMP_ORIGIN_AUTO = 3,       // Sensor task readings
+    PUMP_ORIGIN_TIMER = 4,      // Deadline timer
+    PUMP_ORIGIN_COUNT = 5
+};
+
+struct PumpCommand {
+    uint8_t type;               // PumpCommandType
+    uint8_t origin;             // PumpCommandOrigin
+    uint8_t mode;               // PUMP_CMD_MODE
+    CentiPercent sourceLevel;   // PUMP_CMD_READING
+    SensorReading target;       // PUMP_CMD_READING
+    uint32_t ticket;            // Set by post()
+    uint32_t postedUs;
+};
+
+// Outcome of a command as applied by the owner
+struct PumpCommandAck {
+    uint32_t ticket;
+    uint8_t type;               // PumpCommandType
+    uint8_t origin;             // PumpCommandOrigin
+    bool accepted;              // False if the pump refused (e.g. in cooldown)
+    uint8_t state;              // PumpState right after
+    uint8_t fault;              // PumpFault right after
+    uint32_t latencyUs;         // Posted to applied
+};
+
+/**
+ * Commands to the pump from every task, applied by one owner.
+ *
+ * A bounded lock-free MPSC ring: producers (web, MQTT, BLE callbacks, the
+ * sensor task, the deadline timer) claim a slot with a compare-and-swap on
+ * the enqueue position and publish it through the slot's sequence number;
+ * the single consumer takes slots in order without atomic read-modify-write.
+ * A full ring refuses the command instead of blocking the caller.
+ *
+ * The consumer records the latency of every command, and its outcome in a
+ * ring indexed by ticket, so any task can look up the command it posted
+ * without locking, however many others were posted around it. The ring
+ * holds the last PUMP_ACK_RING_SIZE outcomes.
+ */
+class PumpCommandQueue {
+public:
+    PumpCommandQueue();
+    
+    // Producers (any task); false when the ring is full
+    bool post(PumpCommand& command, uint32_t nowUs);
+    
+    // Consumer (owner task only)
+    bool take(PumpCommand& command);
+    void acknowledge(const PumpCommand& command, bool accepted, uint8_t state, uint8_t fault, uint32_t nowUs);
+    
+    // Outcome of a ticket; false while it is pending or once it has been
+    // overwritten by newer ones (isPending() tells the two apart)
+    bool getAck(uint32_t ticket, PumpCommandAck& ack) const;
+    bool isPending(uint32_t ticket) const {
+        return (int32_t)(ticket - applied.load(std::memory_order_acquire)) >= 0;
+    }
+    
+    // Metrics
+    uint32_t getPostedCount() const { return enqueuePos.load(std::memory_order_relaxed); }
+    uint32_t getAppliedCount() const { return applied.load(std::memory_order_relaxed); }
+    uint32_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    uint32_t getAvgLatencyUs() const { return avgLatencyUs; }
+    uint32_t getMaxLatencyUs() const { return maxLatencyUs; }
+    uint32_t getLastLatencyUs() const { return lastLatencyUs; }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        PumpCommand command;
+    };
+    
+    // Ack of one ticket, guarded by a sequence counter (odd while written)
+    struct AckSlot {
+        std::atomic<uint32_t> version;
+        PumpCommandAck ack;
+    };
+    
+    Slot slots[PUMP_QUEUE_SIZE];
+    std::atomic<uint32_t> enqueuePos;
+    uint32_t dequeuePos;                // Consumer only
+    std::atomic<uint32_t> dropped;
+    
+    AckSlot acks[PUMP_ACK_RING_SIZE];   // Ticket modulo the ring size
+    std::atomic<uint32_t> applied;      // Tickets below this have an ack
+    uint32_t avgLatencyUs;              // EWMA, 1/8
+    uint32_t maxLatencyUs;
+    uint32_t lastLatencyUs;
+};
+
+#endif // PUMP_COMMAND_QUEUE_H
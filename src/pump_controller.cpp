@@ -6,7 +6,27 @@ PumpController::PumpController(ConfigManager& configManager)
       state(PUMP_OFF),
       pumpStartTime(0),
       pumpStopTime(0),
-      lastError("") {
+      lastError(""),
+      fault(PUMP_FAULT_NONE),
+      commandNotify(nullptr),
+      clock(&systemClock),
+      serviceRequested(false),
+      stopPending(false),
+      maxLatenessMs(0),
+      onThresholdCenti(0),
+      offThresholdCenti(CENTI_PERCENT_FULL),
+      decisionIntervalMs(SENSOR_READ_INTERVAL),
+      stopLatencyMs(PUMP_PREDICT_LATENCY_MS),
+      recordOpen(false),
+      runReading(),
+      stopLogHead(0),
+      stopLogCount(0),
+      stallBaseCenti(0),
+      stallBaseTime(0),
+      stallBaseSet(false),
+      windowOpen(false),
+      stagedCount(0),
+      stageBusy(false) {
 }
 
 bool PumpController::begin() {
@@ -16,6 +36,8 @@ bool PumpController::begin() {
     setRelay(false); // Ensure pump is off on startup
     
     setState(PUMP_OFF);
+    loadThresholds();
+    refreshSchedule();
     
     DEBUG_PRINTF("Pump controller initialized (Pin: %d, Mode: %d)\n", 
                  config.pumpRelayPin, config.pumpMode);
@@ -23,15 +45,117 @@ bool PumpController::begin() {
     return true;
 }
 
+bool PumpController::post(PumpCommandType type, PumpCommandOrigin origin, uint32_t* ticket) {
+    PumpCommand command = {};
+    command.type = type;
+    command.origin = origin;
+    if (!commands.post(command, clock->nowUs())) {
+        return false;
+    }
+    
+    if (ticket) {
+        *ticket = command.ticket;
+    }
+    if (commandNotify) {
+        commandNotify();
+    }
+    return true;
+}
+
+bool PumpController::postReading(const SensorReading& target, CentiPercent sourceLevel) {
+    PumpCommand command = {};
+    command.type = PUMP_CMD_READING;
+    command.origin = PUMP_ORIGIN_AUTO;
+    command.target = target;
+    command.sourceLevel = sourceLevel;
+    if (!commands.post(command, clock->nowUs())) {
+        return false;
+    }
+    
+    if (commandNotify) {
+        commandNotify();
+    }
+    return true;
+}
+
+bool PumpController::postMode(PumpMode mode, PumpCommandOrigin origin) {
+    PumpCommand command = {};
+    command.type = PUMP_CMD_MODE;
+    command.origin = origin;
+    command.mode = mode;
+    if (!commands.post(command, clock->nowUs())) {
+        return false;
+    }
+    
+    if (commandNotify) {
+        commandNotify();
+    }
+    return true;
+}
+
+uint8_t PumpController::processCommands() {
+    uint8_t count = 0;
+    PumpCommand command = {};
+    while (commands.take(command)) {
+        bool accepted = apply(command);
+        commands.acknowledge(command, accepted, state, fault, clock->nowUs());
+        count++;
+    }
+    
+    // A deadline whose service command did not fit in the queue
+    if (serviceRequested.exchange(false, std::memory_order_acquire)) {
+        service();
+    }
+    return count;
+}
+
+bool PumpController::apply(const PumpCommand& command) {
+    switch (command.type) {
+        case PUMP_CMD_ON:
+            return turnOn();
+        case PUMP_CMD_OFF:
+            return turnOff();
+        case PUMP_CMD_READING:
+            update(command.target, command.sourceLevel);
+            return true;
+        case PUMP_CMD_SERVICE:
+            serviceRequested.store(false, std::memory_order_relaxed);
+            service();
+            return true;
+        case PUMP_CMD_MODE:
+            setMode((PumpMode)command.mode);
+            return true;
+        case PUMP_CMD_SCHEDULE:
+            refreshSchedule();
+            return true;
+        case PUMP_CMD_WINDOWS:
+            applyStagedWindows();
+            return true;
+        case PUMP_CMD_RESET:
+            return resetFault();
+    }
+    return false;
+}
+
 bool PumpController::turnOn() {
+    const SystemConfig& config = configManager.getConfig();
+    
     if (!canStart()) {
-        DEBUG_PRINTF("Pump: Cannot start - %s\n", lastError.c_str());
+        DEBUG_PRINTF("Pump: Cannot start - %s\n", lastError.load());
         return false;
     }
     
     setRelay(true);
     setState(PUMP_ON);
-    pumpStartTime = millis();
+    pumpStartTime = clock->nowMs();
+    stopPending = false;
+    recordOpen = false;         // Restarted before the last stop settled
+    stallBaseSet = false;       // From the first reading of this run
+    
+    timers.cancel(PUMP_TIMER_COOLDOWN);
+    timers.arm(PUMP_TIMER_MIN_RUN, pumpStartTime + PUMP_MIN_RUN_TIME);
+    timers.arm(PUMP_TIMER_MAX_RUN, pumpStartTime + config.pumpMaxRunTime);
+    scheduleTicker();
     
     DEBUG_PRINTLN("Pump: Turned ON (manual)");
     return true;
@@ -39,9 +163,7 @@ bool PumpController::turnOn() {
 
 bool PumpController::turnOff() {
     if (state == PUMP_ON) {
-        setRelay(false);
-        setState(PUMP_COOLDOWN);
-        pumpStopTime = millis();
+        stop();
         
         DEBUG_PRINTLN("Pump: Turned OFF (manual)");
         return true;
@@ -50,15 +172,49 @@ bool PumpController::turnOff() {
     return false;
 }
 
-void PumpController::update(float currentLevel, float sourceLevel) {
+bool PumpController::resetFault() {
+    if (state != PUMP_ERROR) {
+        return false;
+    }
+    
+    DEBUG_PRINTF("Pump: Fault %d reset\n", fault);
+    fault = PUMP_FAULT_NONE;
+    lastError = "";
+    setState(PUMP_OFF);
+    return true;
+}
+
+void PumpController::stop() {
     const SystemConfig& config = configManager.getConfig();
     
-    // Only auto-control if in automatic mode
-    if (config.pumpMode != PUMP_AUTOMATIC) {
-        // Still enforce safety limits even in manual mode
-        if (state == PUMP_ON && shouldStop()) {
-            emergencyStop("Safety limit reached");
-        }
+    setRelay(false);
+    setState(PUMP_COOLDOWN);
+    pumpStopTime = clock->nowMs();
+    stopPending = false;
+    
+    timers.cancel(PUMP_TIMER_MIN_RUN);
+    timers.cancel(PUMP_TIMER_MAX_RUN);
+    timers.arm(PUMP_TIMER_COOLDOWN, pumpStopTime + config.pumpCooldownTime);
+    scheduleTicker();
+}
+
+void PumpController::update(const SensorReading& target, CentiPercent sourceLevel) {
+    const SystemConfig& config = configManager.getConfig();
+    CentiPercent currentLevel = target.filteredCenti;
+    
+    // Catch up if the timer has not run yet
+    service();
+    trackStopRecord(target);
+    checkStall(target);
+    if (state == PUMP_ON && target.isValid) {
+        runReading = target;
+    }
+    
+    // Only auto-control in automatic mode or inside a scheduled window
+    // (time limits apply in any mode)
+    bool automatic = config.pumpMode == PUMP_AUTOMATIC ||
+                     (config.pumpMode == PUMP_SCHEDULED && windowOpen);
+    if (!automatic) {
         return;
     }
     
@@ -66,42 +222,297 @@ void PumpController::update(float currentLevel, float sourceLevel) {
     switch (state) {
         case PUMP_OFF:
             // Check if we should start
-            if (currentLevel <= config.pumpAutoOnThreshold) {
+            if (currentLevel <= onThresholdCenti) {
                 if (canStart() && isSafe(sourceLevel)) {
-                    DEBUG_PRINTF("Pump: Auto-starting (level: %.1f%% <= %.1f%%)\n", 
-                                currentLevel, config.pumpAutoOnThreshold);
+                    DEBUG_PRINTF("Pump: Auto-starting (level: %d.%02d%% <= %d.%02d%%)\n", 
+                                currentLevel / 100, currentLevel % 100,
+                                onThresholdCenti / 100, onThresholdCenti % 100);
                     turnOn();
                 }
             }
             break;
+        
+        case PUMP_ON: {
+            // Check if we should stop (once; a held stop waits for the minimum run)
+            bool levelStop = false;
+            if (stopPending) {
+                // Already decided
+            } else if (currentLevel >= offThresholdCenti) {
+                DEBUG_PRINTF("Pump: Auto-stopping (level: %d.%02d%% >= %d.%02d%%)\n", 
+                            currentLevel / 100, currentLevel % 100,
+                            offThresholdCenti / 100, offThresholdCenti % 100);
+                openStopRecord(target, false);
+                levelStop = true;
+            } else if (config.pumpPredictiveStop && projectsPastThreshold(target)) {
+                DEBUG_PRINTF("Pump: Predictive stop (level: %d.%02d%%, rising %d.%02d%%/min)\n",
+                            currentLevel / 100, currentLevel % 100,
+                            target.rateCentiPerMin / 100, target.rateCentiPerMin % 100);
+                openStopRecord(target, true);
+                levelStop = true;
+            }
             
-        case PUMP_ON:
-            // Check if we should stop
-            if (currentLevel >= config.pumpAutoOffThreshold) {
-                DEBUG_PRINTF("Pump: Auto-stopping (level: %.1f%% >= %.1f%%)\n", 
-                            currentLevel, config.pumpAutoOffThreshold);
-                turnOff();
-            } else if (shouldStop()) {
-                emergencyStop("Safety limit reached");
-            } else if (!isSafe(sourceLevel)) {
-                emergencyStop("Source tank too low");
+            if (levelStop) {
+                if (!timers.isArmed(PUMP_TIMER_MIN_RUN)) {
+                    stop();
+                    break;
+                }
+                stopPending = true;     // Stops when the minimum run time is up
+            }
+            if (!isSafe(sourceLevel)) {
+                emergencyStop(PUMP_FAULT_SOURCE_LOW, "Source tank too low");
             }
             break;
-            
+        }
+        
         case PUMP_COOLDOWN:
-            // Check if cooldown period is over
-            if (millis() - pumpStopTime >= config.pumpCooldownTime) {
+        case PUMP_ERROR:
+            // Cooldown ends on its timer; errors need manual intervention
+            break;
+    }
+}
+
+void PumpController::service() {
+    uint32_t now = clock->nowMs();
+    
+    uint8_t timer;
+    while (timers.popExpired(now, timer)) {
+        uint32_t lateness = now - timers.getDeadline(timer);
+        if (lateness > maxLatenessMs) {
+            maxLatenessMs = lateness;
+        }
+        onDeadline(timer);
+    }
+    
+    scheduleTicker();
+}
+
+void PumpController::onDeadline(uint8_t timer) {
+    switch (timer) {
+        case PUMP_TIMER_MIN_RUN:
+            if (state == PUMP_ON && stopPending) {
+                DEBUG_PRINTLN("Pump: Minimum run time reached, stopping");
+                // The level kept rising while the stop was held; that rise is
+                // not stop latency, so the record starts from here instead
+                openStopRecord(runReading, openRecord.predictive);
+                stop();
+            }
+            break;
+        
+        case PUMP_TIMER_MAX_RUN:
+            if (state == PUMP_ON) {
+                emergencyStop(PUMP_FAULT_MAX_RUN, "Maximum run time exceeded");
+            }
+            break;
+        
+        case PUMP_TIMER_COOLDOWN:
+            if (state == PUMP_COOLDOWN) {
                 DEBUG_PRINTLN("Pump: Cooldown complete");
                 setState(PUMP_OFF);
             }
             break;
-            
-        case PUMP_ERROR:
-            // Require manual intervention
+        
+        case PUMP_TIMER_WINDOW:
+            checkWindow();
             break;
     }
 }
 
+void PumpController::scheduleTicker() {
+    // Only the real clock is backed by a timer
+    if (clock != &systemClock) {
+        return;
+    }
+    
+    ticker.detach();
+    uint32_t ms;
+    if (timers.nextIn(clock->nowMs(), ms)) {
+        ticker.once_ms(ms > 0 ? ms : 1, onTicker, this);
+    }
+}
+
+void PumpController::checkWindow() {
+    const SystemConfig& config = configManager.getConfig();
+    timers.cancel(PUMP_TIMER_WINDOW);
+    
+    bool open = false;
+    uint32_t second, seconds;
+    uint32_t waitMs = 0;
+    if (config.pumpMode != PUMP_SCHEDULED) {
+        // No windows outside scheduled mode
+    } else if (!clock->localSecondOfWeek(second)) {
+        waitMs = PUMP_SCHEDULE_RETRY_MS;    // Closed until the clock is set
+    } else if (schedule.nextChange(second, open, seconds)) {
+        // Woken at least hourly so clock corrections are picked up
+        waitMs = seconds < PUMP_SCHEDULE_RECHECK_MS / 1000 ? seconds * 1000 : PUMP_SCHEDULE_RECHECK_MS;
+    }
+    
+    if (open != windowOpen) {
+        windowOpen = open;
+        DEBUG_PRINTF("Pump: Schedule window %s\n", open ? "opened" : "closed");
+        if (!open && state == PUMP_ON && config.pumpMode == PUMP_SCHEDULED) {
+            DEBUG_PRINTLN("Pump: Window closed, stopping");
+            stop();
+        }
+    }
+    if (waitMs > 0) {
+        timers.arm(PUMP_TIMER_WINDOW, clock->nowMs() + waitMs);
+    }
+}
+
+void PumpController::refreshSchedule() {
+    const SystemConfig& config = configManager.getConfig();
+    if (!schedule.setWindows(config.pumpWindows, config.pumpWindowCount)) {
+        DEBUG_PRINTLN("Pump: Invalid schedule windows ignored");
+        schedule.setWindows(nullptr, 0);
+    }
+    checkWindow();
+    scheduleTicker();
+}
+
+bool PumpController::setSchedule(const PumpWindow* windows, uint8_t count, PumpCommandOrigin origin,
+                                 uint32_t* ticket) {
+    PumpSchedule candidate;
+    if (!candidate.setWindows(windows, count)) {
+        return false;
+    }
+    
+    // The config belongs to the owner: stage the windows and let it copy
+    // them over; one change at a time, the owner frees the stage
+    if (stageBusy.exchange(true, std::memory_order_acquire)) {
+        DEBUG_PRINTLN("Pump: Schedule change already pending");
+        return false;
+    }
+    memcpy(stagedWindows, windows, count * sizeof(PumpWindow));
+    stagedCount = count;
+    
+    if (!post(PUMP_CMD_WINDOWS, origin, ticket)) {
+        stageBusy.store(false, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void PumpController::applyStagedWindows() {
+    SystemConfig& config = configManager.getConfigRef();
+    memcpy(config.pumpWindows, stagedWindows, stagedCount * sizeof(PumpWindow));
+    config.pumpWindowCount = stagedCount;
+    stageBusy.store(false, std::memory_order_release);
+    
+    configManager.requestSave();
+    refreshSchedule();
+    DEBUG_PRINTF("Pump: Schedule set (%d windows)\n", config.pumpWindowCount);
+}
+
+bool PumpController::getWindowChangeIn(uint32_t& ms) const {
+    if (!timers.isArmed(PUMP_TIMER_WINDOW)) {
+        return false;
+    }
+    uint32_t remaining = timers.getDeadline(PUMP_TIMER_WINDOW) - clock->nowMs();
+    ms = (int32_t)remaining > 0 ? remaining : 0;
+    return true;
+}
+
+void PumpController::onTicker(PumpController* pump) {
+    // Timer context: the owner runs the deadlines. The ticker is one-shot,
+    // so a post refused by a full queue must not lose the wake-up: the flag
+    // is checked after every batch, and the owner is woken regardless
+    pump->serviceRequested.store(true, std::memory_order_release);
+    if (!pump->post(PUMP_CMD_SERVICE, PUMP_ORIGIN_TIMER) && pump->commandNotify) {
+        pump->commandNotify();
+    }
+}
+
+bool PumpController::projectsPastThreshold(const SensorReading& target) const {
+    if (target.rateCentiPerMin < PUMP_PREDICT_MIN_RATE) {
+        return false; // Too slow (or noisy) to extrapolate
+    }
+    
+    // If we wait, the next decision comes one interval from now and the
+    // level then keeps rising for the stop latency; the reading is already
+    // this old
+    uint32_t horizonMs = (clock->nowMs() - target.timestamp) + decisionIntervalMs + stopLatencyMs;
+    int32_t projected = target.filteredCenti + (int32_t)((int64_t)target.rateCentiPerMin * horizonMs / 60000);
+    return projected >= offThresholdCenti;
+}
+
+void PumpController::openStopRecord(const SensorReading& target, bool predictive) {
+    int32_t rise = (int32_t)((int64_t)max((int16_t)0, target.rateCentiPerMin) * stopLatencyMs / 60000);
+    
+    openRecord.timestamp = clock->nowMs();
+    openRecord.levelCenti = target.filteredCenti;
+    openRecord.predictedCenti = (CentiPercent)min((int32_t)CENTI_PERCENT_FULL, target.filteredCenti + rise);
+    openRecord.actualCenti = target.filteredCenti;
+    openRecord.rateCentiPerMin = target.rateCentiPerMin;
+    openRecord.predictive = predictive;
+    recordOpen = true;
+}
+
+void PumpController::trackStopRecord(const SensorReading& target) {
+    if (!recordOpen || state == PUMP_ON) {
+        return;
+    }
+    
+    if (target.isValid && target.filteredCenti > openRecord.actualCenti) {
+        openRecord.actualCenti = target.filteredCenti;
+    }
+    if (clock->nowMs() - pumpStopTime < PUMP_PREDICT_SETTLE_MS) {
+        return;
+    }
+    
+    // Settled: keep the record and learn how long the level kept rising
+    recordOpen = false;
+    stopLog[stopLogHead] = openRecord;
+    stopLogHead = (stopLogHead + 1) % PUMP_STOP_LOG_SIZE;
+    if (stopLogCount < PUMP_STOP_LOG_SIZE) stopLogCount++;
+    
+    if (openRecord.rateCentiPerMin >= PUMP_PREDICT_MIN_RATE) {
+        int32_t rise = max((int32_t)0, (int32_t)openRecord.actualCenti - openRecord.levelCenti);
+        uint32_t observedMs = (uint32_t)min((int64_t)PUMP_PREDICT_LATENCY_MAX_MS,
+                                            (int64_t)rise * 60000 / openRecord.rateCentiPerMin);
+        stopLatencyMs = (int32_t)stopLatencyMs + ((int32_t)observedMs - (int32_t)stopLatencyMs) / 4;
+    }
+    
+    DEBUG_PRINTF("Pump: %s stop at %d.%02d%%, predicted %d.%02d%%, actual %d.%02d%% (latency now %lu ms)\n",
+                 openRecord.predictive ? "Predictive" : "Threshold",
+                 openRecord.levelCenti / 100, openRecord.levelCenti % 100,
+                 openRecord.predictedCenti / 100, openRecord.predictedCenti % 100,
+                 openRecord.actualCenti / 100, openRecord.actualCenti % 100,
+                 (unsigned long)stopLatencyMs);
+}
+
+void PumpController::checkStall(const SensorReading& target) {
+    const SystemConfig& config = configManager.getConfig();
+    if (state != PUMP_ON || config.pumpStallWindow == 0 || !target.isValid ||
+        (int32_t)(target.timestamp - pumpStartTime) < 0) {
+        return; // Readings from before this run prove nothing
+    }
+    
+    // Every window of readings must show the rise; progress starts a new one
+    CentiPercent rise = percentToCenti(config.pumpStallRise);
+    if (!stallBaseSet || target.filteredCenti >= stallBaseCenti + rise) {
+        stallBaseCenti = target.filteredCenti;
+        stallBaseTime = target.timestamp;
+        stallBaseSet = true;
+        return;
+    }
+    if (target.timestamp - stallBaseTime < config.pumpStallWindow) {
+        return;
+    }
+    if (stallBaseCenti + rise > CENTI_PERCENT_FULL) {
+        return; // Full (manual run): there is no room left to rise
+    }
+    
+    DEBUG_PRINTF("Pump: Level stalled at %d.%02d%% for %lu s\n",
+                 target.filteredCenti / 100, target.filteredCenti % 100,
+                 (unsigned long)((target.timestamp - stallBaseTime) / 1000));
+    emergencyStop(PUMP_FAULT_NO_RISE, "No level rise (dry run)");
+}
+
+const PumpStopRecord& PumpController::getStopRecord(uint8_t index) const {
+    uint8_t oldest = (stopLogHead + PUMP_STOP_LOG_SIZE - stopLogCount) % PUMP_STOP_LOG_SIZE;
+    return stopLog[(oldest + index) % PUMP_STOP_LOG_SIZE];
+}
+
 bool PumpController::canStart() const {
     const SystemConfig& config = configManager.getConfig();
     
@@ -129,32 +540,9 @@ bool PumpController::canStart() const {
     return true;
 }
 
-bool PumpController::shouldStop() const {
-    const SystemConfig& config = configManager.getConfig();
-    
-    if (state != PUMP_ON) {
-        return false;
-    }
-    
-    uint32_t runtime = millis() - pumpStartTime;
-    
-    // Check minimum run time
-    if (runtime < PUMP_MIN_RUN_TIME) {
-        return false; // Too soon to stop
-    }
-    
-    // Check maximum run time
-    if (runtime >= config.pumpMaxRunTime) {
-        lastError = "Maximum run time exceeded";
-        return true;
-    }
-    
-    return false;
-}
-
-bool PumpController::isSafe(float sourceLevel) {
+bool PumpController::isSafe(CentiPercent sourceLevel) {
     // Check if source tank has enough water
-    if (sourceLevel < PUMP_DRY_RUN_THRESHOLD) {
+    if (sourceLevel < PERCENT_TO_CENTI(PUMP_DRY_RUN_THRESHOLD)) {
         lastError = "Source tank too low (dry-run protection)";
         return false;
     }
@@ -169,7 +557,7 @@ uint32_t PumpController::getCooldownRemaining() const {
         return 0;
     }
     
-    uint32_t elapsed = millis() - pumpStopTime;
+    uint32_t elapsed = clock->nowMs() - pumpStopTime;
     if (elapsed >= config.pumpCooldownTime) {
         return 0;
     }
@@ -180,6 +568,7 @@ uint32_t PumpController::getCooldownRemaining() const {
 void PumpController::setMode(PumpMode mode) {
     SystemConfig& config = configManager.getConfigRef();
     config.pumpMode = mode;
+    refreshSchedule();
     DEBUG_PRINTF("Pump: Mode set to %d\n", mode);
 }
 
@@ -193,6 +582,7 @@ void PumpController::setThresholds(float onThreshold, float offThreshold) {
     if (onThreshold < offThreshold && onThreshold >= 0 && offThreshold <= 100) {
         config.pumpAutoOnThreshold = onThreshold;
         config.pumpAutoOffThreshold = offThreshold;
+        loadThresholds();
         DEBUG_PRINTF("Pump: Thresholds set (ON: %.1f%%, OFF: %.1f%%)\n", 
                      onThreshold, offThreshold);
     }
@@ -209,16 +599,29 @@ void PumpController::setState(PumpState newState) {
     }
 }
 
-void PumpController::emergencyStop(const char* reason) {
+void PumpController::emergencyStop(PumpFault fault, const char* reason) {
     DEBUG_PRINTF("Pump: EMERGENCY STOP - %s\n", reason);
     
     setRelay(false);
     setState(PUMP_ERROR);
     lastError = reason;
+    this->fault = fault;
+    stopPending = false;
+    recordOpen = false;         // A level stop cut short proves nothing about the latency
+    
+    timers.cancel(PUMP_TIMER_MIN_RUN);
+    timers.cancel(PUMP_TIMER_MAX_RUN);
+    scheduleTicker();
     
     // Could also trigger an alarm, send notification, etc.
 }
 
+void PumpController::loadThresholds() {
+    const SystemConfig& config = configManager.getConfig();
+    onThresholdCenti = percentToCenti(config.pumpAutoOnThreshold);
+    offThresholdCenti = percentToCenti(config.pumpAutoOffThreshold);
+}
+
 void PumpController::setRelay(bool on) {
     const SystemConfig& config = configManager.getConfig();
     digitalWrite(config.pumpRelayPin, on ? HIGH : LOW);
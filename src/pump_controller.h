@@ -2,8 +2,13 @@
 #define PUMP_CONTROLLER_H
 
 #include <Arduino.h>
+#include <Ticker.h>
 #include "config_manager.h"
-#include "sensor_ultrasonic.h"
+#include "level_sensor.h"
+#include "deadline_timer.h"
+#include "pump_schedule.h"
+#include "pump_command_queue.h"
+#include <atomic>
 
 // Pump state
 enum PumpState {
@@ -13,6 +18,60 @@ enum PumpState {
     PUMP_ERROR = 3
 };
 
+// Why the pump is in PUMP_ERROR
+enum PumpFault {
+    PUMP_FAULT_NONE = 0,
+    PUMP_FAULT_MAX_RUN = 1,     // Ran past pumpMaxRunTime
+    PUMP_FAULT_SOURCE_LOW = 2,  // Source tank below PUMP_DRY_RUN_THRESHOLD
+    PUMP_FAULT_NO_RISE = 3      // Target level stalled while running (dry source)
+};
+
+// Pump deadlines (DeadlineTimers ids)
+enum PumpTimer {
+    PUMP_TIMER_MIN_RUN = 0,     // Earliest automatic stop
+    PUMP_TIMER_MAX_RUN = 1,     // Forced stop (pumpMaxRunTime)
+    PUMP_TIMER_COOLDOWN = 2,    // Back to PUMP_OFF (pumpCooldownTime)
+    PUMP_TIMER_WINDOW = 3       // Next schedule window edge (scheduled mode)
+};
+
+// One automatic stop on level, predicted against what followed
+struct PumpStopRecord {
+    uint32_t timestamp;         // When the relay opened
+    CentiPercent levelCenti;    // Filtered level of the last reading before it
+    CentiPercent predictedCenti; // Expected peak: level + rate × latency estimate
+    CentiPercent actualCenti;   // Highest level seen while settling after the stop
+    int16_t rateCentiPerMin;    // Fill rate of the last reading before it
+    bool predictive;            // Stopped ahead of the OFF threshold
+};
+
+/**
+ * Relay control with hysteresis thresholds and run-time safety limits.
+ *
+ * One owner task runs the controller. Every other task (web, MQTT and BLE
+ * callbacks, sensor readings, the deadline timer) posts commands to a
+ * lock-free queue and looks up the outcome by the ticket it got back;
+ * the methods below that change state are for the owner (or a host
+ * simulation) only.
+ *
+ * Level decisions come from update() after each reading. Time limits do
+ * not: minimum run, maximum run and cooldown are one-shot deadlines on a
+ * Ticker armed for the earliest of them, so they fire on time however long
+ * the sensor loop takes.
+ *
+ * Optional predictive auto-off stops as soon as the level, projected from
+ * the fill rate over the next decision interval plus the stop latency,
+ * would pass the OFF threshold. The latency (sensing and filter delay,
+ * relay, water still in the pipe) is learned from how far the level kept
+ * rising after earlier stops.
+ *
+ * Dry running is caught from the target tank alone: while the pump runs,
+ * its level must rise by pumpStallRise within every pumpStallWindow of
+ * readings, which needs no source sensor and no extra reads.
+ *
+ * In scheduled mode the same level control runs only inside the weekly
+ * windows. The next window edge is one more deadline, so the schedule is
+ * looked at once per edge; closing a window stops the pump.
+ */
 class PumpController {
 public:
     PumpController(ConfigManager& configManager);
@@ -20,41 +79,133 @@ public:
     // Initialize pump controller
     bool begin();
     
+    // Any task: queue a command for the owner; false when the queue is full
+    bool post(PumpCommandType type, PumpCommandOrigin origin, uint32_t* ticket = nullptr);
+    bool postReading(const SensorReading& target, CentiPercent sourceLevel = CENTI_PERCENT_FULL);
+    bool postMode(PumpMode mode, PumpCommandOrigin origin);
+    void setCommandNotify(void (*notify)()) { commandNotify = notify; }   // Wakes the owner
+    const PumpCommandQueue& getCommandQueue() const { return commands; }
+    
+    // Owner task: apply the queued commands in order; returns how many
+    uint8_t processCommands();
+    
     // Manual control
     bool turnOn();
     bool turnOff();
+    bool resetFault();          // Once the cause is fixed; false if there is no fault
+    
+    // Automatic control from a new reading of the target tank
+    void update(const SensorReading& target, CentiPercent sourceLevel = CENTI_PERCENT_FULL);
+    
+    // Expected time to the next update() (the sampling interval)
+    void setDecisionInterval(uint32_t ms) { decisionIntervalMs = ms; }
+    
+    // Run due deadlines (called by the timer; safe to call at any time)
+    void service();
     
-    // Automatic control (must be called regularly)
-    void update(float currentLevel, float sourceLevel = 100.0);
+    // Time source for the deadlines and schedule windows (default millis()
+    // and NTP time; a VirtualClock on a host, which then calls service() itself)
+    void setClock(const Clock* clock) { this->clock = clock; }
     
     // Status
     bool isRunning() const { return (state == PUMP_ON); }
     PumpState getState() const { return state; }
-    uint32_t getRunTime() const { return isRunning() ? (millis() - pumpStartTime) : 0; }
+    uint32_t getRunTime() const { return isRunning() ? (clock->nowMs() - pumpStartTime) : 0; }
     uint32_t getCooldownRemaining() const;
+    bool isStopPending() const { return stopPending; }  // Auto stop held back by the minimum run
+    uint32_t getMaxTimerLateness() const { return maxLatenessMs; }
+    
+    // Level stops, oldest first (index < getStopLogCount())
+    uint8_t getStopLogCount() const { return stopLogCount; }
+    const PumpStopRecord& getStopRecord(uint8_t index) const;
+    uint32_t getStopLatency() const { return stopLatencyMs; }   // Learned stop latency
     
     // Configuration
     void setMode(PumpMode mode);
     PumpMode getMode() const;
     void setThresholds(float onThreshold, float offThreshold);
     
-    // Safety checks
-    bool isSafe(float sourceLevel);
-    String getLastError() const { return lastError; }
+    // Scheduled mode windows (any task): validated and staged; the owner
+    // stores them in the config, persists and reloads them. False if one is
+    // invalid, the queue is full or an earlier change is still pending
+    bool setSchedule(const PumpWindow* windows, uint8_t count, PumpCommandOrigin origin,
+                     uint32_t* ticket = nullptr);
+    
+    // Reload the windows and look at the clock again (mode, time zone or
+    // clock changed)
+    void refreshSchedule();
+    bool isWindowOpen() const { return windowOpen; }
+    bool getWindowChangeIn(uint32_t& ms) const;  // False when no edge is pending
     
+    // Safety checks
+    bool isSafe(CentiPercent sourceLevel);
+    const char* getLastError() const { return lastError.load(); }
+    PumpFault getFault() const { return fault; }
+
 private:
     ConfigManager& configManager;
     PumpState state;
     uint32_t pumpStartTime;
     uint32_t pumpStopTime;
-    mutable String lastError;
+    mutable std::atomic<const char*> lastError;    // Read by any task
+    PumpFault fault;
+    
+    // Commands from other tasks
+    PumpCommandQueue commands;
+    void (*commandNotify)();
+    
+    // Deadlines
+    SystemClock systemClock;
+    const Clock* clock;
+    DeadlineTimers timers;
+    Ticker ticker;
+    std::atomic<bool> serviceRequested;     // Set by the ticker, cleared by the owner
+    bool stopPending;
+    uint32_t maxLatenessMs;     // Worst deadline-to-transition delay seen
+    
+    // Auto thresholds in fixed point, refreshed when the config changes
+    CentiPercent onThresholdCenti;
+    CentiPercent offThresholdCenti;
+    
+    // Predictive auto-off
+    uint32_t decisionIntervalMs;
+    uint32_t stopLatencyMs;
+    PumpStopRecord openRecord;  // Settling after the latest level stop
+    bool recordOpen;
+    SensorReading runReading;   // Latest valid reading while running (re-bases a held stop)
+    PumpStopRecord stopLog[PUMP_STOP_LOG_SIZE];
+    uint8_t stopLogHead;
+    uint8_t stopLogCount;
+    
+    // Dry-run detection: the level the current stall window started from
+    CentiPercent stallBaseCenti;
+    uint32_t stallBaseTime;
+    bool stallBaseSet;
+    
+    // Scheduled mode
+    PumpSchedule schedule;
+    bool windowOpen;
+    PumpWindow stagedWindows[PUMP_SCHEDULE_MAX_WINDOWS];   // From setSchedule(), for the owner
+    uint8_t stagedCount;
+    std::atomic<bool> stageBusy;
     
     // Internal helpers
     bool canStart() const;
-    bool shouldStop() const;
+    void stop();
     void setState(PumpState newState);
-    void emergencyStop(const char* reason);
+    void emergencyStop(PumpFault fault, const char* reason);
+    void onDeadline(uint8_t timer);
+    void scheduleTicker();
+    bool apply(const PumpCommand& command);
+    void checkWindow();
+    void applyStagedWindows();
+    static void onTicker(PumpController* pump);
     void setRelay(bool on);
+    void loadThresholds();
+    bool projectsPastThreshold(const SensorReading& target) const;
+    void openStopRecord(const SensorReading& target, bool predictive);
+    void trackStopRecord(const SensorReading& target);
+    void checkStall(const SensorReading& target);
 };
 
 #endif // PUMP_CONTROLLER_H
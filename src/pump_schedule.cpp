@@ -0,0 +1,134 @@
+#include "pump_schedule.h"
+#include <stdio.h>
+
+PumpSchedule::PumpSchedule() : edgeCount(0) {
+}
+
+bool PumpSchedule::setWindows(const PumpWindow* windows, uint8_t count) {
+    if (count > PUMP_SCHEDULE_MAX_WINDOWS) {
+        return false;
+    }
+    
+    // Split windows across the week end, then sort by start (a handful)
+    PumpWindow spans[PUMP_SCHEDULE_MAX_WINDOWS * 2];
+    uint8_t spanCount = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const PumpWindow& window = windows[i];
+        if (window.startMin >= MINUTES_PER_WEEK || window.endMin >= MINUTES_PER_WEEK) {
+            return false;
+        }
+        if (window.endMin == window.startMin) {
+            continue;
+        }
+        if (window.endMin > window.startMin) {
+            spans[spanCount++] = window;
+        } else {
+            spans[spanCount].startMin = window.startMin;
+            spans[spanCount++].endMin = MINUTES_PER_WEEK;
+            if (window.endMin > 0) {
+                spans[spanCount].startMin = 0;
+                spans[spanCount++].endMin = window.endMin;
+            }
+        }
+    }
+    for (uint8_t i = 1; i < spanCount; i++) {
+        PumpWindow span = spans[i];
+        uint8_t j = i;
+        while (j > 0 && spans[j - 1].startMin > span.startMin) {
+            spans[j] = spans[j - 1];
+            j--;
+        }
+        spans[j] = span;
+    }
+    
+    // Overlapping and touching windows become one
+    edgeCount = 0;
+    for (uint8_t i = 0; i < spanCount; i++) {
+        if (edgeCount > 0 && spans[i].startMin <= edges[edgeCount - 1]) {
+            if (spans[i].endMin > edges[edgeCount - 1]) {
+                edges[edgeCount - 1] = spans[i].endMin;
+            }
+        } else {
+            edges[edgeCount++] = spans[i].startMin;
+            edges[edgeCount++] = spans[i].endMin;
+        }
+    }
+    return true;
+}
+
+uint8_t PumpSchedule::edgesUpTo(uint32_t secondOfWeek) const {
+    // Upper bound: the first edge after the given second
+    uint8_t low = 0;
+    uint8_t high = edgeCount;
+    while (low < high) {
+        uint8_t mid = (low + high) / 2;
+        if ((uint32_t)edges[mid] * 60 <= secondOfWeek) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool PumpSchedule::nextChange(uint32_t secondOfWeek, bool& open, uint32_t& seconds) const {
+    open = false;
+    if (edgeCount == 0) {
+        return false;
+    }
+    
+    uint8_t passed = edgesUpTo(secondOfWeek);
+    open = passed & 1;
+    if (passed < edgeCount) {
+        seconds = (uint32_t)edges[passed] * 60 - secondOfWeek;
+        
+        // A window across the week end is stored split; it really closes
+        // at the first close of the next week
+        if (edges[passed] == MINUTES_PER_WEEK && edges[0] == 0 && edgeCount > 2) {
+            seconds += (uint32_t)edges[1] * 60;
+        }
+    } else {
+        seconds = SECONDS_PER_WEEK - secondOfWeek + (uint32_t)edges[0] * 60;    // Next week
+    }
+    return true;
+}
+
+uint8_t PumpSchedule::makeWindows(uint8_t day, const char* start, const char* end,
+                                  PumpWindow* windows, uint8_t room) {
+    uint16_t startMin, endMin;
+    if (day > SCHEDULE_EVERY_DAY || !parseTime(start, startMin) || !parseTime(end, endMin)) {
+        return 0;
+    }
+    if (endMin <= startMin) {
+        endMin += MINUTES_PER_DAY;
+    }
+    
+    uint8_t first = day == SCHEDULE_EVERY_DAY ? 0 : day;
+    uint8_t count = day == SCHEDULE_EVERY_DAY ? 7 : 1;
+    if (count > room) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        uint16_t base = (first + i) * MINUTES_PER_DAY;
+        windows[i].startMin = base + startMin;
+        windows[i].endMin = (base + endMin) % MINUTES_PER_WEEK;
+    }
+    return count;
+}
+
+bool PumpSchedule::parseTime(const char* text, uint16_t& minuteOfDay) {
+    unsigned hour, minute;
+    if (!text || sscanf(text, "%u:%u", &hour, &minute) != 2 || hour > 23 || minute > 59) {
+        return false;
+    }
+    minuteOfDay = hour * 60 + minute;
+    return true;
+}
+
+size_t PumpSchedule::formatMinute(char* text, size_t size, uint16_t minuteOfWeek) {
+    static const char* days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    uint16_t minute = minuteOfWeek % MINUTES_PER_WEEK;
+    int length = snprintf(text, size, "%s %02u:%02u", days[minute / MINUTES_PER_DAY],
+                          (unsigned)(minute % MINUTES_PER_DAY / 60), (unsigned)(minute % 60));
+    return length < 0 ? 0 : (size_t)length;
+}
@@ -0,0 +1,62 @@
+#ifndef PUMP_SCHEDULE_H
+#define PUMP_SCHEDULE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+#include "deadline_timer.h"
+
+#define MINUTES_PER_DAY  1440
+#define MINUTES_PER_WEEK 10080
+#define SCHEDULE_EVERY_DAY 7    // Day value for makeWindows()
+
+// Weekly window in local minutes since Sunday 00:00; an end before the start
+// runs past Saturday midnight, an end equal to the start is empty
+struct PumpWindow {
+    uint16_t startMin;
+    uint16_t endMin;
+};
+
+/**
+ * Weekly pumping windows (e.g. off-peak electricity tariffs).
+ *
+ * The windows are merged into one sorted list of edges, alternately
+ * opening and closing. A time is inside a window when an odd number of
+ * edges lie at or before it, so whether the window is open and how long
+ * until the next edge is one binary search; the pump sleeps on a single
+ * deadline until then instead of checking the clock every cycle.
+ *
+ * Platform independent so schedules can be driven by a VirtualClock on a host.
+ */
+class PumpSchedule {
+public:
+    PumpSchedule();
+    
+    // Replace the windows; false (schedule unchanged) if one is out of range
+    bool setWindows(const PumpWindow* windows, uint8_t count);
+    bool isEmpty() const { return edgeCount == 0; }
+    
+    bool isOpen(uint32_t secondOfWeek) const { return edgesUpTo(secondOfWeek) & 1; }
+    
+    // Seconds from secondOfWeek to the next edge and whether a window is
+    // open until then; false for an empty schedule, which never opens
+    bool nextChange(uint32_t secondOfWeek, bool& open, uint32_t& seconds) const;
+    
+    // Windows for one day (0 = Sunday) or SCHEDULE_EVERY_DAY from "HH:MM"
+    // start and end; an end at or before the start is on the next day.
+    // Returns the number written (0 on a bad time or too little room)
+    static uint8_t makeWindows(uint8_t day, const char* start, const char* end,
+                               PumpWindow* windows, uint8_t room);
+    
+    // "Mon 23:00"; returns the length written
+    static size_t formatMinute(char* text, size_t size, uint16_t minuteOfWeek);
+
+private:
+    uint16_t edges[PUMP_SCHEDULE_MAX_WINDOWS * 2 + 2];  // A window across the week end splits
+    uint8_t edgeCount;
+    
+    uint8_t edgesUpTo(uint32_t secondOfWeek) const;
+    static bool parseTime(const char* text, uint16_t& minuteOfDay);
+};
+
+#endif // PUMP_SCHEDULE_H
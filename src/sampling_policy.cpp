@@ -0,0 +1,60 @@
+#include "sampling_policy.h"
+#include "config.h"
+#include "fixed_point.h"
+
+SamplingPolicy::SamplingPolicy()
+    : floorMs(SENSOR_MIN_INTERVAL), baseMs(SENSOR_READ_INTERVAL), ceilingMs(SENSOR_MAX_INTERVAL),
+      fastRate(PERCENT_TO_CENTI(SAMPLING_FAST_RATE)), flatRate(PERCENT_TO_CENTI(SAMPLING_FLAT_RATE)),
+      intervalMs(SENSOR_READ_INTERVAL), lastDecision(SAMPLING_NORMAL) {
+    resetStats();
+}
+
+void SamplingPolicy::setIntervals(uint32_t floorMs, uint32_t baseMs, uint32_t ceilingMs) {
+    // Keep floor <= base <= ceiling whatever the configuration says
+    this->floorMs = max(floorMs, (uint32_t)100);
+    this->ceilingMs = max(ceilingMs, this->floorMs);
+    this->baseMs = constrain(baseMs, this->floorMs, this->ceilingMs);
+}
+
+void SamplingPolicy::setRateThresholds(float fastRate, float flatRate) {
+    this->fastRate = percentToCenti(fabsf(fastRate));
+    this->flatRate = min(percentToCenti(fabsf(flatRate)), this->fastRate);
+}
+
+uint32_t SamplingPolicy::next(bool pumpRunning, bool readingValid, int16_t rateCentiPerMin) {
+    int16_t rate = rateCentiPerMin < 0 ? -rateCentiPerMin : rateCentiPerMin;
+    
+    if (pumpRunning || (readingValid && rate >= fastRate)) {
+        lastDecision = SAMPLING_FAST;
+        intervalMs = floorMs;
+    } else if (readingValid && rate <= flatRate) {
+        // Back off geometrically from wherever we are now
+        lastDecision = SAMPLING_BACKOFF;
+        intervalMs = min(max(intervalMs, baseMs) * 2, ceilingMs);
+    } else {
+        lastDecision = SAMPLING_NORMAL;
+        intervalMs = baseMs;
+    }
+    
+    decisionCount[lastDecision]++;
+    cycles++;
+    totalIntervalMs += intervalMs;
+    
+    return intervalMs;
+}
+
+uint32_t SamplingPolicy::getDecisionCount(uint8_t decision) const {
+    return decision < SAMPLING_DECISIONS ? decisionCount[decision] : 0;
+}
+
+uint32_t SamplingPolicy::getAverageInterval() const {
+    return cycles > 0 ? (uint32_t)(totalIntervalMs / cycles) : intervalMs;
+}
+
+void SamplingPolicy::resetStats() {
+    for (uint8_t i = 0; i < SAMPLING_DECISIONS; i++) {
+        decisionCount[i] = 0;
+    }
+    cycles = 0;
+    totalIntervalMs = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef SAMPLING_POLICY_H
+#define SAMPLING_POLICY_H
+
+#include <Arduino.h>
+
+// Why an interval was chosen
+enum SamplingDecision {
+    SAMPLING_FAST = 0,      // Pump running or level moving fast: floor interval
+    SAMPLING_NORMAL = 1,    // Level moving slowly: base interval
+    SAMPLING_BACKOFF = 2,   // Level flat: interval grows towards the ceiling
+    SAMPLING_DECISIONS = 3
+};
+
+/**
+ * Adaptive sensor sampling interval.
+ *
+ * Shortens the period to the floor while the pump runs or the estimated
+ * rate is high, and doubles it (up to the ceiling) for every cycle the
+ * level stays flat. Invalid readings fall back to the base interval so
+ * a failing sensor is retried at the normal pace.
+ */
+class SamplingPolicy {
+public:
+    SamplingPolicy();
+    
+    // Interval bounds (ms); base is the nominal interval for slow changes
+    void setIntervals(uint32_t floorMs, uint32_t baseMs, uint32_t ceilingMs);
+    
+    // Rate thresholds (%/min, absolute)
+    void setRateThresholds(float fastRate, float flatRate);
+    
+    // Choose the next sleep from the latest estimate (0.01 %/min) and pump state
+    uint32_t next(bool pumpRunning, bool readingValid, int16_t rateCentiPerMin);
+    
+    // Statistics
+    uint32_t getInterval() const { return intervalMs; }
+    uint32_t getFloor() const { return floorMs; }
+    uint8_t getLastDecision() const { return lastDecision; }
+    uint32_t getDecisionCount(uint8_t decision) const;
+    uint32_t getCycleCount() const { return cycles; }
+    uint32_t getAverageInterval() const;
+    void resetStats();
+    
+private:
+    uint32_t floorMs;
+    uint32_t baseMs;
+    uint32_t ceilingMs;
+    int16_t fastRate;   // 0.01 %/min
+    int16_t flatRate;
+    
+    uint32_t intervalMs;
+    uint8_t lastDecision;
+    
+    uint32_t decisionCount[SAMPLING_DECISIONS];
+    uint32_t cycles;
+    uint64_t totalIntervalMs;
+};
+
+#endif // SAMPLING_POLICY_H
@@ -0,0 +1,136 @@
+#include "sensor_fusion.h"
+
+SensorFusion::SensorFusion() {
+    reset();
+}
+
+void SensorFusion::reset() {
+    for (uint8_t i = 0; i < MAX_TANK_SENSORS; i++) {
+        variance[i] = FUSION_INITIAL_VAR;
+        biasQ4[i] = 0;
+        errorPermille[i] = 0;
+        lastLevel[i] = 0;
+        hasLast[i] = false;
+        weightPermille[i] = 0;
+    }
+    activeInputs = 0;
+    failovers = 0;
+}
+
+uint32_t SensorFusion::updateInput(uint8_t input, const SensorReading& reading, const LevelSensor& sensor) {
+    int32_t errorTarget = reading.isValid ? 0 : 1000;
+    errorPermille[input] += (errorTarget - errorPermille[input]) / (1 << FUSION_EWMA_SHIFT);
+    
+    if (!reading.isValid) {
+        return 0;
+    }
+    
+    // Half the mean squared step between readings: the noise variance,
+    // largely blind to a steady fill or drain
+    if (hasLast[input]) {
+        int32_t step = (int32_t)reading.levelCenti - lastLevel[input];
+        int32_t sample = step * step / 2;
+        variance[input] += (sample - (int32_t)variance[input]) / (1 << FUSION_EWMA_SHIFT);
+    }
+    lastLevel[input] = reading.levelCenti;
+    hasLast[input] = true;
+    
+    if (!sensor.isHealthy()) {
+        return 0;
+    }
+    
+    uint32_t weight = FUSION_WEIGHT_SCALE / (variance[input] + FUSION_VAR_FLOOR);
+    weight = weight * (1000 - errorPermille[input]) / 1000;
+    return max(weight, (uint32_t)1);
+}
+
+SensorReading SensorFusion::fuse(const SensorReading* readings, LevelSensor* const* sensors, uint8_t count) {
+    count = min(count, (uint8_t)MAX_TANK_SENSORS);
+    
+    uint32_t weights[MAX_TANK_SENSORS] = {0};
+    const LevelSensor* reference = nullptr;
+    uint8_t active = 0;
+    uint8_t dropped = 0;
+    
+    for (uint8_t i = 0; i < count; i++) {
+        if (!sensors[i]) {
+            continue;
+        }
+        if (!reference) {
+            reference = sensors[i];
+        }
+        
+        weights[i] = updateInput(i, readings[i], *sensors[i]);
+        if (weights[i] > 0) {
+            active++;
+        } else if (weightPermille[i] > 0) {
+            dropped++;
+        }
+    }
+    
+    SensorReading fused;
+    fused.rateCentiPerMin = 0;
+    fused.confidence = 0;
+    fused.pings = 0;
+    fused.timestamp = 0;
+    fused.errorCode = ERROR_NONE;
+    
+    for (uint8_t i = 0; i < count; i++) {
+        if (sensors[i]) {
+            fused.pings += readings[i].pings;
+            fused.timestamp = max(fused.timestamp, readings[i].timestamp);
+        }
+    }
+    
+    if (dropped > 0 && active > 0) {
+        failovers++;
+        DEBUG_PRINTF("Sensor fusion: %d input(s) dropped out, %d carrying on\n", dropped, active);
+    }
+    activeInputs = active;
+    
+    if (active == 0) {
+        for (uint8_t i = 0; i < count; i++) {
+            weightPermille[i] = 0;
+            if (sensors[i] && fused.errorCode == ERROR_NONE) {
+                fused.errorCode = readings[i].errorCode; // First fitted sensor's error
+            }
+        }
+        fused.distanceMm = 0;
+        fused.levelCenti = 0;
+        fused.volumeDl = 0;
+        fused.filteredCenti = 0;
+        fused.isValid = false;
+        return fused;
+    }
+    
+    // The uncorrected weighted mean anchors the learned offsets, so they
+    // cannot drift together; the corrected mean is what gets reported
+    int64_t sumWeight = 0, sumLevel = 0, sumCorrected = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (weights[i] > 0) {
+            sumWeight += weights[i];
+            sumLevel += (int64_t)weights[i] * readings[i].levelCenti;
+            sumCorrected += (int64_t)weights[i] * (readings[i].levelCenti * 16 - biasQ4[i]);
+        }
+    }
+    int32_t mean = (int32_t)((sumLevel + sumWeight / 2) / sumWeight);
+    int32_t level = (int32_t)((sumCorrected + sumWeight * 8) / (sumWeight * 16));
+    
+    for (uint8_t i = 0; i < count; i++) {
+        weightPermille[i] = (uint16_t)((weights[i] * 1000 + sumWeight / 2) / sumWeight);
+        
+        // Offsets can only be observed while another input is there to compare with
+        if (active >= 2 && weights[i] > 0) {
+            int32_t offsetQ4 = (readings[i].levelCenti - mean) * 16;
+            biasQ4[i] += (offsetQ4 - biasQ4[i]) / (1 << FUSION_BIAS_SHIFT);
+        }
+    }
+    
+    fused.levelCenti = constrain(level, (int32_t)0, (int32_t)CENTI_PERCENT_FULL);
+    fused.filteredCenti = fused.levelCenti; // Until an estimator refines it
+    fused.distanceMm = reference->centiToDistance(fused.levelCenti);
+    fused.volumeDl = reference->getGeometry().isBuilt()
+                         ? reference->getGeometry().distanceToDecilitres(fused.distanceMm) : 0;
+    fused.isValid = true;
+    return fused;
+}
@@ -0,0 +1,61 @@
+#ifndef SENSOR_FUSION_H
+#define SENSOR_FUSION_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "fixed_point.h"
+#include "level_sensor.h"
+
+// Bias learning is slower than the noise estimate (1/32 per reading)
+#define FUSION_BIAS_SHIFT 5
+
+// Weight numerator; inputs at the noise floor get the largest weight
+#define FUSION_WEIGHT_SCALE (1UL << 20)
+
+/**
+ * Combines the readings of several sensors on one tank into a single level.
+ *
+ * Each input is weighted by the inverse of its recent noise variance
+ * (from successive level differences, so a moving level costs little) and
+ * scaled down by its recent error rate. Sensors that are not healthy or
+ * have no valid reading this cycle are left out.
+ *
+ * Sensors mounted at different heights rarely agree exactly, so the offset
+ * of every input from the weighted mean is learned while at least two
+ * contribute. When one drops out, the others are corrected by their
+ * offsets and the fused level carries on without a step.
+ */
+class SensorFusion {
+public:
+    SensorFusion();
+    
+    void reset();
+    
+    // One reading per input (nullptr sensors are not fitted). Distance and
+    // volume of the result are expressed in the first fitted sensor's terms.
+    SensorReading fuse(const SensorReading* readings, LevelSensor* const* sensors, uint8_t count);
+    
+    // Per-input state of the last fuse()
+    bool isContributing(uint8_t input) const { return weightPermille[input] > 0; }
+    uint16_t getWeightPermille(uint8_t input) const { return weightPermille[input]; } // Share of the fused level
+    uint32_t getVariance(uint8_t input) const { return variance[input]; }             // Noise, centi-percent²
+    int16_t getBias(uint8_t input) const { return biasQ4[input] / 16; }               // Offset from the mean, centi-percent
+    uint16_t getErrorRate(uint8_t input) const { return errorPermille[input]; }       // Invalid readings, ‰
+    
+    uint8_t getActiveInputs() const { return activeInputs; }
+    uint32_t getFailoverCount() const { return failovers; }   // An input dropped out, others carried on
+
+private:
+    uint32_t variance[MAX_TANK_SENSORS];
+    int32_t biasQ4[MAX_TANK_SENSORS];       // 1/16 centi-percent, so slow learning does not stall
+    int32_t errorPermille[MAX_TANK_SENSORS];
+    CentiPercent lastLevel[MAX_TANK_SENSORS];
+    bool hasLast[MAX_TANK_SENSORS];
+    uint16_t weightPermille[MAX_TANK_SENSORS];
+    uint8_t activeInputs;
+    uint32_t failovers;
+    
+    uint32_t updateInput(uint8_t input, const SensorReading& reading, const LevelSensor& sensor);
+};
+
+#endif // SENSOR_FUSION_H
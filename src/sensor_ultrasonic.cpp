@@ -1,192 +1,170 @@
 #include "sensor_ultrasonic.h"
 #include "config.h"
+#include "speed_of_sound.h"
 
 UltrasonicSensor::UltrasonicSensor(uint8_t trigPin, uint8_t echoPin, float emptyCm, float fullCm)
-    : trigPin(trigPin), echoPin(echoPin), emptyCm(emptyCm), fullCm(fullCm),
-      sampleCount(SENSOR_SAMPLES), timeoutUs(SENSOR_TIMEOUT_US), consecutiveErrors(0) {
-    
-    lastReading.distanceCm = 0;
-    lastReading.levelPercent = 0;
-    lastReading.isValid = false;
-    lastReading.timestamp = 0;
-    lastReading.errorCode = ERROR_NONE;
+    : LevelSensor(emptyCm, fullCm), trigPin(trigPin), echoPin(echoPin),
+      timeoutUs(SENSOR_TIMEOUT_US), fixedTimeoutUs(0),
+      gpioHal(trigPin, echoPin), hal(&gpioHal),
+      temperatureSource(nullptr),
+      halfSpeedQ16(SpeedOfSound::halfSpeedQ16((int16_t)(DEFAULT_AIR_TEMPERATURE_C * 10))),
+      celsiusTenths(0), hasTemperature(false),
+      traceSink(nullptr), pingStartMs(0),
+      releasePending(false), releaseStartCycles(0), echoHoldCount(0) {
+    
+    updateTimeout();
 }
 
 bool UltrasonicSensor::begin() {
-    pinMode(trigPin, OUTPUT);
-    pinMode(echoPin, INPUT);
+    if (!hal->begin(&capture)) {
+        DEBUG_PRINTF("Ultrasonic sensor capture init failed (Echo: %d)\n", echoPin);
+        return false;
+    }
     
-    digitalWrite(trigPin, LOW);
     delay(50); // Let sensor stabilize
     
     DEBUG_PRINTF("Ultrasonic sensor initialized (Trig: %d, Echo: %d)\n", trigPin, echoPin);
     return true;
 }
 
-SensorReading UltrasonicSensor::readDistance() {
-    float samples[sampleCount];
-    uint8_t validSamples = 0;
-    
-    // Take multiple samples
-    for (uint8_t i = 0; i < sampleCount; i++) {
-        float distance = measureSingleDistance();
-        
-        if (distance > 0 && validateDistance(distance)) {
-            samples[validSamples++] = distance;
+void UltrasonicSensor::onBurstStart() {
+    // Probe is read once per burst; keep the previous value if it fails
+    int16_t tenths;
+    if (temperatureSource && temperatureSource->readTemperature(tenths)) {
+        celsiusTenths = tenths;
+        hasTemperature = true;
+        uint16_t halfSpeed = SpeedOfSound::halfSpeedQ16(celsiusTenths);
+        if (halfSpeed != halfSpeedQ16) {
+            halfSpeedQ16 = halfSpeed;
+            updateTimeout(); // Window is a distance, so it follows the speed of sound
         }
-        
-        delay(10); // Small delay between samples
-    }
-    
-    SensorReading reading;
-    reading.timestamp = millis();
-    
-    if (validSamples >= 3) { // Need at least 3 valid samples
-        // Calculate median
-        reading.distanceCm = calculateMedian(samples, validSamples);
-        reading.levelPercent = distanceToPercent(reading.distanceCm);
-        reading.isValid = true;
-        reading.errorCode = ERROR_NONE;
-        
-        consecutiveErrors = 0;
-        lastReading = reading;
-        
-        #if DEBUG_SENSOR
-        DEBUG_PRINTF("Sensor reading: %.2f cm (%.1f%%) [%d samples]\n", 
-                     reading.distanceCm, reading.levelPercent, validSamples);
-        #endif
-    } else {
-        // Not enough valid samples
-        reading.distanceCm = 0;
-        reading.levelPercent = 0;
-        reading.isValid = false;
-        reading.errorCode = validSamples == 0 ? ERROR_TIMEOUT : ERROR_OUT_OF_RANGE;
-        
-        consecutiveErrors++;
-        
-        #if DEBUG_SENSOR
-        DEBUG_PRINTF("Sensor error: %d (valid samples: %d)\n", reading.errorCode, validSamples);
-        #endif
     }
-    
-    return reading;
 }
 
-float UltrasonicSensor::measureSingleDistance() {
-    // Send 10μs pulse
-    digitalWrite(trigPin, LOW);
-    delayMicroseconds(2);
-    digitalWrite(trigPin, HIGH);
-    delayMicroseconds(10);
-    digitalWrite(trigPin, LOW);
-    
-    // Measure echo pulse width
-    unsigned long duration = pulseIn(echoPin, HIGH, timeoutUs);
-    
-    if (duration == 0) {
-        return -1; // Timeout
+void UltrasonicSensor::startPing() {
+    // A window shorter than the module's own timeout ends while the module
+    // still holds the echo pin, and it ignores triggers until it lets go;
+    // firing now would read that as a sensor that never answered
+    if (hal->echoLevel()) {
+        releasePending = true;
+        releaseStartCycles = hal->cycleCount();
+        echoHoldCount++;
+        return;
     }
     
-    // Calculate distance: duration / 2 (round trip) * speed of sound
-    float distance = (duration / 2.0) * SPEED_OF_SOUND;
-    
-    return distance;
+    firePing();
 }
 
-float UltrasonicSensor::calculateMedian(float* samples, uint8_t count) {
-    if (count == 0) return 0;
+void UltrasonicSensor::firePing() {
+    uint32_t cyclesPerUs = hal->cyclesPerUs();
     
-    // Create a copy to sort
-    float sorted[count];
-    for (uint8_t i = 0; i < count; i++) {
-        sorted[i] = samples[i];
+    // Arm before triggering so the rising edge cannot be missed
+    capture.arm(hal->cycleCount(), timeoutUs * cyclesPerUs);
+    pingStartMs = millis();
+    hal->trigger();
+}
+
+bool UltrasonicSensor::pollPing() {
+    uint32_t duration;
+    uint8_t status;
+    if (!pollEcho(duration, status)) {
+        return false;
     }
     
-    sortArray(sorted, count);
-    
-    // Return median
-    if (count % 2 == 0) {
-        return (sorted[count/2 - 1] + sorted[count/2]) / 2.0;
+    if (status == ECHO_WINDOW_EXPIRED) {
+        recordPing(PING_NO_ECHO);
+    } else if (status != ECHO_OK) {
+        recordPing(PING_NO_RESPONSE);
     } else {
-        return sorted[count/2];
+        recordPing(PING_ECHO, echoToDistance(duration));
     }
+    return true;
 }
 
-void UltrasonicSensor::sortArray(float* arr, uint8_t count) {
-    // Simple bubble sort (fine for small arrays)
-    for (uint8_t i = 0; i < count - 1; i++) {
-        for (uint8_t j = 0; j < count - i - 1; j++) {
-            if (arr[j] > arr[j + 1]) {
-                float temp = arr[j];
-                arr[j] = arr[j + 1];
-                arr[j + 1] = temp;
-            }
+bool UltrasonicSensor::pollEcho(uint32_t& durationUs, uint8_t& status) {
+    if (releasePending) {
+        // Trigger once the echo pin drops; a pin still HIGH past the module
+        // timeout is stuck, and that ping then reports it
+        uint32_t heldUs = (hal->cycleCount() - releaseStartCycles) / hal->cyclesPerUs();
+        if (hal->echoLevel() && heldUs < SENSOR_MODULE_TIMEOUT_US) {
+            return false;
         }
-    }
-}
-
-bool UltrasonicSensor::validateDistance(float distance) const {
-    // Check if distance is within reasonable sensor range (JSN-SR04T: 25-450cm typical)
-    if (distance < 5 || distance > 500) {
+        releasePending = false;
+        firePing();
         return false;
     }
     
-    // Check if distance is within calibrated range (with some tolerance)
-    float tolerance = 10.0; // 10cm tolerance
-    if (distance < (fullCm - tolerance) || distance > (emptyCm + tolerance)) {
-        #if DEBUG_SENSOR
-        DEBUG_PRINTF("Distance %.2f cm out of calibrated range (%.2f - %.2f cm)\n", 
-                     distance, fullCm, emptyCm);
-        #endif
-        // Still return true, just log the warning
+    // Both edges are timestamped in the ISR; nothing to do until they land
+    EchoPulse pulse;
+    if (!capture.pop(pulse)) {
+        capture.expire(hal->cycleCount());
+        return false;
     }
     
-    return true;
-}
-
-float UltrasonicSensor::distanceToPercent(float distanceCm) const {
-    // When distance is small = tank is full (high percentage)
-    // When distance is large = tank is empty (low percentage)
+    durationUs = pulse.status == ECHO_OK ? pulse.widthCycles / hal->cyclesPerUs() : 0;
+    status = pulse.status;
     
-    if (distanceCm <= fullCm) {
-        return 100.0;
-    } else if (distanceCm >= emptyCm) {
-        return 0.0;
+    if (traceSink) {
+        EchoTraceRecord record;
+        record.timeMs = pingStartMs;
+        record.durationUs = durationUs;
+        record.status = status;
+        record.truthMm = 0;
+        traceSink->record(record);
     }
     
-    float range = emptyCm - fullCm;
-    float percent = 100.0 - ((distanceCm - fullCm) / range * 100.0);
-    
-    return constrain(percent, 0.0, 100.0);
-}
-
-float UltrasonicSensor::percentToDistance(float percent) const {
-    percent = constrain(percent, 0.0, 100.0);
-    
-    float range = emptyCm - fullCm;
-    float distance = emptyCm - (percent / 100.0 * range);
-    
-    return distance;
+    return true;
 }
 
-void UltrasonicSensor::setCalibration(float emptyCm, float fullCm) {
-    if (emptyCm > fullCm && emptyCm > 0 && fullCm > 0) {
-        this->emptyCm = emptyCm;
-        this->fullCm = fullCm;
-        DEBUG_PRINTF("Calibration updated: Empty=%.1f cm, Full=%.1f cm\n", emptyCm, fullCm);
+void UltrasonicSensor::setTraceSink(EchoTraceSink* sink, uint8_t tank) {
+    if (sink) {
+        EchoTraceHeader header;
+        header.tank = tank;
+        header.emptyMm = emptyMm;
+        header.fullMm = fullMm;
+        header.timeoutUs = timeoutUs;
+        header.celsiusTenths = celsiusTenths;
+        header.hasTemperature = hasTemperature;
+        sink->begin(header);
     }
+    traceSink = sink;
 }
 
-void UltrasonicSensor::getCalibration(float& emptyCm, float& fullCm) const {
-    emptyCm = this->emptyCm;
-    fullCm = this->fullCm;
+DistanceMm UltrasonicSensor::echoToDistance(uint32_t durationUs) const {
+    // Round trip at the compensated speed of sound, rounded to whole mm
+    uint32_t mmQ16 = SpeedOfSound::echoToMmQ16(durationUs, halfSpeedQ16);
+    return (DistanceMm)((mmQ16 + 0x8000) >> 16);
 }
 
-void UltrasonicSensor::setSampleCount(uint8_t count) {
-    sampleCount = constrain(count, 3, 10);
+void UltrasonicSensor::setTimeout(uint32_t timeoutUs) {
+    fixedTimeoutUs = timeoutUs;
+    updateTimeout();
 }
 
-void UltrasonicSensor::setTimeout(uint32_t timeoutUs) {
-    this->timeoutUs = timeoutUs;
+void UltrasonicSensor::updateTimeout() {
+    if (fixedTimeoutUs > 0) {
+        timeoutUs = fixedTimeoutUs;
+        return;
+    }
+    
+    // Round trip to just past the tank bottom; an echo later than that
+    // cannot be the water surface, so there is no point listening for it
+    uint32_t rangeMm = min((uint32_t)emptyMm + SENSOR_RANGE_MARGIN_MM, (uint32_t)10000);
+    uint32_t roundTripUs = (rangeMm << 16) / halfSpeedQ16;
+    
+    timeoutUs = min(roundTripUs + SENSOR_ECHO_LATENCY_US, (uint32_t)SENSOR_TIMEOUT_US);
+    
+    #if DEBUG_SENSOR
+    DEBUG_PRINTF("Echo window: %lu us (empty %u mm)\n", (unsigned long)timeoutUs, emptyMm);
+    #endif
 }
 
+void UltrasonicSensor::setCaptureHal(EchoCaptureHal* hal) {
+    this->hal->end();
+    this->hal = hal ? hal : &gpioHal;
+    
+    // The new backend delivers edges from now on
+    if (!this->hal->begin(&capture)) {
+        DEBUG_PRINTF("Ultrasonic sensor capture init failed (Echo: %d)\n", echoPin);
+    }
+}
@@ -2,77 +2,84 @@
 #define SENSOR_ULTRASONIC_H
 
 #include <Arduino.h>
+#include "config.h"
+#include "level_sensor.h"
+#include "echo_capture.h"
+#include "echo_trace.h"
+#include "temperature_source.h"
 
-// Sensor reading structure
-struct SensorReading {
-    float distanceCm;
-    float levelPercent;
-    bool isValid;
-    uint32_t timestamp;
-    uint8_t errorCode;
-};
-
-// Error codes
-enum SensorError {
-    ERROR_NONE = 0,
-    ERROR_TIMEOUT = 1,
-    ERROR_OUT_OF_RANGE = 2,
-    ERROR_HARDWARE = 3
-};
-
-class UltrasonicSensor {
+// Trigger/echo pulse timing driver (JSN-SR04T mode 1, HC-SR04)
+class UltrasonicSensor : public LevelSensor {
 public:
     UltrasonicSensor(uint8_t trigPin, uint8_t echoPin, float emptyCm, float fullCm);
     
     // Initialize sensor
-    bool begin();
+    bool begin() override;
     
-    // Read distance with median filtering
-    SensorReading readDistance();
+    // One trigger/echo cycle
+    void startPing() override;                  // Arm capture and fire trigger
+    bool pollPing() override;                   // True once the ping has finished
     
-    // Update calibration values
-    void setCalibration(float emptyCm, float fullCm);
-    void getCalibration(float& emptyCm, float& fullCm) const;
+    // Raw result of the current ping (pulse width, EchoStatus) without feeding
+    // the burst; used by the diagnostic stream
+    bool pollEcho(uint32_t& durationUs, uint8_t& status);
     
-    // Convert distance to percentage
-    float distanceToPercent(float distanceCm) const;
-    float percentToDistance(float percent) const;
+    uint32_t getTimeout() const override { return timeoutUs; }
+    uint32_t getEchoHoldCount() const { return echoHoldCount; }    // Pings delayed by a held echo pin
+    uint8_t getDriver() const override { return DRIVER_PULSE; }
     
-    // Get last valid reading
-    const SensorReading& getLastReading() const { return lastReading; }
+    // Configuration
+    void setTimeout(uint32_t timeoutUs);        // Fixed window; 0 = derive from calibration
     
-    // Sensor status
-    bool isHealthy() const { return consecutiveErrors < 5; }
-    uint8_t getErrorCount() const { return consecutiveErrors; }
-    void resetErrorCount() { consecutiveErrors = 0; }
+    // Replace the GPIO capture backend (e.g. with a simulated edge source);
+    // the old one is released and the new one attached straight away
+    void setCaptureHal(EchoCaptureHal* hal);
     
-    // Configuration
-    void setSampleCount(uint8_t count);
-    void setTimeout(uint32_t timeoutUs);
+    // Air temperature for speed-of-sound compensation (nullptr = 20 °C)
+    void setTemperatureSource(TemperatureSource* source) { temperatureSource = source; }
     
+    // Record every ping for later replay (nullptr = off); header records the setup.
+    // Call from the task that runs the bursts, between bursts
+    void setTraceSink(EchoTraceSink* sink, uint8_t tank);
+
+protected:
+    void onBurstStart() override;
+    void onCalibrationChanged() override { updateTimeout(); }
+    void waitMs(uint32_t ms) override { hal->waitMs(ms); }
+
 private:
     // Pin configuration
     uint8_t trigPin;
     uint8_t echoPin;
     
-    // Calibration
-    float emptyCm;  // Distance when tank is empty (sensor to bottom)
-    float fullCm;   // Distance when tank is full (sensor to water surface)
-    
     // Sensor parameters
-    uint8_t sampleCount;
     uint32_t timeoutUs;
+    uint32_t fixedTimeoutUs;    // 0 = adaptive
+    
+    // Echo capture (interrupt driven, replaces pulseIn)
+    GpioEchoCaptureHal gpioHal;
+    EchoCaptureHal* hal;
+    EchoCapture capture;
     
-    // State tracking
-    SensorReading lastReading;
-    uint8_t consecutiveErrors;
+    // Speed of sound for the current burst (Q16 mm/µs, one way)
+    TemperatureSource* temperatureSource;
+    uint16_t halfSpeedQ16;
+    int16_t celsiusTenths;      // Last probe value (for trace headers)
+    bool hasTemperature;
+    
+    // Ping recording
+    EchoTraceSink* traceSink;
+    uint32_t pingStartMs;
+    
+    // Trigger deferred until the module releases the echo pin
+    bool releasePending;
+    uint32_t releaseStartCycles;
+    uint32_t echoHoldCount;
     
     // Internal methods
-    float measureSingleDistance();
-    float calculateMedian(float* samples, uint8_t count);
-    void sortArray(float* arr, uint8_t count);
-    bool validateDistance(float distance) const;
+    void firePing();
+    DistanceMm echoToDistance(uint32_t durationUs) const;
+    void updateTimeout();
 };
 
 #endif // SENSOR_ULTRASONIC_H
-
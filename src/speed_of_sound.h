@@ -0,0 +1,69 @@
+#ifndef SPEED_OF_SOUND_H
+#define SPEED_OF_SOUND_H
+
+#include <stdint.h>
+
+// Table range, 1 °C per entry
+#define SOS_TABLE_MIN_C         -40
+#define SOS_TABLE_MAX_C         85
+#define SOS_TABLE_SIZE          (SOS_TABLE_MAX_C - SOS_TABLE_MIN_C + 1)
+
+// ============================================================================
+// COMPILE-TIME TABLE GENERATION (C++11 constexpr)
+// ============================================================================
+
+// Square root by Newton iterations (argument is always close to 1)
+constexpr double sosSqrt(double x, double guess = 1.0, int steps = 6) {
+    return steps == 0 ? guess : sosSqrt(x, 0.5 * (guess + x / guess), steps - 1);
+}
+
+// Half the speed of sound in mm/µs as unsigned Q16 for a whole degree:
+// c(T) = 331.3 m/s * sqrt(1 + T / 273.15)
+constexpr uint16_t sosHalfSpeedQ16(int celsius) {
+    return (uint16_t)(331.3 * sosSqrt(1.0 + celsius / 273.15) / 2000.0 * 65536.0 + 0.5);
+}
+
+template<uint8_t... Is> struct SosIndices {};
+template<uint8_t N, uint8_t... Is> struct SosMakeIndices : SosMakeIndices<N - 1, N - 1, Is...> {};
+template<uint8_t... Is> struct SosMakeIndices<0, Is...> { typedef SosIndices<Is...> type; };
+
+template<typename> struct SosTable;
+template<uint8_t... Is> struct SosTable<SosIndices<Is...> > {
+    static constexpr uint16_t values[sizeof...(Is)] = { sosHalfSpeedQ16(SOS_TABLE_MIN_C + Is)... };
+};
+template<uint8_t... Is>
+constexpr uint16_t SosTable<SosIndices<Is...> >::values[sizeof...(Is)];
+
+/**
+ * Temperature-compensated speed of sound lookup.
+ *
+ * Entries hold half the speed of sound (one-way distance per µs of round
+ * trip) as Q16 mm/µs, so converting an echo is one integer multiply:
+ *   mm(Q16) = echoUs * halfSpeedQ16
+ * No floating point or sqrt runs at run time.
+ */
+class SpeedOfSound {
+public:
+    // Interpolated lookup, temperature in 0.1 °C (clamped to table range)
+    static uint16_t halfSpeedQ16(int16_t celsiusTenths) {
+        int32_t offset = (int32_t)celsiusTenths - SOS_TABLE_MIN_C * 10;
+        if (offset <= 0) return Table::values[0];
+        if (offset >= (SOS_TABLE_SIZE - 1) * 10) return Table::values[SOS_TABLE_SIZE - 1];
+        
+        uint8_t index = offset / 10;
+        uint8_t frac = offset % 10;
+        uint16_t lo = Table::values[index];
+        uint16_t hi = Table::values[index + 1];
+        return lo + ((hi - lo) * frac + 5) / 10;
+    }
+    
+    // One-way distance for a round-trip echo time, in mm as Q16
+    static uint32_t echoToMmQ16(uint32_t echoUs, uint16_t halfSpeed) {
+        return echoUs * halfSpeed;
+    }
+    
+private:
+    typedef SosTable<SosMakeIndices<SOS_TABLE_SIZE>::type> Table;
+};
+
+#endif // SPEED_OF_SOUND_H
@@ -0,0 +1,134 @@
+#include "tank_geometry.h"
+#include "config.h"
+
+TankGeometry::TankGeometry()
+    : emptyMm(0), fullMm(0), capacityDl(0), built(false) {
+}
+
+bool TankGeometry::build(const TankGeometryConfig& config, float emptyCm, float fullCm) {
+    built = false;
+    
+    emptyMm = cmToMm(emptyCm);
+    fullMm = cmToMm(fullCm);
+    
+    if (emptyMm <= fullMm) {
+        return false;
+    }
+    
+    // Trigonometry is fine here: it runs once per configuration change
+    float maxHeight = (emptyMm - fullMm) / 10.0f;
+    float fullVolume = volumeAtHeight(config, maxHeight);
+    
+    // Without dimensions the shape is unknown; fall back to a linear table
+    bool linear = fullVolume <= 0;
+    
+    uint16_t previous = 0;
+    for (uint8_t i = 0; i < GEOMETRY_TABLE_POINTS; i++) {
+        float height = maxHeight * i / (GEOMETRY_TABLE_POINTS - 1);
+        float f = linear ? (float)i / (GEOMETRY_TABLE_POINTS - 1)
+                         : volumeAtHeight(config, height) / fullVolume;
+        
+        uint16_t value = (uint16_t)constrain(lroundf(f * 65535.0f), 0L, 65535L);
+        
+        // Guard against rounding making the table non-monotonic
+        fraction[i] = max(value, previous);
+        previous = fraction[i];
+    }
+    fraction[GEOMETRY_TABLE_POINTS - 1] = 65535;
+    
+    capacityDl = linear ? 0 : (uint32_t)(fullVolume / 100.0f + 0.5f); // cm³ -> dL
+    built = true;
+    
+    DEBUG_PRINTF("Geometry: shape %d, %u mm usable, %lu dL\n", 
+                 config.shape, emptyMm - fullMm, (unsigned long)capacityDl);
+    return true;
+}
+
+float TankGeometry::volumeAtHeight(const TankGeometryConfig& config, float h) const {
+    float d = config.diameterCm;
+    float r = d / 2.0f;
+    
+    if (d <= 0 || h <= 0) {
+        return 0;
+    }
+    
+    switch (config.shape) {
+        case SHAPE_HORIZONTAL_CYLINDER: {
+            if (config.lengthCm <= 0) return 0;
+            h = min(h, d);
+            // Circular segment area times length
+            float area = r * r * acosf((r - h) / r) - (r - h) * sqrtf(2.0f * r * h - h * h);
+            return area * config.lengthCm;
+        }
+        
+        case SHAPE_SPHERE:
+            h = min(h, d);
+            return PI * h * h * (3.0f * r - h) / 3.0f;
+        
+        case SHAPE_CONE_BOTTOM: {
+            float hc = config.coneHeightCm;
+            if (hc <= 0) {
+                return PI * r * r * h;
+            }
+            if (h <= hc) {
+                float rh = r * h / hc;
+                return PI * rh * rh * h / 3.0f;
+            }
+            return PI * r * r * hc / 3.0f + PI * r * r * (h - hc);
+        }
+        
+        case SHAPE_VERTICAL:
+        default:
+            if (config.lengthCm > 0) {
+                return d * config.lengthCm * h; // Rectangular box
+            }
+            return PI * r * r * h;
+    }
+}
+
+uint32_t TankGeometry::fractionAtDistance(DistanceMm distance) const {
+    if (distance >= emptyMm) return 0;
+    if (distance <= fullMm) return 65536;
+    
+    uint32_t span = emptyMm - fullMm;
+    uint32_t height = emptyMm - distance;
+    
+    // Evenly spaced heights: index directly, interpolate in Q8 between points
+    uint32_t posQ8 = (height * (GEOMETRY_TABLE_POINTS - 1) << 8) / span;
+    uint8_t i = posQ8 >> 8;
+    uint32_t t = posQ8 & 0xFF;
+    uint32_t f = fraction[i] + (((fraction[i + 1] - fraction[i]) * t) >> 8);
+    
+    // Rescale 0..65535 to 0..65536 so full is exactly 1.0 in Q16
+    return f + (f >> 15);
+}
+
+CentiPercent TankGeometry::distanceToCenti(DistanceMm distance) const {
+    return (CentiPercent)((fractionAtDistance(distance) * CENTI_PERCENT_FULL + 32768) >> 16);
+}
+
+uint32_t TankGeometry::distanceToDecilitres(DistanceMm distance) const {
+    return (uint32_t)(((uint64_t)capacityDl * fractionAtDistance(distance) + 32768) >> 16);
+}
+
+DistanceMm TankGeometry::centiToDistance(CentiPercent level) const {
+    uint32_t span = emptyMm - fullMm;
+    int32_t clamped = constrain((int32_t)level, (int32_t)0, (int32_t)CENTI_PERCENT_FULL);
+    uint16_t target = (uint16_t)((clamped * 65535 + CENTI_PERCENT_FULL / 2) / CENTI_PERCENT_FULL);
+    
+    // Binary search for the first table point at or above the target
+    uint8_t lo = 0, hi = GEOMETRY_TABLE_POINTS - 1;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        if (fraction[mid] < target) lo = mid + 1;
+        else hi = mid;
+    }
+    
+    uint32_t posQ8 = (uint32_t)lo << 8;
+    if (lo > 0 && fraction[lo] > fraction[lo - 1]) {
+        posQ8 = ((uint32_t)(lo - 1) << 8) + 
+                ((uint32_t)(target - fraction[lo - 1]) << 8) / (fraction[lo] - fraction[lo - 1]);
+    }
+    
+    return emptyMm - (DistanceMm)((posQ8 * span / (GEOMETRY_TABLE_POINTS - 1) + 128) >> 8);
+}
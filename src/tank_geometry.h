@@ -0,0 +1,63 @@
+#ifndef TANK_GEOMETRY_H
+#define TANK_GEOMETRY_H
+
+#include <Arduino.h>
+#include "fixed_point.h"
+
+// Number of points in the height -> volume table
+#define GEOMETRY_TABLE_POINTS 33
+
+// Tank shapes
+enum TankShape {
+    SHAPE_VERTICAL = 0,             // Prismatic: vertical cylinder or rectangular box
+    SHAPE_HORIZONTAL_CYLINDER = 1,
+    SHAPE_CONE_BOTTOM = 2,          // Vertical cylinder on a conical bottom (silo)
+    SHAPE_SPHERE = 3
+};
+
+// Per-tank geometry configuration (stored in SystemConfig)
+struct TankGeometryConfig {
+    uint8_t shape;          // TankShape
+    float diameterCm;       // Cylinder/sphere diameter, or box width (0 = unknown, no litres)
+    float lengthCm;         // Horizontal cylinder length, or box depth (0 = round vertical tank)
+    float coneHeightCm;     // Height of the conical bottom section
+};
+
+/**
+ * Distance to volume conversion for non-prismatic tanks.
+ *
+ * The fill curve is evaluated once (with trigonometry) into a compact
+ * monotonic table of volume fractions at evenly spaced water heights.
+ * Per reading, the forward conversion is a table index plus linear
+ * interpolation in integer math; the inverse is a binary search over
+ * the table.
+ */
+class TankGeometry {
+public:
+    TankGeometry();
+    
+    // Build the table for a tank with the given calibration
+    bool build(const TankGeometryConfig& config, float emptyCm, float fullCm);
+    bool isBuilt() const { return built; }
+    
+    // Conversions (distance is sensor to water surface)
+    CentiPercent distanceToCenti(DistanceMm distance) const;
+    uint32_t distanceToDecilitres(DistanceMm distance) const;
+    DistanceMm centiToDistance(CentiPercent level) const;
+    
+    // Volume at the full mark (0 if dimensions are unknown)
+    uint32_t getCapacityDecilitres() const { return capacityDl; }
+    float getCapacityLiters() const { return capacityDl / 10.0f; }
+    
+private:
+    uint16_t fraction[GEOMETRY_TABLE_POINTS];  // Volume fraction, 0..65535
+    DistanceMm emptyMm;
+    DistanceMm fullMm;
+    uint32_t capacityDl;
+    bool built;
+    
+    float volumeAtHeight(const TankGeometryConfig& config, float heightCm) const;
+    uint32_t fractionAtDistance(DistanceMm distance) const;
+};
+
+#endif // TANK_GEOMETRY_H
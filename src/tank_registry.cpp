@@ -0,0 +1,374 @@
+#include "tank_registry.h"
+#include "sensor_ultrasonic.h"
+#include "jsn_uart_sensor.h"
+#include "pressure_sensor.h"
+
+TankRegistry::TankRegistry(ConfigManager& configManager)
+    : configManager(configManager), tankCount(0), nextUart(JSN_UART_FIRST), requests(0), traceRequests(0) {
+    for (uint8_t i = 0; i < MAX_TANKS; i++) {
+        traceSinks[i].store(nullptr, std::memory_order_relaxed);
+        tanks[i].index = i;
+        tanks[i].config = nullptr;
+        tanks[i].sensor = nullptr;
+        tanks[i].sensorCount = 0;
+        for (uint8_t s = 0; s < MAX_TANK_SENSORS; s++) {
+            tanks[i].sensors[s] = nullptr;
+            tanks[i].inputs[s].isValid = false;
+        }
+        tanks[i].reading.isValid = false;
+        tanks[i].inflow = false;
+        tanks[i].inflowSeenMs = 0;
+        tanks[i].filterProfile = FILTER_PROFILE_REST;
+    }
+}
+
+uint8_t TankRegistry::begin(AcquisitionScheduler& acquisition, TemperatureSource* temperature) {
+    const SystemConfig& config = configManager.getConfig();
+    
+    tankCount = constrain(config.tankCount, 1, MAX_TANKS);
+    acquisition.clear();
+    nextUart = JSN_UART_FIRST;
+    
+    uint8_t fittedTanks = 0;
+    for (uint8_t i = 0; i < tankCount; i++) {
+        TankDescriptor& tank = tanks[i];
+        tank.config = &config.tanks[i];
+        tank.sensor = nullptr;
+        tank.sensorCount = 0;
+        
+        for (uint8_t s = 0; s < MAX_TANK_SENSORS; s++) {
+            LevelSensor* sensor = createSensor(i, s, temperature);
+            tank.sensors[s] = sensor;
+            if (!sensor) {
+                continue;
+            }
+            
+            sensor->setGeometry(tank.config->geometry);
+            sensor->getClutterMap().load(clutterStorage(i, s));
+            sensor->setConsensus(config.sensorConsensusK, config.sensorConsensusTolMm,
+                                 config.sensorConsensusMaxPings);
+            acquisition.addSensor(sensor, i);
+            
+            if (!tank.sensor) {
+                tank.sensor = sensor;
+            }
+            tank.sensorCount++;
+        }
+        
+        if (tank.sensorCount == 0) {
+            DEBUG_PRINTF("Tank %d: no sensor pins configured\n", i + 1);
+            continue;
+        }
+        if (tank.sensorCount > 1) {
+            DEBUG_PRINTF("Tank %d: fusing %d sensors\n", i + 1, tank.sensorCount);
+        }
+        tank.fusion.reset();
+        tank.changes.reset();
+        tank.filterProfile = FILTER_PROFILE_REST;
+        fittedTanks++;
+    }
+    
+    DEBUG_PRINTF("Tank registry: %d of %d tanks have a sensor (max %d)\n",
+                 fittedTanks, tankCount, MAX_TANKS);
+    return fittedTanks;
+}
+
+LevelSensor* TankRegistry::createSensor(uint8_t index, uint8_t slot, TemperatureSource* temperature) {
+    const TankConfig& tank = configManager.getConfig().tanks[index];
+    
+    // Slot 0 is the tank's own sensor, later slots are redundant sensors
+    uint8_t driver = tank.driver;
+    uint8_t trigPin = tank.trigPin;
+    uint8_t echoPin = tank.echoPin;
+    uint8_t pressurePin = tank.pressurePin;
+    float emptyCm = tank.emptyCm;
+    float fullCm = tank.fullCm;
+    if (slot > 0) {
+        const TankSensorConfig& redundant = tank.redundant[slot - 1];
+        if (redundant.driver == DRIVER_NONE) {
+            return nullptr;
+        }
+        driver = redundant.driver;
+        trigPin = redundant.trigPin;
+        echoPin = redundant.echoPin;
+        pressurePin = redundant.pressurePin;
+        emptyCm = redundant.emptyCm;
+        fullCm = redundant.fullCm;
+    }
+    
+    LevelSensor* sensor = nullptr;
+    if (driver == DRIVER_UART_AUTO || driver == DRIVER_UART_CONTROLLED) {
+        // Same wiring as pulse mode: module RX on the trigger pin, TX on the echo pin
+        sensor = new JsnUartSensor(nextUart, echoPin, trigPin,
+                                   driver == DRIVER_UART_CONTROLLED, emptyCm, fullCm);
+    } else if (driver == DRIVER_PRESSURE && pressurePin != 255) {
+        sensor = new PressureSensor(pressurePin, tank.pressure, emptyCm, fullCm);
+    }
+    
+    if (sensor) {
+        if (sensor->begin()) {
+            if (driver == DRIVER_UART_AUTO || driver == DRIVER_UART_CONTROLLED) {
+                nextUart++;
+            }
+            return sensor;
+        }
+        
+        DEBUG_PRINTF("Tank %d sensor %d: driver %d unavailable, falling back to pulse timing\n",
+                     index + 1, slot + 1, driver);
+        delete sensor;
+    }
+    
+    if (trigPin == 255 || echoPin == 255) {
+        return nullptr;
+    }
+    
+    UltrasonicSensor* pulseSensor = new UltrasonicSensor(trigPin, echoPin, emptyCm, fullCm);
+    pulseSensor->setTemperatureSource(temperature);
+    pulseSensor->begin();
+    return pulseSensor;
+}
+
+uint8_t* TankRegistry::clutterStorage(uint8_t index, uint8_t slot) {
+    TankConfig& tank = configManager.getConfigRef().tanks[index];
+    return slot == 0 ? tank.clutter : tank.redundant[slot - 1].clutter;
+}
+
+bool TankRegistry::update(const SensorReading* readings) {
+    const SystemConfig& config = configManager.getConfig();
+    bool changed = false;
+    
+    // The scheduler only holds fitted sensors, in tank then slot order
+    uint8_t next = 0;
+    for (uint8_t i = 0; i < tankCount; i++) {
+        TankDescriptor& tank = tanks[i];
+        if (tank.sensorCount == 0) {
+            continue;
+        }
+        
+        for (uint8_t s = 0; s < MAX_TANK_SENSORS; s++) {
+            if (tank.sensors[s]) {
+                tank.inputs[s] = readings[next++];
+                persistClutter(tank, s);
+            }
+        }
+        
+        if (tank.sensorCount > 1) {
+            tank.reading = tank.fusion.fuse(tank.inputs, tank.sensors, MAX_TANK_SENSORS);
+        } else {
+            for (uint8_t s = 0; s < MAX_TANK_SENSORS; s++) {
+                if (tank.sensors[s]) {
+                    tank.reading = tank.inputs[s];
+                }
+            }
+        }
+        
+        tank.estimator.setNoise(config.kalmanProcessNoise, config.kalmanMeasurementNoise);
+        tank.estimator.update(tank.reading);
+        if (tank.changes.update(i, tank.reading)) {
+            changed = true;
+        }
+        
+        if (!tank.reading.isValid) {
+            DEBUG_PRINTF("WARNING: Tank %d sensor reading invalid\n", i + 1);
+        }
+        
+        if (config.autoCalMode != AUTOCAL_OFF && tank.sensors[0]) {
+            updateAutoCalibration(tank);
+        }
+        
+        selectFilterProfile(tank, millis());
+    }
+    
+    return changed;
+}
+
+void TankRegistry::setInflow(uint8_t index, bool inflow) {
+    if (index >= tankCount) {
+        return;
+    }
+    
+    // Applied at once so the first splashing pings already meet the stronger filter
+    TankDescriptor& tank = tanks[index];
+    tank.inflow = inflow;
+    selectFilterProfile(tank, millis());
+}
+
+void TankRegistry::selectFilterProfile(TankDescriptor& tank, uint32_t now) {
+    bool rising = tank.reading.isValid && tank.reading.rateCentiPerMin >= FILL_DETECT_RATE;
+    if (tank.inflow || rising) {
+        tank.inflowSeenMs = now;
+    }
+    
+    bool filling = tank.inflow || rising ||
+                   (tank.filterProfile == FILTER_PROFILE_FILLING && now - tank.inflowSeenMs < FILL_PROFILE_HOLD_MS);
+    uint8_t profile = filling ? FILTER_PROFILE_FILLING : FILTER_PROFILE_REST;
+    if (profile == tank.filterProfile) {
+        return;
+    }
+    
+    tank.filterProfile = profile;
+    for (uint8_t s = 0; s < MAX_TANK_SENSORS; s++) {
+        if (tank.sensors[s]) {
+            tank.sensors[s]->setFilterProfile(profile);
+        }
+    }
+}
+
+void TankRegistry::persistClutter(TankDescriptor& tank, uint8_t slot) {
+    // Newly learned bins are stored next to the calibration
+    ClutterMap& clutter = tank.sensors[slot]->getClutterMap();
+    if (!clutter.isDirty()) {
+        return;
+    }
+    
+    clutter.save(clutterStorage(tank.index, slot));
+    clutter.clearDirty();
+    configManager.requestSave();
+}
+
+void TankRegistry::updateAutoCalibration(TankDescriptor& tank) {
+    const SystemConfig& config = configManager.getConfig();
+    
+    // Learns the tank's own (primary) sensor from its raw readings
+    LevelSensor* primary = tank.sensors[0];
+    tank.autoCal.observe(tank.inputs[0]);
+    
+    float emptyCm, fullCm;
+    primary->getCalibration(emptyCm, fullCm);
+    if (!tank.autoCal.propose(cmToMm(emptyCm), cmToMm(fullCm)) || config.autoCalMode != AUTOCAL_APPLY) {
+        return;
+    }
+    
+    // Only move bounds that are confidently wrong
+    const CalibrationProposal& proposal = tank.autoCal.getProposal();
+    if (proposal.emptyConfidence >= AUTOCAL_APPLY_CONFIDENCE) {
+        emptyCm = mmToCm(proposal.emptyMm);
+    }
+    if (proposal.fullConfidence >= AUTOCAL_APPLY_CONFIDENCE) {
+        fullCm = mmToCm(proposal.fullMm);
+    }
+    
+    float currentEmpty, currentFull;
+    primary->getCalibration(currentEmpty, currentFull);
+    if (emptyCm == currentEmpty && fullCm == currentFull) {
+        return; // Nothing confident enough yet
+    }
+    
+    if (configManager.setTankCalibration(tank.index, emptyCm, fullCm)) {
+        DEBUG_PRINTF("Auto-calibration: tank %d now %.1f / %.1f cm (confidence %d%% / %d%%)\n",
+                     tank.index + 1, emptyCm, fullCm, proposal.emptyConfidence, proposal.fullConfidence);
+        primary->setCalibration(emptyCm, fullCm);
+        configManager.requestSave();
+    }
+}
+
+const SensorReading* TankRegistry::getValidReading(uint8_t index) const {
+    if (index >= tankCount || !tanks[index].reading.isValid) {
+        return nullptr;
+    }
+    return &tanks[index].reading;
+}
+
+bool TankRegistry::getMaxRate(int16_t& rateCentiPerMin) const {
+    bool found = false;
+    rateCentiPerMin = 0;
+    
+    for (uint8_t i = 0; i < tankCount; i++) {
+        if (tanks[i].reading.isValid) {
+            rateCentiPerMin = max(rateCentiPerMin, (int16_t)abs(tanks[i].reading.rateCentiPerMin));
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool TankRegistry::isChangeSuspected() const {
+    for (uint8_t i = 0; i < tankCount; i++) {
+        if (tanks[i].changes.isSuspect()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TankRegistry::takeChangeEvent(ChangeEvent& event) {
+    for (uint8_t i = 0; i < tankCount; i++) {
+        if (tanks[i].changes.takeEvent(event)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TankRegistry::requestClutterReset() {
+    requests.fetch_or(TANK_REQUEST_CLUTTER_RESET, std::memory_order_release);
+}
+
+void TankRegistry::requestAutoCalReset() {
+    requests.fetch_or(TANK_REQUEST_AUTOCAL_RESET, std::memory_order_release);
+}
+
+bool TankRegistry::requestTraceSink(uint8_t index, EchoTraceSink* sink) {
+    // Serial traces are captured at the module, so only pulse timing is recorded
+    if (!getPulseSensor(index)) {
+        return false;
+    }
+    traceSinks[index].store(sink, std::memory_order_relaxed);
+    traceRequests.fetch_or(1 << index, std::memory_order_release);
+    return true;
+}
+
+void TankRegistry::applyRequests() {
+    uint8_t pending = requests.exchange(0, std::memory_order_acquire);
+    if (pending & TANK_REQUEST_CLUTTER_RESET) {
+        clearClutterMaps();
+    }
+    if (pending & TANK_REQUEST_AUTOCAL_RESET) {
+        resetAutoCalibration();
+    }
+    applyTraceSinks();
+}
+
+void TankRegistry::applyTraceSinks() {
+    uint8_t pending = traceRequests.exchange(0, std::memory_order_acquire);
+    for (uint8_t i = 0; pending && i < tankCount; i++) {
+        if (pending & (1 << i)) {
+            UltrasonicSensor* sensor = getPulseSensor(i);
+            if (sensor) {
+                sensor->setTraceSink(traceSinks[i].load(std::memory_order_relaxed), i + 1);
+            }
+        }
+    }
+}
+
+void TankRegistry::clearClutterMaps() {
+    // The next update persists the cleared maps
+    for (uint8_t i = 0; i < tankCount; i++) {
+        for (uint8_t s = 0; s < MAX_TANK_SENSORS; s++) {
+            if (tanks[i].sensors[s]) {
+                tanks[i].sensors[s]->getClutterMap().clear();
+            }
+        }
+    }
+}
+
+void TankRegistry::resetAutoCalibration() {
+    for (uint8_t i = 0; i < tankCount; i++) {
+        tanks[i].autoCal.reset();
+    }
+}
+
+UltrasonicSensor* TankRegistry::getPulseSensor(uint8_t index) const {
+    if (index >= tankCount) {
+        return nullptr;
+    }
+    
+    for (uint8_t s = 0; s < MAX_TANK_SENSORS; s++) {
+        LevelSensor* sensor = tanks[index].sensors[s];
+        if (sensor && sensor->getDriver() == DRIVER_PULSE) {
+            return static_cast<UltrasonicSensor*>(sensor);
+        }
+    }
+    return nullptr;
+}
+
@@ -0,0 +1,119 @@
+#ifndef TANK_REGISTRY_H
+#define TANK_REGISTRY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "config_manager.h"
+#include "level_sensor.h"
+#include "level_estimator.h"
+#include "auto_calibrator.h"
+#include "sensor_fusion.h"
+#include "change_detector.h"
+#include "acquisition_scheduler.h"
+#include "temperature_source.h"
+#include "echo_trace.h"
+#include "sensor_ultrasonic.h"
+#include <atomic>
+
+// One monitored tank: configuration, sensors and processing state
+struct TankDescriptor {
+    uint8_t index;              // 0-based; shown to users as tank index + 1
+    const TankConfig* config;   // Name, driver, calibration (owned by ConfigManager)
+    LevelSensor* sensor;        // First fitted sensor, nullptr when the tank has none
+    LevelSensor* sensors[MAX_TANK_SENSORS];  // [0] primary, then redundant; nullptr if not fitted
+    uint8_t sensorCount;        // Fitted sensors (more than one: readings are fused)
+    SensorReading inputs[MAX_TANK_SENSORS];  // Raw reading of every sensor
+    SensorFusion fusion;        // Combines the inputs of a multi-sensor tank
+    LevelEstimator estimator;   // Filtered level and fill/drain rate
+    ChangeDetector changes;     // Departures of the filtered level from its trend
+    AutoCalibrator autoCal;     // Calibration learning (opt-in via autoCalMode)
+    SensorReading reading;      // Latest estimated reading
+    bool inflow;                // Being filled by the pump (set by the pump owner)
+    uint32_t inflowSeenMs;      // Last time inflow was known or seen in the rate
+    uint8_t filterProfile;      // FilterProfile applied to all of the tank's sensors
+};
+
+/**
+ * Statically sized table of the configured tanks.
+ *
+ * Holds up to MAX_TANKS descriptors, so memory is fixed at compile time.
+ * Sensors are registered with the acquisition scheduler in tank order (a
+ * tank's redundant sensors follow its primary) and every publisher (web,
+ * MQTT, BLE, display) iterates count() / get() instead of naming
+ * individual tanks.
+ */
+class TankRegistry {
+public:
+    TankRegistry(ConfigManager& configManager);
+    
+    // Create the sensors of every configured tank; returns how many tanks have one
+    uint8_t begin(AcquisitionScheduler& acquisition, TemperatureSource* temperature);
+    
+    // Fold one acquisition cycle (readings in scheduler order) into the tanks,
+    // fusing multi-sensor tanks, then persist learned clutter and run
+    // calibration learning; true if a tank's level changed course
+    bool update(const SensorReading* readings);
+    
+    // Configured tanks
+    uint8_t count() const { return tankCount; }
+    TankDescriptor& get(uint8_t index) { return tanks[index]; }
+    const TankDescriptor& get(uint8_t index) const { return tanks[index]; }
+    
+    // Latest reading of a tank, nullptr if not configured or not valid
+    const SensorReading* getValidReading(uint8_t index) const;
+    
+    // Fastest |rate| over tanks with a valid reading; false if there are none
+    bool getMaxRate(int16_t& rateCentiPerMin) const;
+    
+    // Change-point detection: deviation building up in any tank, and the
+    // next pending event (network task)
+    bool isChangeSuspected() const;
+    bool takeChangeEvent(ChangeEvent& event);
+    
+    // Pump inflow into a tank; filling switches its sensors to the stronger
+    // filter profile until FILL_PROFILE_HOLD_MS after the inflow (or a fast
+    // rise from another source) has ended
+    void setInflow(uint8_t index, bool inflow);
+    
+    // Runtime commands (any task): flagged here and carried out by the
+    // sensor task before its next cycle, never under a running burst
+    void requestClutterReset();
+    void requestAutoCalReset();
+    
+    // Record the pings of a tank's pulse-timed sensor (nullptr = stop); the
+    // sensor task writes the trace header and swaps the sink between bursts.
+    // False if the tank has no such sensor
+    bool requestTraceSink(uint8_t index, EchoTraceSink* sink);
+    
+    // Sensor task: carry out the requested commands
+    void applyRequests();
+    
+    // First pulse-timed sensor of a tank, nullptr if it has none
+    UltrasonicSensor* getPulseSensor(uint8_t index) const;
+
+private:
+    ConfigManager& configManager;
+    TankDescriptor tanks[MAX_TANKS];
+    uint8_t tankCount;
+    uint8_t nextUart;           // Hardware UARTs are handed out in scheduler order
+    std::atomic<uint8_t> requests;  // TankRequest bits, cleared by the sensor task
+    std::atomic<uint8_t> traceRequests;             // Tank bits with a new trace sink
+    std::atomic<EchoTraceSink*> traceSinks[MAX_TANKS];  // Requested sink per tank
+    
+    // Commands waiting for the sensor task
+    enum TankRequest {
+        TANK_REQUEST_CLUTTER_RESET = 1 << 0,
+        TANK_REQUEST_AUTOCAL_RESET = 1 << 1
+    };
+    
+    void clearClutterMaps();
+    void resetAutoCalibration();
+    void applyTraceSinks();
+    LevelSensor* createSensor(uint8_t index, uint8_t slot, TemperatureSource* temperature);
+    uint8_t* clutterStorage(uint8_t index, uint8_t slot);
+    void persistClutter(TankDescriptor& tank, uint8_t slot);
+    void updateAutoCalibration(TankDescriptor& tank);
+    void selectFilterProfile(TankDescriptor& tank, uint32_t now);
+};
+
+#endif // TANK_REGISTRY_H
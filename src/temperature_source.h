@@ -0,0 +1,34 @@
+#ifndef TEMPERATURE_SOURCE_H
+#define TEMPERATURE_SOURCE_H
+
+#include <Arduino.h>
+
+/**
+ * Air temperature provider for speed-of-sound compensation.
+ * Probe drivers (DS18B20, SHT3x, ...) implement readTemperature().
+ */
+class TemperatureSource {
+public:
+    virtual ~TemperatureSource() {}
+    
+    // Temperature in 0.1 °C; returns false if no valid value is available
+    virtual bool readTemperature(int16_t& celsiusTenths) = 0;
+};
+
+// Constant temperature taken from configuration
+class FixedTemperatureSource : public TemperatureSource {
+public:
+    FixedTemperatureSource(float celsius) { setTemperature(celsius); }
+    
+    void setTemperature(float celsius) { celsiusTenths = (int16_t)lroundf(celsius * 10.0f); }
+    
+    bool readTemperature(int16_t& celsiusTenths) override {
+        celsiusTenths = this->celsiusTenths;
+        return true;
+    }
+    
+private:
+    int16_t celsiusTenths;
+};
+
+#endif // TEMPERATURE_SOURCE_H
@@ -2,12 +2,19 @@
 #include "pump_controller.h"
 #include "config.h"
 
+// Status document capacity (the per-tank share covers sensor and auto-cal fields)
+#define STATUS_PUMP_ACKS 5      // Most recent command outcomes listed in the status
+#define STATUS_JSON_BASE_SIZE (1024 + PUMP_STOP_LOG_SIZE * 128 + STATUS_PUMP_ACKS * 112)
+#define STATUS_JSON_TANK_SIZE (768 + MAX_TANK_SENSORS * 256)
+
 WebServer::WebServer(ConfigManager& configManager, uint16_t port)
     : configManager(configManager),
       server(port),
-      sensor1(nullptr),
-      sensor2(nullptr),
+      diagSocket("/api/diag/ws"),
+      tanks(nullptr),
       pumpController(nullptr),
+      samplingPolicy(nullptr),
+      diagnostics(nullptr),
       running(false) {
 }
 
@@ -75,6 +82,15 @@ void WebServer::setupRoutes() {
     server.on("/api/pump", HTTP_POST, [this](AsyncWebServerRequest* request) {
         handlePumpControl(request);
     });
+    server.on("/api/pump", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        handlePumpAck(request);
+    });
+    
+    // Raw echo diagnostics: started over HTTP, frames pushed on the web socket
+    server.on("/api/diag", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        handleDiagnostics(request);
+    });
+    server.addHandler(&diagSocket);
     
     // OTA update endpoint
     server.on("/api/update", HTTP_POST, [this](AsyncWebServerRequest* request) {
@@ -134,7 +150,8 @@ void WebServer::handleRoot(AsyncWebServerRequest* request) {
         response->print(F("function startStatusUpdates(){updateStatus();statusInterval=setInterval(updateStatus,3000)}"));
         response->print(F("function stopStatusUpdates(){clearInterval(statusInterval)}"));
         response->print(F("async function updateStatus(){try{const r=await fetch('/api/status');const d=await r.json();"));
-        response->print(F("document.getElementById('tank-display').innerHTML=`<div class='card'><h2>${d.tank1?.name||'Tank'}</h2><div class='level'>${(d.tank1?.level||0).toFixed(0)}%</div></div>`;"));
+        response->print(F("let h='';for(let i=1;i<=(d.tankCount||1);i++){const t=d['tank'+i];if(t)h+=`<div class='card'><h2>${t.name}</h2><div class='level'>${(t.level||0).toFixed(0)}%</div></div>`}"));
+        response->print(F("document.getElementById('tank-display').innerHTML=h;"));
         response->print(F("document.getElementById('wifi-status').textContent=d.wifi?'Connected':'Disconnected';"));
         response->print(F("document.getElementById('mqtt-status').textContent=d.mqtt?'Connected':'Disconnected';"));
         response->print(F("document.getElementById('pump-status').textContent=d.pump?'ON':'OFF'}catch(e){console.error(e)}}"));
@@ -227,11 +244,8 @@ void WebServer::handleRoot(AsyncWebServerRequest* request) {
                 
                 <h3>Tank Configuration</h3>
                 <div class="form-group">
-                    <label>Mode:</label>
-                    <select id="tank-mode">
-                        <option value="0">Single Tank</option>
-                        <option value="1">Dual Tank</option>
-                    </select>
+                    <label>Number of Tanks:</label>
+                    <input type="number" id="tank-count" min="1" value="1" required>
                 </div>
                 <div class="form-group">
                     <label>Tank 1 Empty (cm):</label>
@@ -287,34 +301,20 @@ void WebServer::handleRoot(AsyncWebServerRequest* request) {
                 const response = await fetch('/api/status');
                 const data = await response.json();
                 
-                // Update tank display
+                // Update tank display ("tank1" .. "tankN")
                 let tankHTML = '';
-                if (data.tankMode === 0) {
-                    tankHTML = `
+                for (let i = 1; i <= (data.tankCount || 1); i++) {
+                    const tank = data['tank' + i];
+                    if (!tank) continue;
+                    tankHTML += `
                         <div class="tank">
-                            <h2>${data.tank1.name}</h2>
-                            <div class="level">${data.tank1.level.toFixed(0)}%</div>
+                            <h2>${tank.name}</h2>
+                            <div class="level">${tank.level.toFixed(0)}%</div>
                             <div class="progress">
-                                <div class="progress-bar" style="width: ${data.tank1.level}%"></div>
-                            </div>
-                            <p>${data.tank1.distance.toFixed(1)} cm</p>
-                        </div>
-                    `;
-                } else {
-                    tankHTML = `
-                        <div class="tank">
-                            <h2>${data.tank1.name}</h2>
-                            <div class="level">${data.tank1.level.toFixed(0)}%</div>
-                            <div class="progress">
-                                <div class="progress-bar" style="width: ${data.tank1.level}%"></div>
-                            </div>
-                        </div>
-                        <div class="tank">
-                            <h2>${data.tank2.name}</h2>
-                            <div class="level">${data.tank2.level.toFixed(0)}%</div>
-                            <div class="progress">
-                                <div class="progress-bar" style="width: ${data.tank2.level}%"></div>
+                                <div class="progress-bar" style="width: ${tank.level}%"></div>
                             </div>
+                            <p>${tank.distance.toFixed(1)} cm</p>
+                            ${(tank.inputs || []).map(s => `<p>Sensor ${s.sensor}: ${s.valid ? s.levelRaw.toFixed(1) + '% (' + s.weight.toFixed(0) + '%)' : 'offline'}</p>`).join('')}
                         </div>
                     `;
                 }
@@ -362,7 +362,7 @@ void WebServer::handleRoot(AsyncWebServerRequest* request) {
 </body>
 </html>
     )rawliteral";
-        
+    
         request->send(200, "text/html", html);
     #endif
 }
@@ -451,71 +451,383 @@ void WebServer::handlePumpControl(AsyncWebServerRequest* request) {
     if (request->hasParam("action", true)) {
         String action = request->getParam("action", true)->value();
         
+        PumpCommandType type;
         if (action == "on") {
-            pumpController->turnOn();
+            type = PUMP_CMD_ON;
         } else if (action == "off") {
-            pumpController->turnOff();
+            type = PUMP_CMD_OFF;
+        } else if (action == "reset") {
+            type = PUMP_CMD_RESET;
         } else {
             request->send(400, "application/json", "{\"error\":\"Invalid action\"}");
             return;
         }
         
-        request->send(200, "application/json", "{\"success\":true}");
+        // Applied by the pump task; GET /api/pump?command=N has the outcome
+        uint32_t ticket;
+        if (!pumpController->post(type, PUMP_ORIGIN_WEB, &ticket)) {
+            request->send(503, "application/json", "{\"error\":\"Pump command queue full\"}");
+            return;
+        }
+        
+        char response[48];
+        snprintf(response, sizeof(response), "{\"success\":true,\"command\":%lu}", (unsigned long)ticket);
+        request->send(200, "application/json", response);
     } else {
         request->send(400, "application/json", "{\"error\":\"Missing action parameter\"}");
     }
 }
 
+void WebServer::handlePumpAck(AsyncWebServerRequest* request) {
+    if (!pumpController) {
+        request->send(500, "application/json", "{\"error\":\"Pump not available\"}");
+        return;
+    }
+    if (!request->hasParam("command")) {
+        request->send(400, "application/json", "{\"error\":\"Missing command parameter\"}");
+        return;
+    }
+    
+    uint32_t ticket = strtoul(request->getParam("command")->value().c_str(), nullptr, 10);
+    const PumpCommandQueue& queue = pumpController->getCommandQueue();
+    PumpCommandAck ack;
+    if (!queue.getAck(ticket, ack)) {
+        if (queue.isPending(ticket)) {
+            request->send(202, "application/json", "{\"pending\":true}");
+        } else {
+            request->send(410, "application/json", "{\"error\":\"Outcome no longer kept\"}");
+        }
+        return;
+    }
+    
+    char response[128];
+    snprintf(response, sizeof(response),
+             "{\"command\":%lu,\"type\":%u,\"accepted\":%s,\"state\":%u,\"fault\":%u,\"latencyUs\":%lu}",
+             (unsigned long)ack.ticket, ack.type, ack.accepted ? "true" : "false",
+             ack.state, ack.fault, (unsigned long)ack.latencyUs);
+    request->send(200, "application/json", response);
+}
+
+void WebServer::handleDiagnostics(AsyncWebServerRequest* request) {
+    if (!diagnostics || !tanks) {
+        request->send(500, "application/json", "{\"error\":\"Diagnostics not available\"}");
+        return;
+    }
+    
+    if (request->hasParam("action", true) && request->getParam("action", true)->value() == "stop") {
+        diagnostics->stop();
+        request->send(200, "application/json", "{\"success\":true}");
+        return;
+    }
+    
+    if (!request->hasParam("tank", true)) {
+        request->send(400, "application/json", "{\"error\":\"Missing tank parameter\"}");
+        return;
+    }
+    
+    int tank = request->getParam("tank", true)->value().toInt();
+    if (tank < 1 || tank > tanks->count() || !tanks->getPulseSensor(tank - 1)) {
+        request->send(400, "application/json", "{\"error\":\"Tank has no pulse-timed sensor\"}");
+        return;
+    }
+    
+    // Readings (and with them the pump's level limits) stop while streaming
+    if (pumpController && pumpController->isRunning()) {
+        request->send(409, "application/json", "{\"error\":\"Pump is running\"}");
+        return;
+    }
+    
+    long seconds = DIAG_DEFAULT_SECONDS;
+    if (request->hasParam("seconds", true)) {
+        seconds = request->getParam("seconds", true)->value().toInt();
+        seconds = constrain(seconds, 1, DIAG_MAX_SECONDS);
+    }
+    
+    diagnostics->start(tank - 1, seconds * 1000UL, millis());
+    
+    char response[64];
+    snprintf(response, sizeof(response), "{\"success\":true,\"seconds\":%ld}", seconds);
+    request->send(200, "application/json", response);
+}
+
+void WebServer::streamDiagnostics() {
+    if (!running) {
+        return;
+    }
+    diagSocket.cleanupClients();
+    
+    if (!diagnostics) {
+        return;
+    }
+    diagnostics->checkExpiry(millis());
+    
+    // Without listeners the ring is still drained so a client that connects
+    // late starts with fresh pings
+    if (diagSocket.count() == 0) {
+        while (diagnostics->buildFrame(diagFrame, millis()) > 0) {
+        }
+        return;
+    }
+    
+    // Stop at a slow client rather than queue frames behind it
+    while (diagSocket.availableForWriteAll()) {
+        size_t length = diagnostics->buildFrame(diagFrame, millis());
+        if (length == 0) {
+            break;
+        }
+        diagSocket.binaryAll(diagFrame, length);
+    }
+}
+
 String WebServer::getStatusJSON() {
-    DynamicJsonDocument doc(1024);
-    const SystemConfig& config = configManager.getConfig();
+    DynamicJsonDocument doc(STATUS_JSON_BASE_SIZE + MAX_TANKS * STATUS_JSON_TANK_SIZE);
     
-    doc["tankMode"] = config.tankMode;
     doc["wifi"] = WiFi.status() == WL_CONNECTED;
     doc["mqtt"] = false; // Will be set by MQTT client
     doc["ble"] = true;
     doc["pump"] = pumpController ? pumpController->isRunning() : false;
+    doc["tankCount"] = tanks ? tanks->count() : 0;
     
-    JsonObject tank1 = doc.createNestedObject("tank1");
-    tank1["name"] = config.tank1Name;
-    if (sensor1) {
-        const SensorReading& reading = sensor1->getLastReading();
-        tank1["level"] = reading.levelPercent;
-        tank1["distance"] = reading.distanceCm;
-        tank1["valid"] = reading.isValid;
-    } else {
-        tank1["level"] = 0;
-        tank1["distance"] = 0;
-        tank1["valid"] = false;
+    // "tank1" .. "tankN"
+    for (uint8_t i = 0; tanks && i < tanks->count(); i++) {
+        const TankDescriptor& descriptor = tanks->get(i);
+        
+        char key[8];
+        snprintf(key, sizeof(key), "tank%d", i + 1);
+        JsonObject tank = doc.createNestedObject(key);
+        tank["name"] = descriptor.config->name;
+        addTankJSON(tank, descriptor.reading);
+        if (descriptor.sensor) {
+            addSensorJSON(tank, *descriptor.sensor);
+        }
+        if (descriptor.sensorCount > 1) {
+            addFusionJSON(tank, descriptor);
+        }
+        addAutoCalJSON(tank, descriptor.autoCal);
+        tank["changeEvents"] = descriptor.changes.getEventCount();
     }
     
-    if (config.tankMode == DUAL_TANK && sensor2) {
-        JsonObject tank2 = doc.createNestedObject("tank2");
-        tank2["name"] = config.tank2Name;
-        const SensorReading& reading = sensor2->getLastReading();
-        tank2["level"] = reading.levelPercent;
-        tank2["distance"] = reading.distanceCm;
-        tank2["valid"] = reading.isValid;
+    if (pumpController) {
+        addPumpJSON(doc);
     }
     
+    if (diagnostics && diagnostics->isActive()) {
+        JsonObject diag = doc.createNestedObject("diagnostic");
+        diag["tank"] = diagnostics->getTank() + 1;
+        diag["remaining"] = diagnostics->getRemainingMs(millis()) / 1000;
+        diag["dropped"] = diagnostics->getDroppedCount();
+    }
+    
+    if (samplingPolicy) {
+        JsonObject sampling = doc.createNestedObject("sampling");
+        sampling["interval"] = samplingPolicy->getInterval();
+        sampling["avgInterval"] = samplingPolicy->getAverageInterval();
+        sampling["fast"] = samplingPolicy->getDecisionCount(SAMPLING_FAST);
+        sampling["normal"] = samplingPolicy->getDecisionCount(SAMPLING_NORMAL);
+        sampling["backoff"] = samplingPolicy->getDecisionCount(SAMPLING_BACKOFF);
+    }
+    
+    JsonObject storage = doc.createNestedObject("storage");
+    storage["saves"] = configManager.getSaveCount();
+    storage["coalesced"] = configManager.getCoalescedSaveCount();
+    storage["pending"] = configManager.isSavePending();
+    
     String output;
     serializeJson(doc, output);
     return output;
 }
 
+void WebServer::addTankJSON(JsonObject& tank, const SensorReading& reading) {
+    tank["level"] = centiToPercent(reading.filteredCenti);
+    tank["levelRaw"] = centiToPercent(reading.levelCenti);
+    tank["rate"] = centiToPercent(reading.rateCentiPerMin);
+    tank["confidence"] = reading.confidence;
+    tank["distance"] = mmToCm(reading.distanceMm);
+    tank["volume"] = reading.volumeDl / 10.0f;
+    tank["valid"] = reading.isValid;
+    tank["error"] = reading.errorCode;
+    tank["pings"] = reading.pings;
+}
+
+void WebServer::addSensorJSON(JsonObject& tank, const LevelSensor& sensor) {
+    tank["echoWindowUs"] = sensor.getTimeout();
+    tank["noResponse"] = sensor.getNoResponseCount();
+    tank["noEcho"] = sensor.getNoEchoCount();
+    tank["avgPings"] = sensor.getAveragePings();
+    tank["clutterBins"] = sensor.getClutterMap().getBinCount();
+    tank["clutterRejects"] = sensor.getClutterRejectCount();
+    tank["driver"] = sensor.getDriver();
+    
+    // Filter behaviour per profile, to compare calm and filling conditions
+    static const char* const PROFILE_NAMES[FILTER_PROFILE_COUNT] = { "rest", "filling" };
+    tank["filterProfile"] = PROFILE_NAMES[sensor.getFilterProfile()];
+    tank["filterWindow"] = sensor.getFilter().getWindow();
+    JsonObject profiles = tank.createNestedObject("filterProfiles");
+    for (uint8_t p = 0; p < FILTER_PROFILE_COUNT; p++) {
+        const FilterProfileStats& stats = sensor.getProfileStats(p);
+        JsonObject profile = profiles.createNestedObject(PROFILE_NAMES[p]);
+        profile["activations"] = stats.activations;
+        profile["readings"] = stats.readings;
+        profile["pings"] = stats.pings;
+        profile["accepted"] = stats.accepted;
+        profile["rejected"] = stats.rejected;
+        profile["avgSpreadMm"] = stats.readings ? (float)stats.spreadSumMm / stats.readings : 0.0f;
+    }
+    
+    if (sensor.getDriver() == DRIVER_UART_AUTO || sensor.getDriver() == DRIVER_UART_CONTROLLED) {
+        const JsnFrameParser& parser = static_cast<const JsnUartSensor&>(sensor).getParser();
+        tank["frames"] = parser.getFrameCount();
+        tank["checksumErrors"] = parser.getChecksumErrors();
+    } else if (sensor.getDriver() == DRIVER_PULSE) {
+        tank["echoHolds"] = static_cast<const UltrasonicSensor&>(sensor).getEchoHoldCount();
+    } else if (sensor.getDriver() == DRIVER_PRESSURE) {
+        const PressureSensor& pressure = static_cast<const PressureSensor&>(sensor);
+        tank["millivolts"] = pressure.getLastMillivolts();
+        tank["adcOverruns"] = pressure.getOverrunCount();
+    }
+}
+
+void WebServer::addPumpJSON(JsonDocument& doc) {
+    JsonObject pump = doc.createNestedObject("pumpControl");
+    pump["stopLatencyMs"] = pumpController->getStopLatency();
+    pump["timerLatenessMs"] = pumpController->getMaxTimerLateness();
+    if (pumpController->getState() == PUMP_ERROR) {
+        pump["fault"] = pumpController->getFault();
+        pump["error"] = pumpController->getLastError();
+    }
+    
+    // Predicted against actual peak level of recent level stops
+    JsonArray stops = pump.createNestedArray("stops");
+    for (uint8_t i = 0; i < pumpController->getStopLogCount(); i++) {
+        const PumpStopRecord& record = pumpController->getStopRecord(i);
+        JsonObject stop = stops.createNestedObject();
+        stop["age"] = (millis() - record.timestamp) / 1000;
+        stop["predictive"] = record.predictive;
+        stop["level"] = centiToPercent(record.levelCenti);
+        stop["predicted"] = centiToPercent(record.predictedCenti);
+        stop["actual"] = centiToPercent(record.actualCenti);
+        stop["rate"] = record.rateCentiPerMin / 100.0f;
+    }
+    
+    // Command queue: latency and the most recent outcomes, newest first
+    static const char* origins[] = {"web", "mqtt", "ble", "auto", "timer"};
+    const PumpCommandQueue& queue = pumpController->getCommandQueue();
+    JsonObject commands = doc.createNestedObject("pumpCommands");
+    uint32_t applied = queue.getAppliedCount();
+    commands["posted"] = queue.getPostedCount();
+    commands["applied"] = applied;
+    commands["dropped"] = queue.getDroppedCount();
+    commands["avgLatencyUs"] = queue.getAvgLatencyUs();
+    commands["maxLatencyUs"] = queue.getMaxLatencyUs();
+    JsonArray acks = commands.createNestedArray("acks");
+    for (uint32_t i = 1; i <= STATUS_PUMP_ACKS && i <= applied; i++) {
+        PumpCommandAck ack;
+        if (queue.getAck(applied - i, ack)) {
+            JsonObject entry = acks.createNestedObject();
+            entry["command"] = ack.ticket;
+            entry["origin"] = ack.origin < PUMP_ORIGIN_COUNT ? origins[ack.origin] : "unknown";
+            entry["type"] = ack.type;
+            entry["accepted"] = ack.accepted;
+            entry["state"] = ack.state;
+            entry["latencyUs"] = ack.latencyUs;
+        }
+    }
+    
+    if (pumpController->getMode() == PUMP_SCHEDULED) {
+        JsonObject schedule = pump.createNestedObject("schedule");
+        schedule["open"] = pumpController->isWindowOpen();
+        uint32_t ms;
+        if (pumpController->getWindowChangeIn(ms)) {
+            schedule["nextCheckS"] = ms / 1000;
+        }
+    }
+}
+
+void WebServer::addFusionJSON(JsonObject& tank, const TankDescriptor& descriptor) {
+    const SensorFusion& fusion = descriptor.fusion;
+    tank["fusedInputs"] = fusion.getActiveInputs();
+    tank["failovers"] = fusion.getFailoverCount();
+    
+    // Raw level of every sensor next to the fused one
+    JsonArray inputs = tank.createNestedArray("inputs");
+    for (uint8_t s = 0; s < MAX_TANK_SENSORS; s++) {
+        const LevelSensor* sensor = descriptor.sensors[s];
+        if (!sensor) {
+            continue;
+        }
+        
+        const SensorReading& reading = descriptor.inputs[s];
+        JsonObject input = inputs.createNestedObject();
+        input["sensor"] = s + 1;
+        input["driver"] = sensor->getDriver();
+        input["levelRaw"] = centiToPercent(reading.levelCenti);
+        input["distance"] = mmToCm(reading.distanceMm);
+        input["valid"] = reading.isValid;
+        input["error"] = reading.errorCode;
+        input["healthy"] = sensor->isHealthy();
+        input["weight"] = fusion.getWeightPermille(s) / 10.0f;
+        input["noise"] = sqrtf(fusion.getVariance(s)) / 100.0f;
+        input["bias"] = centiToPercent(fusion.getBias(s));
+        input["errorRate"] = fusion.getErrorRate(s) / 10.0f;
+    }
+}
+
+void WebServer::addAutoCalJSON(JsonObject& tank, const AutoCalibrator& calibrator) {
+    if (configManager.getConfig().autoCalMode == AUTOCAL_OFF) {
+        return;
+    }
+    
+    const CalibrationProposal& proposal = calibrator.getProposal();
+    JsonObject autoCal = tank.createNestedObject("autoCal");
+    autoCal["readings"] = calibrator.getReadingCount();
+    autoCal["valid"] = proposal.valid;
+    if (proposal.valid) {
+        autoCal["emptyCm"] = mmToCm(proposal.emptyMm);
+        autoCal["fullCm"] = mmToCm(proposal.fullMm);
+        autoCal["emptyConfidence"] = proposal.emptyConfidence;
+        autoCal["fullConfidence"] = proposal.fullConfidence;
+    }
+}
+
 String WebServer::getConfigJSON() {
-    DynamicJsonDocument doc(2048);
+    DynamicJsonDocument doc(STATUS_JSON_BASE_SIZE + MAX_TANKS * 128 + PUMP_SCHEDULE_MAX_WINDOWS * 64);
     const SystemConfig& config = configManager.getConfig();
     
-    doc["tankMode"] = config.tankMode;
+    doc["tankCount"] = config.tankCount;
+    doc["maxTanks"] = MAX_TANKS;
     doc["wifiSSID"] = config.wifiSSID;
     doc["mqttBroker"] = config.mqttBroker;
     doc["mqttPort"] = config.mqttPort;
-    doc["tank1Empty"] = config.tank1EmptyCm;
-    doc["tank1Full"] = config.tank1FullCm;
-    doc["tank2Empty"] = config.tank2EmptyCm;
-    doc["tank2Full"] = config.tank2FullCm;
     doc["pumpMode"] = config.pumpMode;
+    doc["pumpPredictive"] = config.pumpPredictiveStop;
+    doc["pumpStallRise"] = config.pumpStallRise;
+    doc["pumpStallWindow"] = config.pumpStallWindow;
+    doc["timeZone"] = config.timeZone;
+    
+    JsonArray windows = doc.createNestedArray("pumpWindows");
+    for (uint8_t i = 0; i < config.pumpWindowCount; i++) {
+        char start[16], end[16];    // Copied into the document
+        PumpSchedule::formatMinute(start, sizeof(start), config.pumpWindows[i].startMin);
+        PumpSchedule::formatMinute(end, sizeof(end), config.pumpWindows[i].endMin);
+        JsonObject window = windows.createNestedObject();
+        window["start"] = start;
+        window["end"] = end;
+    }
+    
+    JsonArray tankList = doc.createNestedArray("tanks");
+    for (uint8_t i = 0; i < config.tankCount; i++) {
+        JsonObject tank = tankList.createNestedObject();
+        tank["name"] = config.tanks[i].name;
+        tank["empty"] = config.tanks[i].emptyCm;
+        tank["full"] = config.tanks[i].fullCm;
+        tank["driver"] = config.tanks[i].driver;
+        
+        uint8_t redundant = 0;
+        for (uint8_t s = 0; s < MAX_TANK_SENSORS - 1; s++) {
+            if (config.tanks[i].redundant[s].driver != DRIVER_NONE) redundant++;
+        }
+        tank["redundantSensors"] = redundant;
+    }
     
     String output;
     serializeJson(doc, output);
@@ -20,7 +20,13 @@
 
 #include <ArduinoJson.h>
 #include "config_manager.h"
-#include "sensor_ultrasonic.h"
+#include "level_sensor.h"
+#include "jsn_uart_sensor.h"
+#include "pressure_sensor.h"
+#include "sampling_policy.h"
+#include "auto_calibrator.h"
+#include "tank_registry.h"
+#include "diagnostic_stream.h"
 
 // Forward declarations
 class PumpController;
@@ -33,10 +39,14 @@ public:
     bool begin();
     void stop();
     
-    // Register sensor and pump references
-    void setSensor1(UltrasonicSensor* sensor) { sensor1 = sensor; }
-    void setSensor2(UltrasonicSensor* sensor) { sensor2 = sensor; }
+    // Register tank and pump references
+    void setTankRegistry(const TankRegistry* registry) { tanks = registry; }
     void setPumpController(PumpController* pump) { pumpController = pump; }
+    void setSamplingPolicy(const SamplingPolicy* policy) { samplingPolicy = policy; }
+    void setDiagnosticStream(DiagnosticStream* stream) { diagnostics = stream; }
+    
+    // Send pending raw echo frames to web socket clients (network task)
+    void streamDiagnostics();
     
     // Server status
     bool isRunning() const { return running; }
@@ -44,11 +54,16 @@ public:
 private:
     ConfigManager& configManager;
     AsyncWebServer server;
-    UltrasonicSensor* sensor1;
-    UltrasonicSensor* sensor2;
+    AsyncWebSocket diagSocket;
+    const TankRegistry* tanks;
     PumpController* pumpController;
+    const SamplingPolicy* samplingPolicy;
+    DiagnosticStream* diagnostics;
     bool running;
     
+    // Reused for every diagnostic frame
+    uint8_t diagFrame[DIAG_FRAME_SIZE];
+    
     // Route handlers
     void setupRoutes();
     void handleRoot(AsyncWebServerRequest* request);
@@ -60,10 +75,17 @@ private:
     void handleReset(AsyncWebServerRequest* request);
     void handleOTAUpload(AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final);
     void handlePumpControl(AsyncWebServerRequest* request);
+    void handlePumpAck(AsyncWebServerRequest* request);
+    void handleDiagnostics(AsyncWebServerRequest* request);
     
     // Helper functions
     String getStatusJSON();
     String getConfigJSON();
+    void addTankJSON(JsonObject& tank, const SensorReading& reading);
+    void addSensorJSON(JsonObject& tank, const LevelSensor& sensor);
+    void addFusionJSON(JsonObject& tank, const TankDescriptor& descriptor);
+    void addPumpJSON(JsonDocument& doc);
+    void addAutoCalJSON(JsonObject& tank, const AutoCalibrator& calibrator);
     bool validateConfig(JsonObject& config);
     void sendCORS(AsyncWebServerRequest* request);
 };
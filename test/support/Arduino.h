@@ -0,0 +1,102 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimal Arduino core for the native test environment. Only what the
+// platform-independent modules and the simulated HALs use: a host clock
+// that tests move by hand, inert pins and a Serial that discards output.
+// ARDUINO stays undefined, so target-only code (GPIO registers, NVS,
+// network) is left out as on any host build.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+
+#define PI 3.1415926535897932384626433832795
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define CHANGE 0x03
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define F(text) text
+#define digitalPinToInterrupt(pin) (pin)
+
+#ifndef min
+    #define min(a, b) ((a) < (b) ? (a) : (b))
+    #define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#define constrain(x, low, high) ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+
+// ============================================================================
+// HOST CLOCK - moves only through delay() and hostAdvanceUs()
+// ============================================================================
+inline uint64_t& hostClockUs() {
+    static uint64_t now = 0;
+    return now;
+}
+
+inline void hostAdvanceUs(uint32_t us) { hostClockUs() += us; }
+inline uint32_t micros() { return (uint32_t)hostClockUs(); }
+inline uint32_t millis() { return (uint32_t)(hostClockUs() / 1000); }
+inline void delay(uint32_t ms) { hostClockUs() += (uint64_t)ms * 1000; }
+inline void delayMicroseconds(uint32_t us) { hostClockUs() += us; }
+inline void yield() {}
+
+// ============================================================================
+// PINS - outputs go nowhere, digital inputs read LOW
+// ============================================================================
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+inline int analogRead(uint8_t) { return 0; }
+inline void attachInterruptArg(uint8_t, void (*)(void*), void*, int) {}
+inline void detachInterrupt(uint8_t) {}
+
+// ADC: every pin reads the voltage a test sets
+#define ADC_11db 3
+inline uint32_t& hostAnalogMillivolts() {
+    static uint32_t mv = 0;
+    return mv;
+}
+inline uint32_t analogReadMilliVolts(uint8_t) { return hostAnalogMillivolts(); }
+inline void analogSetPinAttenuation(uint8_t, int) {}
+
+// ============================================================================
+// SERIAL AND CHIP
+// ============================================================================
+class Print {
+public:
+    virtual ~Print() {}
+    size_t print(const char*) { return 0; }
+    size_t print(long) { return 0; }
+    size_t println(const char* = "") { return 0; }
+    size_t println(long) { return 0; }
+    size_t printf(const char*, ...) { return 0; }
+};
+
+class HostSerial : public Print {
+public:
+    void begin(unsigned long) {}
+};
+
+static HostSerial Serial;
+
+class HostEsp {
+public:
+    uint64_t getEfuseMac() const { return 0x0000A1B2C3D4E5F6ULL; }
+    uint32_t getChipId() const { return 0x00C3D4E5; }
+    uint32_t getFreeHeap() const { return 0; }
+    void restart() {}
+};
+
+static HostEsp ESP __attribute__((unused));
+
+#endif // HOST_ARDUINO_H
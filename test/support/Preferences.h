@@ -0,0 +1,31 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <Arduino.h>
+
+// Native test stand-in for the ESP32 NVS store: empty on every begin(),
+// so ConfigManager loads its defaults, and writes are dropped
+class Preferences {
+public:
+    bool begin(const char*, bool = false) { return true; }
+    void end() {}
+    bool clear() { return true; }
+    
+    uint8_t getUChar(const char*, uint8_t value = 0) { return value; }
+    uint16_t getUShort(const char*, uint16_t value = 0) { return value; }
+    uint32_t getUInt(const char*, uint32_t value = 0) { return value; }
+    float getFloat(const char*, float value = 0) { return value; }
+    bool getBool(const char*, bool value = false) { return value; }
+    size_t getString(const char*, char*, size_t) { return 0; }
+    size_t getBytes(const char*, void*, size_t) { return 0; }
+    
+    size_t putUChar(const char*, uint8_t) { return 1; }
+    size_t putUShort(const char*, uint16_t) { return 2; }
+    size_t putUInt(const char*, uint32_t) { return 4; }
+    size_t putFloat(const char*, float) { return 4; }
+    size_t putBool(const char*, bool) { return 1; }
+    size_t putString(const char*, const char* value) { return strlen(value); }
+    size_t putBytes(const char*, const void*, size_t length) { return length; }
+};
+
+#endif // HOST_PREFERENCES_H
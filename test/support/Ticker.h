@@ -0,0 +1,82 @@
+#ifndef HOST_TICKER_H
+#define HOST_TICKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HOST_TICKER_MAX 16
+
+// Native test stand-in: never fires on its own. Timed code runs on a
+// VirtualClock and its owner calls service() when the clock moves; a test
+// that stands in for the timer calls Ticker::fireAll().
+class Ticker {
+public:
+    Ticker() : callback(nullptr), arg(nullptr), periodMs(0), repeat(false) {
+        for (uint8_t i = 0; i < HOST_TICKER_MAX; i++) {
+            if (!registry()[i]) {
+                registry()[i] = this;
+                break;
+            }
+        }
+    }
+    ~Ticker() {
+        for (uint8_t i = 0; i < HOST_TICKER_MAX; i++) {
+            if (registry()[i] == this) {
+                registry()[i] = nullptr;
+            }
+        }
+    }
+    
+    // Same argument passing as the ESP32 / ESP8266 Ticker
+    template <typename TArg>
+    void once_ms(uint32_t ms, void (*callback)(TArg), TArg arg) {
+        arm(ms, reinterpret_cast<void (*)(void*)>(callback), (void*)arg, false);
+    }
+    template <typename TArg>
+    void attach_ms(uint32_t ms, void (*callback)(TArg), TArg arg) {
+        arm(ms, reinterpret_cast<void (*)(void*)>(callback), (void*)arg, true);
+    }
+    void detach() { callback = nullptr; }
+    bool active() const { return callback != nullptr; }
+    uint32_t getPeriodMs() const { return periodMs; }
+    
+    // Run the callback as the timer would (a one-shot disarms first)
+    void fire() {
+        void (*run)(void*) = callback;
+        if (!repeat) {
+            callback = nullptr;
+        }
+        if (run) {
+            run(arg);
+        }
+    }
+    
+    // Fire every armed Ticker once
+    static void fireAll() {
+        for (uint8_t i = 0; i < HOST_TICKER_MAX; i++) {
+            if (registry()[i]) {
+                registry()[i]->fire();
+            }
+        }
+    }
+
+private:
+    void (*callback)(void*);
+    void* arg;
+    uint32_t periodMs;
+    bool repeat;
+    
+    void arm(uint32_t ms, void (*callback)(void*), void* arg, bool repeat) {
+        this->callback = callback;
+        this->arg = arg;
+        this->periodMs = ms;
+        this->repeat = repeat;
+    }
+    
+    static Ticker** registry() {
+        static Ticker* tickers[HOST_TICKER_MAX] = {};
+        return tickers;
+    }
+};
+
+#endif // HOST_TICKER_H
@@ -0,0 +1,6 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+// Native test stand-in: ConfigManager only needs ESP.getEfuseMac() (Arduino.h)
+
+#endif // HOST_ESP_SYSTEM_H
@@ -0,0 +1,172 @@
+#include <unity.h>
+#include "cic_decimator.h"
+#include "pressure_sensor.h"
+
+// Feed a constant until the decimator has settled; returns the last output
+static int32_t settle(CicDecimator& cic, int32_t input) {
+    int32_t output = 0;
+    uint32_t outputs = 0;
+    while (outputs <= cic.getStages()) {
+        if (cic.push(input, output)) {
+            outputs++;
+        }
+    }
+    return output;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// DECIMATOR
+// ============================================================================
+void test_dc_gain_is_removed_down_to_the_extra_bits(void) {
+    for (uint8_t stages = 1; stages <= CIC_MAX_STAGES; stages++) {
+        CicDecimator cic(stages, 5, 2);
+        TEST_ASSERT_EQUAL_INT32(1800 << 2, settle(cic, 1800));
+    }
+    
+    CicDecimator plain(2, 5, 0);
+    TEST_ASSERT_EQUAL_INT32(1234, settle(plain, 1234));
+}
+
+void test_one_output_per_ratio_inputs(void) {
+    CicDecimator cic(2, 5, 2);
+    int32_t output;
+    uint32_t outputs = 0;
+    for (uint32_t i = 1; i <= 32 * 10; i++) {
+        bool ready = cic.push(100, output);
+        TEST_ASSERT_EQUAL(i % 32 == 0, ready);
+        outputs += ready;
+    }
+    TEST_ASSERT_EQUAL_UINT16(32, cic.getRatio());
+    TEST_ASSERT_EQUAL_UINT32(10, outputs);
+    TEST_ASSERT_EQUAL_UINT32(10, cic.getOutputCount());
+}
+
+void test_settles_after_stages_plus_one_outputs(void) {
+    CicDecimator cic(3, 4, 2);
+    int32_t output;
+    // The step reaches full scale at output N; isSettled() waits one more
+    for (uint8_t n = 1; n <= 3; n++) {
+        while (!cic.push(500, output)) {}
+        TEST_ASSERT_FALSE(cic.isSettled());
+        TEST_ASSERT_EQUAL(n == 3, output == (500 << 2));
+    }
+    while (!cic.push(500, output)) {}
+    TEST_ASSERT_TRUE(cic.isSettled());
+    TEST_ASSERT_EQUAL_INT32(500 << 2, output);
+    
+    cic.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, cic.getOutputCount());
+    TEST_ASSERT_FALSE(cic.isSettled());
+}
+
+void test_boxcar_is_the_block_mean(void) {
+    CicDecimator cic(1, 2, 2);  // Mean of 4, two fraction bits
+    int32_t output;
+    const int32_t block[] = { 100, 101, 103, 104 };
+    for (uint8_t i = 0; i < 4; i++) {
+        cic.push(block[i], output);
+    }
+    TEST_ASSERT_EQUAL_INT32(408, output);           // 102.0 in Q2
+}
+
+void test_integrator_wrap_does_not_corrupt_output(void) {
+    // 12-bit input, 2 stages, ratio 256: the second integrator passes 2^32
+    // within a few thousand samples and keeps wrapping
+    CicDecimator cic(2, 8, 2);
+    int32_t output;
+    int32_t last = 0;
+    for (uint32_t i = 0; i < 1000000; i++) {
+        if (cic.push(4095, output)) {
+            last = output;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT32(4095 << 2, last);
+    
+    // Down again after the wrap
+    for (uint32_t i = 0; i < 256 * 3; i++) {
+        if (cic.push(17, output)) {
+            last = output;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT32(17 << 2, last);
+}
+
+void test_configure_clamps_to_the_gain(void) {
+    CicDecimator cic(9, 12, 40);
+    TEST_ASSERT_EQUAL_UINT8(CIC_MAX_STAGES, cic.getStages());
+    TEST_ASSERT_EQUAL_UINT16(256, cic.getRatio());
+    TEST_ASSERT_EQUAL_UINT8(CIC_MAX_STAGES * 8, cic.getExtraBits());
+    
+    cic.configure(0, 3, 2);
+    TEST_ASSERT_EQUAL_UINT8(1, cic.getStages());
+    TEST_ASSERT_EQUAL_INT32(250 << 2, settle(cic, 250));
+}
+
+// ============================================================================
+// ADC SAMPLE RING OVERRUNS
+// ============================================================================
+void test_full_ring_drops_new_samples_and_counts_them(void) {
+    AdcSampleRing ring;
+    uint16_t sample;
+    for (uint16_t i = 0; i < PRESSURE_RING_SIZE - 1; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+    }
+    TEST_ASSERT_FALSE(ring.push(999));
+    TEST_ASSERT_FALSE(ring.push(998));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.getOverruns());
+    
+    // What was queued comes out intact and in order
+    for (uint16_t i = 0; i < PRESSURE_RING_SIZE - 1; i++) {
+        TEST_ASSERT_TRUE(ring.pop(sample));
+        TEST_ASSERT_EQUAL_UINT16(i, sample);
+    }
+    TEST_ASSERT_FALSE(ring.pop(sample));
+    TEST_ASSERT_TRUE(ring.push(7));
+    TEST_ASSERT_EQUAL_UINT32(2, ring.getOverruns());
+}
+
+void test_reading_survives_a_task_that_falls_behind(void) {
+    PressureSensorConfig scaling;
+    scaling.zeroMv = 600;
+    scaling.fullScaleMv = 3000;
+    scaling.rangeMm = 5000;
+    PressureSensor sensor(34, scaling, 300, 20);
+    TEST_ASSERT_TRUE(sensor.begin());
+    sensor.setConsensus(0, SENSOR_CONSENSUS_TOL_MM, SENSOR_CONSENSUS_MAX_PINGS);
+    hostAnalogMillivolts() = 1800;                  // 2.5 m of water
+    
+    SensorReading reading;
+    sensor.beginBurst();
+    while (!sensor.burstComplete()) {
+        sensor.startPing();
+        // The task is late: the timer overfills the ring before it polls
+        for (uint16_t i = 0; i < PRESSURE_RING_SIZE * 2; i++) {
+            Ticker::fireAll();
+        }
+        while (!sensor.pollPing()) {
+            Ticker::fireAll();
+        }
+    }
+    reading = sensor.endBurst(0);
+    
+    TEST_ASSERT_GREATER_THAN_UINT32(0, sensor.getOverrunCount());
+    TEST_ASSERT_TRUE(reading.isValid);
+    TEST_ASSERT_EQUAL_UINT16(500, reading.distanceMm);   // 3000 mm - 2500 mm head
+    TEST_ASSERT_EQUAL_UINT32(0, sensor.getNoResponseCount());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_dc_gain_is_removed_down_to_the_extra_bits);
+    RUN_TEST(test_one_output_per_ratio_inputs);
+    RUN_TEST(test_settles_after_stages_plus_one_outputs);
+    RUN_TEST(test_boxcar_is_the_block_mean);
+    RUN_TEST(test_integrator_wrap_does_not_corrupt_output);
+    RUN_TEST(test_configure_clamps_to_the_gain);
+    RUN_TEST(test_full_ring_drops_new_samples_and_counts_them);
+    RUN_TEST(test_reading_survives_a_task_that_falls_behind);
+    return UNITY_END();
+}
@@ -0,0 +1,319 @@
+#include <unity.h>
+#include "echo_capture.h"
+#include "sensor_ultrasonic.h"
+
+// ============================================================================
+// SIMULATED EDGE SOURCE
+// ============================================================================
+#define SIM_CYCLES_PER_US 80
+#define SIM_RISE_US 500     // Trigger to rising edge
+#define SIM_NEVER 0         // Echo width: the module holds the pin until its own timeout
+
+// Plays one scripted echo per trigger on a cycle counter that only moves in
+// waitMs(). Starts just short of the counter wrap, so every pulse test also
+// crosses it. Like the module, it ignores triggers while the echo pin is HIGH.
+class SimulatedEdgeHal : public EchoCaptureHal {
+public:
+    SimulatedEdgeHal()
+        : capture(nullptr), cycles(0xFFFFFFFF - 20000UL * SIM_CYCLES_PER_US),
+          echoCount(0), echoNext(0), riseAt(0), fallAt(0), risePending(false), fallPending(false),
+          high(false), silent(false), begins(0), ends(0), triggers(0), ignoredTriggers(0) {}
+    
+    // Echo widths for the next triggers, in order (the last one repeats)
+    void script(const uint32_t* widthsUs, uint8_t count) {
+        for (uint8_t i = 0; i < count && i < 16; i++) {
+            widths[i] = widthsUs[i];
+        }
+        echoCount = count;
+        echoNext = 0;
+    }
+    
+    bool begin(EchoCapture* capture) override {
+        this->capture = capture;
+        begins++;
+        return true;
+    }
+    void end() override {
+        capture = nullptr;
+        ends++;
+    }
+    void trigger() override {
+        if (high) {
+            ignoredTriggers++;
+            return;
+        }
+        triggers++;
+        if (silent) {
+            return;
+        }
+        uint32_t width = echoCount == 0 ? 0 : widths[echoNext < echoCount ? echoNext : echoCount - 1];
+        echoNext++;
+        riseAt = cycles + SIM_RISE_US * SIM_CYCLES_PER_US;
+        fallAt = riseAt + (width == SIM_NEVER ? SENSOR_MODULE_TIMEOUT_US : width) * SIM_CYCLES_PER_US;
+        risePending = true;
+        fallPending = true;
+    }
+    uint32_t cycleCount() const override { return cycles; }
+    uint32_t cyclesPerUs() const override { return SIM_CYCLES_PER_US; }
+    void waitMs(uint32_t ms) override { advanceUs(ms * 1000); }
+    bool echoLevel() const override { return high; }
+    
+    void advanceUs(uint32_t us) {
+        uint32_t left = us * SIM_CYCLES_PER_US;
+        if (risePending && riseAt - cycles <= left) {
+            left -= riseAt - cycles;
+            cycles = riseAt;
+            risePending = false;
+            high = true;
+            if (capture) {
+                capture->onEdge(true, cycles);
+            }
+        }
+        if (!risePending && fallPending && fallAt - cycles <= left) {
+            left -= fallAt - cycles;
+            cycles = fallAt;
+            fallPending = false;
+            high = false;
+            if (capture) {
+                capture->onEdge(false, cycles);
+            }
+        }
+        cycles += left;
+    }
+    
+    EchoCapture* capture;
+    uint32_t cycles;
+    uint32_t widths[16];
+    uint8_t echoCount;
+    uint8_t echoNext;
+    uint32_t riseAt;
+    uint32_t fallAt;
+    bool risePending;
+    bool fallPending;
+    bool high;
+    bool silent;            // Module does not answer triggers
+    uint32_t begins;
+    uint32_t ends;
+    uint32_t triggers;
+    uint32_t ignoredTriggers;
+};
+
+// Echo round trip for a distance at 20 °C (343.2 m/s)
+static uint32_t echoUsFor(uint32_t mm) {
+    return (uint32_t)(mm * 2 / 0.3432 + 0.5);
+}
+
+// One burst through the driver, with the settle time on the simulated clock
+static SensorReading runBurst(UltrasonicSensor& sensor, SimulatedEdgeHal& hal) {
+    sensor.beginBurst();
+    while (!sensor.burstComplete()) {
+        sensor.startPing();
+        while (!sensor.pollPing()) {
+            hal.waitMs(1);
+        }
+        hal.waitMs(SENSOR_SETTLE_MS);
+    }
+    return sensor.endBurst(0);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// CAPTURE STATE MACHINE
+// ============================================================================
+void test_pulse_width_is_falling_minus_rising_edge(void) {
+    EchoCapture capture;
+    EchoPulse pulse;
+    
+    capture.arm(1000, 30000);
+    capture.onEdge(true, 1500);
+    TEST_ASSERT_FALSE(capture.pop(pulse));
+    capture.onEdge(false, 1500 + 11600);
+    
+    TEST_ASSERT_TRUE(capture.pop(pulse));
+    TEST_ASSERT_EQUAL_UINT8(ECHO_OK, pulse.status);
+    TEST_ASSERT_EQUAL_UINT32(1500, pulse.riseCycles);
+    TEST_ASSERT_EQUAL_UINT32(11600, pulse.widthCycles);
+    TEST_ASSERT_FALSE(capture.pop(pulse));
+}
+
+void test_pulse_across_counter_wrap(void) {
+    EchoCapture capture;
+    EchoPulse pulse;
+    
+    capture.arm(0xFFFFF000, 0x4000);
+    capture.onEdge(true, 0xFFFFFF00);
+    capture.onEdge(false, 0x00000F00);
+    TEST_ASSERT_FALSE(capture.expire(0x00000F10));  // Already complete
+    
+    TEST_ASSERT_TRUE(capture.pop(pulse));
+    TEST_ASSERT_EQUAL_UINT8(ECHO_OK, pulse.status);
+    TEST_ASSERT_EQUAL_UINT32(0x1000, pulse.widthCycles);
+}
+
+void test_no_rising_edge_is_a_timeout(void) {
+    EchoCapture capture;
+    EchoPulse pulse;
+    
+    capture.arm(0xFFFFFF00, 1000);
+    TEST_ASSERT_FALSE(capture.expire(0xFFFFFF00 + 999));
+    TEST_ASSERT_FALSE(capture.pop(pulse));
+    TEST_ASSERT_TRUE(capture.expire(0xFFFFFF00 + 1000));   // Wraps to 0x2E8
+    
+    TEST_ASSERT_TRUE(capture.pop(pulse));
+    TEST_ASSERT_EQUAL_UINT8(ECHO_TIMEOUT, pulse.status);
+    TEST_ASSERT_EQUAL_UINT32(0, pulse.widthCycles);
+}
+
+void test_missing_falling_edge_expires_the_window(void) {
+    EchoCapture capture;
+    EchoPulse pulse;
+    
+    capture.arm(0, 1000);
+    capture.onEdge(true, 100);
+    TEST_ASSERT_TRUE(capture.expire(1000));
+    capture.onEdge(false, 1200);                       // Late edge after the window
+    
+    TEST_ASSERT_TRUE(capture.pop(pulse));
+    TEST_ASSERT_EQUAL_UINT8(ECHO_WINDOW_EXPIRED, pulse.status);
+    TEST_ASSERT_FALSE(capture.pop(pulse));             // Only one outcome per ping
+}
+
+void test_edges_outside_a_ping_are_ignored(void) {
+    EchoCapture capture;
+    EchoPulse pulse;
+    
+    capture.onEdge(true, 10);                          // Idle: ringing, noise
+    capture.onEdge(false, 20);
+    TEST_ASSERT_FALSE(capture.pop(pulse));
+    
+    capture.arm(100, 1000);
+    capture.onEdge(false, 150);                        // Falling edge before any rise
+    TEST_ASSERT_FALSE(capture.pop(pulse));
+    capture.onEdge(true, 200);
+    capture.onEdge(false, 700);
+    
+    TEST_ASSERT_TRUE(capture.pop(pulse));
+    TEST_ASSERT_EQUAL_UINT32(500, pulse.widthCycles);
+}
+
+void test_arm_drops_an_unread_result(void) {
+    EchoCapture capture;
+    EchoPulse pulse;
+    
+    capture.arm(0, 1000);
+    capture.onEdge(true, 100);
+    capture.onEdge(false, 300);
+    capture.arm(2000, 1000);
+    
+    TEST_ASSERT_FALSE(capture.pop(pulse));
+}
+
+void test_ring_refuses_pulses_when_full(void) {
+    EchoPulseRing ring;
+    EchoPulse pulse;
+    pulse.status = ECHO_OK;
+    
+    for (uint8_t i = 0; i < ECHO_RING_SIZE - 1; i++) {
+        pulse.widthCycles = i;
+        TEST_ASSERT_TRUE(ring.push(pulse));
+    }
+    TEST_ASSERT_FALSE(ring.push(pulse));
+    
+    for (uint8_t i = 0; i < ECHO_RING_SIZE - 1; i++) {
+        TEST_ASSERT_TRUE(ring.pop(pulse));
+        TEST_ASSERT_EQUAL_UINT32(i, pulse.widthCycles);
+    }
+    TEST_ASSERT_TRUE(ring.isEmpty());
+}
+
+// ============================================================================
+// DRIVER ON A SIMULATED EDGE SOURCE
+// ============================================================================
+void test_set_capture_hal_attaches_the_new_backend(void) {
+    UltrasonicSensor sensor(1, 2, 200, 20);
+    SimulatedEdgeHal first, second;
+    uint32_t width = echoUsFor(1000);
+    first.script(&width, 1);
+    second.script(&width, 1);
+    
+    sensor.setCaptureHal(&first);
+    TEST_ASSERT_EQUAL_UINT32(1, first.begins);
+    sensor.setCaptureHal(&second);
+    TEST_ASSERT_EQUAL_UINT32(1, first.ends);
+    TEST_ASSERT_EQUAL_UINT32(1, second.begins);
+    
+    // Edges reach the capture only through the attached backend
+    SensorReading reading = runBurst(sensor, second);
+    TEST_ASSERT_TRUE(reading.isValid);
+    TEST_ASSERT_EQUAL_UINT32(0, first.triggers);
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_FILTER_MIN_FILL, second.triggers);
+}
+
+void test_distance_from_simulated_echo(void) {
+    UltrasonicSensor sensor(1, 2, 200, 20);
+    SimulatedEdgeHal hal;
+    uint32_t width = echoUsFor(1500);
+    hal.script(&width, 1);
+    sensor.setCaptureHal(&hal);
+    
+    SensorReading reading = runBurst(sensor, hal);
+    TEST_ASSERT_TRUE(reading.isValid);
+    TEST_ASSERT_UINT32_WITHIN(1, 1500, reading.distanceMm);
+    TEST_ASSERT_UINT32_WITHIN(1, 2778, reading.levelCenti);   // (2000 - 1500) / 1800
+    TEST_ASSERT_EQUAL_UINT32(0, sensor.getNoResponseCount());
+}
+
+void test_silent_module_is_no_response(void) {
+    UltrasonicSensor sensor(1, 2, 200, 20);
+    SimulatedEdgeHal hal;
+    hal.silent = true;
+    sensor.setCaptureHal(&hal);
+    
+    sensor.beginBurst();
+    sensor.startPing();
+    uint32_t waitedMs = 0;
+    while (!sensor.pollPing()) {
+        hal.waitMs(1);
+        waitedMs++;
+    }
+    
+    // Given up after the echo window, not the module's 60 ms
+    TEST_ASSERT_EQUAL_UINT32(1, sensor.getNoResponseCount());
+    TEST_ASSERT_EQUAL_UINT32(0, sensor.getNoEchoCount());
+    TEST_ASSERT_UINT32_WITHIN(1, sensor.getTimeout() / 1000 + 1, waitedMs);
+}
+
+void test_held_echo_pin_delays_the_next_trigger(void) {
+    UltrasonicSensor sensor(1, 2, 200, 20);
+    SimulatedEdgeHal hal;
+    uint32_t widths[] = { SIM_NEVER, echoUsFor(1000) };
+    hal.script(widths, 2);
+    sensor.setCaptureHal(&hal);
+    
+    // The window (~14 ms) ends long before the module lets go (60 ms)
+    SensorReading reading = runBurst(sensor, hal);
+    TEST_ASSERT_TRUE(reading.isValid);
+    TEST_ASSERT_EQUAL_UINT32(1, sensor.getNoEchoCount());
+    TEST_ASSERT_EQUAL_UINT32(0, sensor.getNoResponseCount());
+    TEST_ASSERT_EQUAL_UINT32(1, sensor.getEchoHoldCount());
+    TEST_ASSERT_EQUAL_UINT32(0, hal.ignoredTriggers);
+    TEST_ASSERT_UINT32_WITHIN(1, 1000, reading.distanceMm);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pulse_width_is_falling_minus_rising_edge);
+    RUN_TEST(test_pulse_across_counter_wrap);
+    RUN_TEST(test_no_rising_edge_is_a_timeout);
+    RUN_TEST(test_missing_falling_edge_expires_the_window);
+    RUN_TEST(test_edges_outside_a_ping_are_ignored);
+    RUN_TEST(test_arm_drops_an_unread_result);
+    RUN_TEST(test_ring_refuses_pulses_when_full);
+    RUN_TEST(test_set_capture_hal_attaches_the_new_backend);
+    RUN_TEST(test_distance_from_simulated_echo);
+    RUN_TEST(test_silent_module_is_no_response);
+    RUN_TEST(test_held_echo_pin_delays_the_next_trigger);
+    return UNITY_END();
+}
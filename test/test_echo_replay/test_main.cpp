@@ -0,0 +1,256 @@
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include <math.h>
+#include "echo_replay.h"
+#include "sensor_ultrasonic.h"
+#include "temperature_source.h"
+
+// Replays the traces/ corpus through UltrasonicSensor on the replay HAL.
+// The burst is driven here the way readDistance() drives it, but settle
+// time goes through the HAL's waitMs() so every wait moves the replay
+// clock (readDistance() settles with Arduino delay() and stamps with
+// millis(), which would run on the host clock instead).
+// Paths are relative to the project directory, where `pio test` runs.
+
+#define REPLAY_MAX_RECORDS 1024
+
+struct ReplayTrace {
+    const char* path;
+    EchoTraceHeader header;
+    EchoTraceRecord records[REPLAY_MAX_RECORDS];
+    size_t count;
+};
+
+// Filter setup under test
+struct ReplayConfig {
+    const char* name;
+    uint8_t profile;
+    bool consensus;
+};
+
+static const ReplayConfig REPLAY_CONFIGS[] = {
+    { "rest",                 FILTER_PROFILE_REST,    true  },
+    { "rest, no consensus",   FILTER_PROFILE_REST,    false },
+    { "filling",              FILTER_PROFILE_FILLING, true  },
+    { "filling, no consensus", FILTER_PROFILE_FILLING, false }
+};
+#define REPLAY_CONFIG_COUNT (sizeof(REPLAY_CONFIGS) / sizeof(REPLAY_CONFIGS[0]))
+
+// Score of one replay against truthMm
+struct ReplayScore {
+    uint32_t readings;
+    uint32_t valid;
+    uint32_t scored;
+    double rmseMm;
+    double maxErrorMm;
+    uint32_t pings;
+    uint32_t noResponse;
+    uint32_t ignoredTriggers;
+    double nsPerReading;
+};
+
+static ReplayTrace calm = { "traces/calm.trace" };
+static ReplayTrace turbulentFill = { "traces/turbulent_fill.trace" };
+static ReplayTrace foam = { "traces/foam.trace" };
+static ReplayTrace intermittent = { "traces/intermittent_timeout.trace" };
+
+typedef std::chrono::steady_clock BenchClock;
+
+static bool load(ReplayTrace& trace) {
+    if (trace.count > 0) {
+        return true;
+    }
+    FILE* file = fopen(trace.path, "r");
+    if (!file) {
+        return false;
+    }
+    EchoTraceParser parser;
+    char line[ECHO_TRACE_LINE_SIZE];
+    while (fgets(line, sizeof(line), file) && trace.count < REPLAY_MAX_RECORDS) {
+        if (parser.parseLine(line, trace.records[trace.count])) {
+            trace.count++;
+        }
+    }
+    fclose(file);
+    trace.header = parser.getHeader();
+    return trace.count > 0;
+}
+
+static ReplayScore replay(const ReplayTrace& trace, const ReplayConfig& config) {
+    MemoryTraceSource source(trace.records, trace.count);
+    ReplayEchoCaptureHal hal(&source);
+    FixedTemperatureSource temperature(trace.header.celsiusTenths / 10.0f);
+    UltrasonicSensor sensor(0, 0, trace.header.emptyMm / 10.0f, trace.header.fullMm / 10.0f);
+    sensor.setCaptureHal(&hal);
+    sensor.setTemperatureSource(&temperature);
+    sensor.begin();
+    sensor.setFilterProfile(config.profile);
+    if (!config.consensus) {
+        sensor.setConsensus(0, SENSOR_CONSENSUS_TOL_MM, SENSOR_CONSENSUS_MAX_PINGS);
+        sensor.setSampleCount(1);
+    }
+    
+    ReplayScore score = {};
+    double squared = 0;
+    BenchClock::time_point start = BenchClock::now();
+    while (!hal.isExhausted()) {
+        sensor.beginBurst();
+        while (!sensor.burstComplete()) {
+            sensor.startPing();
+            while (!sensor.pollPing()) {
+                hal.waitMs(1);
+            }
+            hal.waitMs(SENSOR_SETTLE_MS);
+        }
+        SensorReading reading = sensor.endBurst(hal.cycleCount() / 1000);
+        if (hal.isExhausted()) {
+            break;      // The last burst ran past the end of the trace
+        }
+        score.readings++;
+        score.noResponse = sensor.getNoResponseCount();
+        
+        uint16_t truth = hal.getLastRecord().truthMm;
+        if (reading.isValid) {
+            score.valid++;
+            if (truth) {
+                double error = fabs((double)reading.distanceMm - truth);
+                squared += error * error;
+                score.maxErrorMm = fmax(score.maxErrorMm, error);
+                score.scored++;
+            }
+        }
+    }
+    score.nsPerReading = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count()
+                         / (score.readings ? score.readings : 1);
+    score.rmseMm = score.scored ? sqrt(squared / score.scored) : 0;
+    score.pings = hal.getPingCount();
+    score.ignoredTriggers = hal.getIgnoredTriggers();
+    return score;
+}
+
+static void report(const ReplayTrace& trace, const ReplayConfig& config, const ReplayScore& score) {
+    char message[200];
+    snprintf(message, sizeof(message),
+             "%-28s %-22s readings %3u valid %5.1f %% rmse %5.1f mm max %4.0f mm pings/reading %.2f cpu %6.0f ns/reading",
+             trace.path, config.name, score.readings, 100.0 * score.valid / (score.readings ? score.readings : 1),
+             score.rmseMm, score.maxErrorMm, (double)score.pings / (score.readings ? score.readings : 1),
+             score.nsPerReading);
+    TEST_MESSAGE(message);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// CORPUS
+// ============================================================================
+void test_corpus_parses(void) {
+    ReplayTrace* traces[] = { &calm, &turbulentFill, &foam, &intermittent };
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE_MESSAGE(load(*traces[i]), traces[i]->path);
+        TEST_ASSERT_LESS_THAN(REPLAY_MAX_RECORDS, traces[i]->count);
+        TEST_ASSERT_EQUAL_UINT16(2000, traces[i]->header.emptyMm);
+        TEST_ASSERT_EQUAL_UINT16(100, traces[i]->header.fullMm);
+        TEST_ASSERT_TRUE(traces[i]->header.hasTemperature);
+        TEST_ASSERT_EQUAL_INT16(200, traces[i]->header.celsiusTenths);
+    }
+}
+
+// ============================================================================
+// ACCURACY (default filter: rest profile with consensus)
+// ============================================================================
+void test_calm_surface(void) {
+    TEST_ASSERT_TRUE(load(calm));
+    ReplayScore score = replay(calm, REPLAY_CONFIGS[0]);
+    report(calm, REPLAY_CONFIGS[0], score);
+    
+    TEST_ASSERT_EQUAL_UINT32(score.readings, score.valid);
+    TEST_ASSERT_TRUE(score.rmseMm <= 2.0);
+    TEST_ASSERT_TRUE(score.maxErrorMm <= 5.0);
+    TEST_ASSERT_EQUAL_UINT32(0, score.noResponse);
+}
+
+void test_turbulent_fill_tracks_the_level(void) {
+    TEST_ASSERT_TRUE(load(turbulentFill));
+    ReplayScore score = replay(turbulentFill, REPLAY_CONFIGS[2]);
+    report(turbulentFill, REPLAY_CONFIGS[2], score);
+    
+    TEST_ASSERT_TRUE(score.valid * 10 >= score.readings * 9);
+    TEST_ASSERT_TRUE(score.rmseMm <= 12.0);
+    TEST_ASSERT_TRUE(score.maxErrorMm <= 35.0);
+    
+    // The filling profile exists for this trace: it must follow the ramp
+    // and reject the splashes better than the rest profile does
+    ReplayScore rest = replay(turbulentFill, REPLAY_CONFIGS[0]);
+    report(turbulentFill, REPLAY_CONFIGS[0], rest);
+    TEST_ASSERT_TRUE(score.rmseMm < rest.rmseMm);
+    TEST_ASSERT_TRUE(score.maxErrorMm < rest.maxErrorMm);
+    TEST_ASSERT_TRUE(score.valid * rest.readings >= rest.valid * score.readings);
+    
+    // Single pings leave the short window alone against the splashes
+    ReplayScore single = replay(turbulentFill, REPLAY_CONFIGS[3]);
+    report(turbulentFill, REPLAY_CONFIGS[3], single);
+    TEST_ASSERT_TRUE(single.rmseMm <= 12.0);
+    TEST_ASSERT_TRUE(single.maxErrorMm <= 35.0);
+}
+
+void test_foam_keeps_reading(void) {
+    TEST_ASSERT_TRUE(load(foam));
+    ReplayScore score = replay(foam, REPLAY_CONFIGS[0]);
+    report(foam, REPLAY_CONFIGS[0], score);
+    
+    // Foam echoes return short, but never past the top of the foam layer
+    TEST_ASSERT_TRUE(score.valid * 10 >= score.readings * 9);
+    TEST_ASSERT_TRUE(score.rmseMm <= 35.0);
+    TEST_ASSERT_TRUE(score.maxErrorMm <= 60.0);
+    
+    // An expired window holds the echo pin, so the next trigger goes
+    // unanswered; nothing else counts as no response
+    TEST_ASSERT_EQUAL_UINT32(score.ignoredTriggers, score.noResponse);
+}
+
+void test_intermittent_timeouts_are_no_response(void) {
+    TEST_ASSERT_TRUE(load(intermittent));
+    uint32_t timeouts = 0;
+    for (size_t i = 0; i < intermittent.count; i++) {
+        timeouts += intermittent.records[i].status == ECHO_TIMEOUT;
+    }
+    ReplayScore score = replay(intermittent, REPLAY_CONFIGS[0]);
+    report(intermittent, REPLAY_CONFIGS[0], score);
+    
+    // Every unanswered trigger is counted, none read as a distance
+    TEST_ASSERT_GREATER_THAN_UINT32(0, timeouts);
+    TEST_ASSERT_EQUAL_UINT32(0, score.ignoredTriggers);
+    TEST_ASSERT_EQUAL_UINT32(timeouts, score.noResponse);
+    TEST_ASSERT_LESS_THAN_UINT32(score.readings, score.valid);
+    TEST_ASSERT_TRUE(score.rmseMm <= 2.0);
+    TEST_ASSERT_TRUE(score.maxErrorMm <= 5.0);
+}
+
+// ============================================================================
+// BENCHMARK: accuracy and CPU per filter configuration
+// ============================================================================
+void test_benchmark_filter_configurations(void) {
+    ReplayTrace* traces[] = { &calm, &turbulentFill, &foam, &intermittent };
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(load(*traces[i]));
+        replay(*traces[i], REPLAY_CONFIGS[0]);      // Warm caches
+        for (uint8_t c = 0; c < REPLAY_CONFIG_COUNT; c++) {
+            ReplayScore score = replay(*traces[i], REPLAY_CONFIGS[c]);
+            report(*traces[i], REPLAY_CONFIGS[c], score);
+            TEST_ASSERT_GREATER_THAN_UINT32(0, score.valid);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_corpus_parses);
+    RUN_TEST(test_calm_surface);
+    RUN_TEST(test_turbulent_fill_tracks_the_level);
+    RUN_TEST(test_foam_keeps_reading);
+    RUN_TEST(test_intermittent_timeouts_are_no_response);
+    RUN_TEST(test_benchmark_filter_configurations);
+    return UNITY_END();
+}
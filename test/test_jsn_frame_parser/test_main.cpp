@@ -0,0 +1,213 @@
+#include <unity.h>
+#include "jsn_frame_parser.h"
+#include "level_sensor.h"
+
+// Valid frame for a distance
+static void makeFrame(uint8_t* frame, uint16_t mm) {
+    frame[0] = JSN_FRAME_HEADER;
+    frame[1] = mm >> 8;
+    frame[2] = mm & 0xFF;
+    frame[3] = (uint8_t)(frame[0] + frame[1] + frame[2]);
+}
+
+// Driver that hands LevelSensor scripted distances, one per ping
+class ScriptedSensor : public LevelSensor {
+public:
+    ScriptedSensor() : LevelSensor(200, 20), distances(nullptr), count(0), next(0) {}
+    
+    void script(const DistanceMm* distances, uint8_t count) {
+        this->distances = distances;
+        this->count = count;
+        next = 0;
+    }
+    
+    bool begin() override { return true; }
+    void startPing() override {}
+    bool pollPing() override {
+        recordPing(PING_ECHO, distances[next < count ? next : count - 1]);
+        next++;
+        return true;
+    }
+    uint32_t getTimeout() const override { return SENSOR_TIMEOUT_US; }
+    uint8_t getDriver() const override { return DRIVER_UART_CONTROLLED; }
+    
+    SensorReading burst() {
+        beginBurst();
+        while (!burstComplete()) {
+            startPing();
+            pollPing();
+        }
+        return endBurst(0);
+    }
+
+private:
+    const DistanceMm* distances;
+    uint8_t count;
+    uint8_t next;
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// FRAMES
+// ============================================================================
+void test_valid_frame(void) {
+    JsnFrameParser parser;
+    uint8_t frame[JSN_FRAME_SIZE];
+    makeFrame(frame, 1234);
+    
+    TEST_ASSERT_EQUAL(1, parser.feed(frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_UINT16(1234, parser.getDistanceMm());
+    TEST_ASSERT_EQUAL_UINT32(1, parser.getFrameCount());
+    TEST_ASSERT_EQUAL_UINT32(0, parser.getChecksumErrors());
+}
+
+void test_frame_split_across_reads(void) {
+    JsnFrameParser parser;
+    uint8_t frame[JSN_FRAME_SIZE];
+    makeFrame(frame, 2000);
+    
+    // RX buffer drained while the frame is still arriving
+    TEST_ASSERT_EQUAL(0, parser.feed(frame, 1));
+    TEST_ASSERT_EQUAL(0, parser.feed(frame + 1, 2));
+    TEST_ASSERT_EQUAL_UINT16(0, parser.getDistanceMm());
+    TEST_ASSERT_EQUAL(1, parser.feed(frame + 3, 1));
+    TEST_ASSERT_EQUAL_UINT16(2000, parser.getDistanceMm());
+    
+    // Byte by byte: only the checksum byte completes it
+    makeFrame(frame, 345);
+    TEST_ASSERT_FALSE(parser.feed(frame[0]));
+    TEST_ASSERT_FALSE(parser.feed(frame[1]));
+    TEST_ASSERT_FALSE(parser.feed(frame[2]));
+    TEST_ASSERT_TRUE(parser.feed(frame[3]));
+    TEST_ASSERT_EQUAL_UINT16(345, parser.getDistanceMm());
+}
+
+void test_several_frames_in_one_read_keep_the_last(void) {
+    JsnFrameParser parser;
+    uint8_t stream[JSN_FRAME_SIZE * 3];
+    makeFrame(stream, 1000);
+    makeFrame(stream + 4, 1001);
+    makeFrame(stream + 8, 1002);
+    
+    TEST_ASSERT_EQUAL(3, parser.feed(stream, sizeof(stream)));
+    TEST_ASSERT_EQUAL_UINT16(1002, parser.getDistanceMm());
+}
+
+void test_leading_garbage_is_dropped(void) {
+    JsnFrameParser parser;
+    uint8_t stream[3 + JSN_FRAME_SIZE] = { 0x12, 0x34, 0x56 };
+    makeFrame(stream + 3, 256);
+    
+    TEST_ASSERT_EQUAL(1, parser.feed(stream, sizeof(stream)));
+    TEST_ASSERT_EQUAL_UINT16(256, parser.getDistanceMm());
+    TEST_ASSERT_EQUAL_UINT32(3, parser.getDroppedBytes());
+}
+
+void test_no_echo_frame_reads_zero(void) {
+    JsnFrameParser parser;
+    uint8_t frame[JSN_FRAME_SIZE];
+    makeFrame(frame, 1500);
+    parser.feed(frame, sizeof(frame));
+    makeFrame(frame, 0);
+    
+    TEST_ASSERT_EQUAL(1, parser.feed(frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_UINT16(0, parser.getDistanceMm());
+}
+
+// ============================================================================
+// CHECKSUM AND RESYNC
+// ============================================================================
+void test_bad_checksum_is_rejected(void) {
+    JsnFrameParser parser;
+    uint8_t frame[JSN_FRAME_SIZE];
+    makeFrame(frame, 1500);
+    parser.feed(frame, sizeof(frame));
+    makeFrame(frame, 900);
+    frame[3]++;
+    
+    TEST_ASSERT_EQUAL(0, parser.feed(frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_UINT16(1500, parser.getDistanceMm());    // Last good one kept
+    TEST_ASSERT_EQUAL_UINT32(1, parser.getChecksumErrors());
+    TEST_ASSERT_EQUAL_UINT32(1, parser.getFrameCount());
+}
+
+void test_resync_on_header_inside_a_bad_frame(void) {
+    // Corrupted frame whose low byte is 0xFF, then a good frame: the 0xFF
+    // must not lock the parser out of step with the real headers
+    JsnFrameParser parser;
+    uint8_t stream[JSN_FRAME_SIZE * 2] = { JSN_FRAME_HEADER, 0x01, 0xFF, 0x00 };
+    makeFrame(stream + 4, 0x0210);
+    
+    TEST_ASSERT_EQUAL(1, parser.feed(stream, sizeof(stream)));
+    TEST_ASSERT_EQUAL_UINT16(0x0210, parser.getDistanceMm());
+    TEST_ASSERT_GREATER_OR_EQUAL(1, parser.getChecksumErrors());
+    
+    // And it stays in step
+    makeFrame(stream, 777);
+    TEST_ASSERT_EQUAL(1, parser.feed(stream, JSN_FRAME_SIZE));
+    TEST_ASSERT_EQUAL_UINT16(777, parser.getDistanceMm());
+}
+
+void test_stream_joined_mid_frame(void) {
+    // Reading starts on the checksum of a frame that is already gone
+    JsnFrameParser parser;
+    uint8_t stream[1 + JSN_FRAME_SIZE] = { 0xFF };
+    makeFrame(stream + 1, 1234);
+    
+    TEST_ASSERT_EQUAL(1, parser.feed(stream, sizeof(stream)));
+    TEST_ASSERT_EQUAL_UINT16(1234, parser.getDistanceMm());
+}
+
+void test_reset_drops_a_partial_frame(void) {
+    JsnFrameParser parser;
+    uint8_t frame[JSN_FRAME_SIZE];
+    makeFrame(frame, 1500);
+    parser.feed(frame, 2);
+    parser.reset();
+    
+    makeFrame(frame, 600);
+    TEST_ASSERT_EQUAL(1, parser.feed(frame, sizeof(frame)));
+    TEST_ASSERT_EQUAL_UINT16(600, parser.getDistanceMm());
+    TEST_ASSERT_EQUAL_UINT32(0, parser.getChecksumErrors());
+}
+
+// ============================================================================
+// BURSTS
+// ============================================================================
+void test_burst_of_only_rejected_samples_is_not_a_reading(void) {
+    ScriptedSensor sensor;
+    sensor.setConsensus(0, SENSOR_CONSENSUS_TOL_MM, SENSOR_CONSENSUS_MAX_PINGS);
+    sensor.setSampleCount(1);
+    
+    const DistanceMm steady[] = { 1000, 1001, 999 };
+    sensor.script(steady, 3);
+    SensorReading reading = sensor.burst();
+    TEST_ASSERT_TRUE(reading.isValid);
+    TEST_ASSERT_EQUAL_UINT16(1000, reading.distanceMm);
+    
+    // One frame, thrown out by the Hampel check: the window still holds
+    // 1000 mm, but that is not a new reading
+    const DistanceMm spike[] = { 1400 };
+    sensor.script(spike, 1);
+    reading = sensor.burst();
+    TEST_ASSERT_EQUAL_UINT8(1, reading.pings);
+    TEST_ASSERT_FALSE(reading.isValid);
+    TEST_ASSERT_EQUAL_UINT32(1, sensor.getFilter().getRejectedCount());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_valid_frame);
+    RUN_TEST(test_frame_split_across_reads);
+    RUN_TEST(test_several_frames_in_one_read_keep_the_last);
+    RUN_TEST(test_leading_garbage_is_dropped);
+    RUN_TEST(test_no_echo_frame_reads_zero);
+    RUN_TEST(test_bad_checksum_is_rejected);
+    RUN_TEST(test_resync_on_header_inside_a_bad_frame);
+    RUN_TEST(test_stream_joined_mid_frame);
+    RUN_TEST(test_reset_drops_a_partial_frame);
+    RUN_TEST(test_burst_of_only_rejected_samples_is_not_a_reading);
+    return UNITY_END();
+}
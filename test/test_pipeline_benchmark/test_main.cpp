@@ -0,0 +1,166 @@
+#include <unity.h>
+#include <chrono>
+#include "fixed_point.h"
+#include "speed_of_sound.h"
+#include "sensor_ultrasonic.h"
+
+// Host benchmark of one reading through the measurement pipeline:
+// echo µs -> distance -> level -> pump thresholds -> text, in the float
+// code this replaced and in the fixed-point code. The development machine
+// has an FPU, so the float arithmetic costs about the same as the integer
+// arithmetic here; on the ESP8266 each float operation is a soft-float
+// call, and only the formatting gap carries over as measured. Both sides
+// must agree on the level.
+
+#define BENCH_READINGS 200000
+#define BENCH_EMPTY_CM 200.0f
+#define BENCH_FULL_CM 20.0f
+#define BENCH_ON_PERCENT 20.0f
+#define BENCH_OFF_PERCENT 90.0f
+#define BENCH_BASELINE_SPEED 0.0343    // cm/µs, the removed SPEED_OF_SOUND
+
+static uint32_t echoes[BENCH_READINGS];
+static volatile uint32_t sink;
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double elapsedNs(BenchClock::time_point start) {
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+}
+
+// Echo times across the whole tank, repeatable between runs
+static void makeEchoes() {
+    uint32_t state = 12345;
+    for (uint32_t i = 0; i < BENCH_READINGS; i++) {
+        state = state * 1103515245 + 12345;
+        echoes[i] = 1000 + (state >> 8) % 11000;
+    }
+}
+
+// ============================================================================
+// FLOAT PIPELINE (as before the fixed-point change)
+// ============================================================================
+static float floatDistanceCm(uint32_t durationUs) {
+    return (durationUs / 2.0) * BENCH_BASELINE_SPEED;
+}
+
+static float floatPercent(float distanceCm) {
+    if (distanceCm <= BENCH_FULL_CM) {
+        return 100.0f;
+    } else if (distanceCm >= BENCH_EMPTY_CM) {
+        return 0.0f;
+    }
+    float range = BENCH_EMPTY_CM - BENCH_FULL_CM;
+    float percent = 100.0 - ((distanceCm - BENCH_FULL_CM) / range * 100.0);
+    return constrain(percent, 0.0, 100.0);
+}
+
+static double runFloat(float* levels, bool format) {
+    char text[16];
+    bool running = false;
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t i = 0; i < BENCH_READINGS; i++) {
+        float percent = floatPercent(floatDistanceCm(echoes[i]));
+        if (!running && percent <= BENCH_ON_PERCENT) {
+            running = true;
+        } else if (running && percent >= BENCH_OFF_PERCENT) {
+            running = false;
+        }
+        if (format) {
+            snprintf(text, sizeof(text), "%.1f", percent);
+            sink += text[0];
+        }
+        sink += running;
+        if (levels) {
+            levels[i] = percent;
+        }
+    }
+    return elapsedNs(start) / BENCH_READINGS;
+}
+
+// ============================================================================
+// FIXED-POINT PIPELINE (UltrasonicSensor / LevelSensor / PumpController)
+// ============================================================================
+static double runFixed(const LevelSensor& sensor, CentiPercent* levels, bool format) {
+    const uint16_t halfSpeed = SpeedOfSound::halfSpeedQ16((int16_t)(DEFAULT_AIR_TEMPERATURE_C * 10));
+    const CentiPercent onCenti = PERCENT_TO_CENTI(BENCH_ON_PERCENT);
+    const CentiPercent offCenti = PERCENT_TO_CENTI(BENCH_OFF_PERCENT);
+    char text[16];
+    bool running = false;
+    BenchClock::time_point start = BenchClock::now();
+    for (uint32_t i = 0; i < BENCH_READINGS; i++) {
+        uint32_t mmQ16 = SpeedOfSound::echoToMmQ16(echoes[i], halfSpeed);
+        DistanceMm distance = (DistanceMm)((mmQ16 + 0x8000) >> 16);
+        CentiPercent level = sensor.distanceToCenti(distance);
+        if (!running && level <= onCenti) {
+            running = true;
+        } else if (running && level >= offCenti) {
+            running = false;
+        }
+        if (format) {
+            formatFixed(text, sizeof(text), (level + 5) / 10, 1);
+            sink += text[0];
+        }
+        sink += running;
+        if (levels) {
+            levels[i] = level;
+        }
+    }
+    return elapsedNs(start) / BENCH_READINGS;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_fixed_point_matches_float_level(void) {
+    static float floatLevels[BENCH_READINGS];
+    static CentiPercent fixedLevels[BENCH_READINGS];
+    UltrasonicSensor sensor(1, 2, BENCH_EMPTY_CM, BENCH_FULL_CM);
+    makeEchoes();
+    runFloat(floatLevels, false);
+    runFixed(sensor, fixedLevels, false);
+    
+    // The speed of sound now comes from the 20 °C table (343.2 m/s) instead
+    // of 343 m/s, which moves a 2 m reading by about 1 mm
+    float worst = 0;
+    for (uint32_t i = 0; i < BENCH_READINGS; i++) {
+        float difference = fabsf(floatLevels[i] - centiToPercent(fixedLevels[i]));
+        if (difference > worst) {
+            worst = difference;
+        }
+    }
+    char message[64];
+    snprintf(message, sizeof(message), "Worst level difference %.3f %%", worst);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(worst <= 0.15f);
+}
+
+void test_benchmark_pipeline(void) {
+    UltrasonicSensor sensor(1, 2, BENCH_EMPTY_CM, BENCH_FULL_CM);
+    makeEchoes();
+    runFloat(nullptr, true);    // Warm caches
+    runFixed(sensor, nullptr, true);
+    
+    // Text formatting ("%.1f" vs formatFixed) dominates, so the arithmetic
+    // is also timed on its own
+    char message[112];
+    double floatNs = runFloat(nullptr, false);
+    double fixedNs = runFixed(sensor, nullptr, false);
+    snprintf(message, sizeof(message), "Echo to threshold: float %.1f ns, fixed point %.1f ns per reading (%.1fx)",
+             floatNs, fixedNs, floatNs / fixedNs);
+    TEST_MESSAGE(message);
+    
+    floatNs = runFloat(nullptr, true);
+    fixedNs = runFixed(sensor, nullptr, true);
+    snprintf(message, sizeof(message), "Echo to text: float %.1f ns, fixed point %.1f ns per reading (%.1fx)",
+             floatNs, fixedNs, floatNs / fixedNs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(fixedNs > 0);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fixed_point_matches_float_level);
+    RUN_TEST(test_benchmark_pipeline);
+    return UNITY_END();
+}
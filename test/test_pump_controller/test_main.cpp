@@ -0,0 +1,433 @@
+#include <unity.h>
+#include "pump_controller.h"
+
+// Pump time limits on a VirtualClock. The controller arms no Ticker for a
+// VirtualClock, so the test plays the timer: it moves the clock and calls
+// service() (or hands over a reading, which catches up first).
+
+#define TEST_MAX_RUN_MS  120000
+#define TEST_COOLDOWN_MS 30000
+
+static ConfigManager configManager;
+static VirtualClock clock;
+
+static SensorReading reading(float percent) {
+    SensorReading target = {};
+    target.filteredCenti = percentToCenti(percent);
+    target.levelCenti = target.filteredCenti;
+    target.isValid = true;
+    target.timestamp = clock.nowMs();
+    return target;
+}
+
+// Reading of a filling tank (rate in %/min)
+static SensorReading rising(float percent, float ratePerMin) {
+    SensorReading target = reading(percent);
+    target.rateCentiPerMin = percentToCenti(ratePerMin);
+    return target;
+}
+
+// Fresh controller in automatic mode; stall and predictive stops off so
+// only the time limits and thresholds act
+static void start(PumpController& pump, uint32_t startMs = 1000) {
+    TEST_ASSERT_TRUE(configManager.begin());
+    configManager.resetToDefaults();
+    SystemConfig& config = configManager.getConfigRef();
+    config.pumpMode = PUMP_AUTOMATIC;
+    config.pumpMaxRunTime = TEST_MAX_RUN_MS;
+    config.pumpCooldownTime = TEST_COOLDOWN_MS;
+    config.pumpStallWindow = 0;
+    config.pumpPredictiveStop = false;
+    
+    clock.set(startMs);
+    pump.setClock(&clock);
+    TEST_ASSERT_TRUE(pump.begin());
+}
+
+// Move the clock to an absolute time and run what is due
+static void serviceAt(PumpController& pump, uint32_t ms) {
+    clock.set(ms);
+    pump.service();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// MINIMUM RUN
+// ============================================================================
+void test_auto_stop_is_held_for_the_minimum_run(void) {
+    PumpController pump(configManager);
+    start(pump);
+    
+    pump.update(reading(10));
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    
+    // Full almost at once: the stop waits for the minimum run
+    clock.advance(2000);
+    pump.update(reading(95));
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    TEST_ASSERT_TRUE(pump.isStopPending());
+    
+    // No reading arrives in the meantime; the deadline alone stops it
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME - 1);
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+    TEST_ASSERT_FALSE(pump.isStopPending());
+    TEST_ASSERT_EQUAL_UINT32(0, pump.getMaxTimerLateness());
+}
+
+void test_auto_stop_after_the_minimum_run_is_immediate(void) {
+    PumpController pump(configManager);
+    start(pump);
+    
+    pump.update(reading(10));
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME + 500);
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    
+    pump.update(reading(95));
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+    TEST_ASSERT_FALSE(pump.isStopPending());
+}
+
+void test_level_drop_does_not_cancel_a_held_stop(void) {
+    PumpController pump(configManager);
+    start(pump);
+    
+    pump.update(reading(10));
+    clock.advance(1000);
+    pump.update(reading(95));
+    clock.advance(1000);
+    pump.update(reading(60));      // Ripple after the decision
+    TEST_ASSERT_TRUE(pump.isStopPending());
+    
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+}
+
+// ============================================================================
+// MAXIMUM RUN
+// ============================================================================
+void test_max_run_forces_an_error_stop(void) {
+    PumpController pump(configManager);
+    start(pump);
+    
+    TEST_ASSERT_TRUE(pump.turnOn());
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);      // Minimum run: nothing to stop
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    serviceAt(pump, 1000 + TEST_MAX_RUN_MS - 1);
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    TEST_ASSERT_EQUAL_UINT32(TEST_MAX_RUN_MS - 1, pump.getRunTime());
+    
+    serviceAt(pump, 1000 + TEST_MAX_RUN_MS);
+    TEST_ASSERT_EQUAL(PUMP_ERROR, pump.getState());
+    TEST_ASSERT_EQUAL(PUMP_FAULT_MAX_RUN, pump.getFault());
+    TEST_ASSERT_EQUAL_UINT32(0, pump.getMaxTimerLateness());
+    
+    // Errors need a reset; neither a command nor a low level restarts it
+    TEST_ASSERT_FALSE(pump.turnOn());
+    pump.update(reading(10));
+    TEST_ASSERT_EQUAL(PUMP_ERROR, pump.getState());
+}
+
+void test_max_run_applies_in_manual_mode(void) {
+    PumpController pump(configManager);
+    start(pump);
+    pump.setMode(PUMP_MANUAL);
+    
+    TEST_ASSERT_TRUE(pump.turnOn());
+    serviceAt(pump, 1000 + TEST_MAX_RUN_MS);
+    TEST_ASSERT_EQUAL(PUMP_ERROR, pump.getState());
+    TEST_ASSERT_EQUAL(PUMP_FAULT_MAX_RUN, pump.getFault());
+}
+
+void test_late_reading_catches_up_on_the_deadline(void) {
+    PumpController pump(configManager);
+    start(pump);
+    
+    // The timer did not get to run; the next reading finds the deadline
+    // passed and stops the pump before looking at the level
+    pump.update(reading(10));
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    clock.set(1000 + TEST_MAX_RUN_MS + 5000);
+    TEST_ASSERT_TRUE(pump.postReading(reading(50)));
+    pump.processCommands();
+    TEST_ASSERT_EQUAL(PUMP_ERROR, pump.getState());
+    TEST_ASSERT_EQUAL_UINT32(5000, pump.getMaxTimerLateness());
+}
+
+// ============================================================================
+// COOLDOWN
+// ============================================================================
+void test_cooldown_refuses_a_start_until_it_expires(void) {
+    PumpController pump(configManager);
+    start(pump);
+    
+    TEST_ASSERT_TRUE(pump.turnOn());
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    TEST_ASSERT_TRUE(pump.turnOff());
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+    TEST_ASSERT_EQUAL_UINT32(TEST_COOLDOWN_MS, pump.getCooldownRemaining());
+    
+    const uint32_t stoppedAt = 1000 + PUMP_MIN_RUN_TIME;
+    serviceAt(pump, stoppedAt + TEST_COOLDOWN_MS - 1);
+    TEST_ASSERT_FALSE(pump.turnOn());
+    TEST_ASSERT_EQUAL_STRING("In cooldown", pump.getLastError());
+    pump.update(reading(10));
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+    TEST_ASSERT_EQUAL_UINT32(1, pump.getCooldownRemaining());
+    
+    serviceAt(pump, stoppedAt + TEST_COOLDOWN_MS);
+    TEST_ASSERT_EQUAL(PUMP_OFF, pump.getState());
+    TEST_ASSERT_EQUAL_UINT32(0, pump.getCooldownRemaining());
+    pump.update(reading(10));
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+}
+
+void test_time_limits_across_the_millis_wrap(void) {
+    PumpController pump(configManager);
+    const uint32_t startMs = 0xFFFFFFFF - 3000;
+    start(pump, startMs);
+    
+    pump.update(reading(10));
+    clock.advance(1000);
+    pump.update(reading(95));
+    
+    // The minimum run ends after millis() wrapped
+    serviceAt(pump, startMs + PUMP_MIN_RUN_TIME - 1);
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    serviceAt(pump, startMs + PUMP_MIN_RUN_TIME);
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+    
+    serviceAt(pump, startMs + PUMP_MIN_RUN_TIME + TEST_COOLDOWN_MS - 1);
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+    serviceAt(pump, startMs + PUMP_MIN_RUN_TIME + TEST_COOLDOWN_MS);
+    TEST_ASSERT_EQUAL(PUMP_OFF, pump.getState());
+    TEST_ASSERT_EQUAL_UINT32(0, pump.getMaxTimerLateness());
+}
+
+// ============================================================================
+// PREDICTIVE STOP
+// ============================================================================
+// Default decision interval (5 s) and initial latency (3 s): a reading looks
+// 8 s ahead, so at 60 %/min it stops 8 % short of the 90 % OFF threshold
+void test_predictive_stop_projects_the_rise(void) {
+    PumpController pump(configManager);
+    start(pump);
+    configManager.getConfigRef().pumpPredictiveStop = true;
+    
+    pump.update(reading(10));
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    
+    clock.set(20000);
+    pump.update(rising(81, 60));    // Projects to 89 %
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    
+    clock.set(25000);
+    pump.update(rising(83, 60));    // Projects to 91 %
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+    TEST_ASSERT_EQUAL_UINT8(0, pump.getStopLogCount());     // Settling
+}
+
+void test_stop_latency_learns_from_the_settled_peak(void) {
+    PumpController pump(configManager);
+    start(pump);
+    configManager.getConfigRef().pumpPredictiveStop = true;
+    
+    pump.update(reading(10));
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    clock.set(25000);
+    pump.update(rising(83, 60));
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+    
+    // The level overshoots by 7 % (7 s at 60 %/min) and settles
+    clock.set(30000);
+    pump.update(reading(88));
+    clock.set(35000);
+    pump.update(reading(90));
+    clock.set(25000 + PUMP_PREDICT_SETTLE_MS - 1);
+    pump.update(reading(89));
+    TEST_ASSERT_EQUAL_UINT8(0, pump.getStopLogCount());
+    TEST_ASSERT_EQUAL_UINT32(PUMP_PREDICT_LATENCY_MS, pump.getStopLatency());
+    
+    clock.set(25000 + PUMP_PREDICT_SETTLE_MS);
+    pump.update(reading(89));
+    TEST_ASSERT_EQUAL_UINT8(1, pump.getStopLogCount());
+    const PumpStopRecord& record = pump.getStopRecord(0);
+    TEST_ASSERT_TRUE(record.predictive);
+    TEST_ASSERT_EQUAL_UINT32(25000, record.timestamp);
+    TEST_ASSERT_EQUAL_INT16(8300, record.levelCenti);
+    TEST_ASSERT_EQUAL_INT16(8600, record.predictedCenti);
+    TEST_ASSERT_EQUAL_INT16(9000, record.actualCenti);
+    
+    // A quarter of the way from 3 s to the observed 7 s
+    TEST_ASSERT_EQUAL_UINT32(4000, pump.getStopLatency());
+}
+
+void test_held_stop_learns_from_the_actual_stop(void) {
+    PumpController pump(configManager);
+    start(pump);
+    configManager.getConfigRef().pumpPredictiveStop = true;
+    
+    pump.update(reading(10));
+    
+    // Decided at 91 %, but the minimum run holds the pump on while the
+    // level climbs another 5 %
+    clock.set(3000);
+    pump.update(rising(91, 60));
+    TEST_ASSERT_TRUE(pump.isStopPending());
+    clock.set(8000);
+    pump.update(rising(96, 60));
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+    
+    // Only the 1 % after the relay opened (1 s at 60 %/min) is latency
+    const uint32_t stoppedAt = 1000 + PUMP_MIN_RUN_TIME;
+    clock.set(stoppedAt + 5000);
+    pump.update(reading(97));
+    clock.set(stoppedAt + PUMP_PREDICT_SETTLE_MS);
+    pump.update(reading(97));
+    TEST_ASSERT_EQUAL_UINT8(1, pump.getStopLogCount());
+    const PumpStopRecord& record = pump.getStopRecord(0);
+    TEST_ASSERT_FALSE(record.predictive);
+    TEST_ASSERT_EQUAL_UINT32(stoppedAt, record.timestamp);
+    TEST_ASSERT_EQUAL_INT16(9600, record.levelCenti);
+    TEST_ASSERT_EQUAL_INT16(9700, record.actualCenti);
+    TEST_ASSERT_EQUAL_UINT32(2500, pump.getStopLatency());
+}
+
+// ============================================================================
+// DRY RUN (stall)
+// ============================================================================
+#define TEST_STALL_WINDOW_MS 30000
+
+// Running pump with stall detection: 1 % rise per TEST_STALL_WINDOW_MS
+static void startStallRun(PumpController& pump, uint32_t startMs = 1000) {
+    start(pump, startMs);
+    configManager.getConfigRef().pumpStallRise = 1.0f;
+    configManager.getConfigRef().pumpStallWindow = TEST_STALL_WINDOW_MS;
+    TEST_ASSERT_TRUE(pump.turnOn());
+}
+
+void test_stall_trips_without_a_rise(void) {
+    PumpController pump(configManager);
+    startStallRun(pump);
+    
+    clock.set(5000);
+    pump.update(reading(50));
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    clock.set(5000 + TEST_STALL_WINDOW_MS - 1);
+    pump.update(reading(50.9f));
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    
+    clock.set(5000 + TEST_STALL_WINDOW_MS);
+    pump.update(reading(50.9f));
+    TEST_ASSERT_EQUAL(PUMP_ERROR, pump.getState());
+    TEST_ASSERT_EQUAL(PUMP_FAULT_NO_RISE, pump.getFault());
+    TEST_ASSERT_FALSE(pump.turnOn());
+}
+
+void test_stall_window_restarts_on_progress(void) {
+    PumpController pump(configManager);
+    startStallRun(pump);
+    
+    clock.set(5000);
+    pump.update(reading(50));
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    
+    // 1 % just inside the window: the next one is measured from here
+    clock.set(5000 + TEST_STALL_WINDOW_MS - 1);
+    pump.update(reading(51));
+    clock.set(5000 + TEST_STALL_WINDOW_MS);
+    pump.update(reading(51.5f));
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    
+    const uint32_t progressAt = 5000 + TEST_STALL_WINDOW_MS - 1;
+    clock.set(progressAt + TEST_STALL_WINDOW_MS - 1);
+    pump.update(reading(51.5f));
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    clock.set(progressAt + TEST_STALL_WINDOW_MS);
+    pump.update(reading(51.5f));
+    TEST_ASSERT_EQUAL(PUMP_FAULT_NO_RISE, pump.getFault());
+}
+
+void test_stall_ignores_readings_from_before_the_run(void) {
+    PumpController pump(configManager);
+    startStallRun(pump, 10000);
+    
+    // Taken before the pump started, delivered after: no window starts there
+    SensorReading early = reading(50);
+    early.timestamp = 2000;
+    pump.update(early);
+    
+    clock.set(15000);
+    pump.update(reading(50));
+    serviceAt(pump, 10000 + PUMP_MIN_RUN_TIME);
+    clock.set(15000 + TEST_STALL_WINDOW_MS - 1);
+    pump.update(reading(50));
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    clock.set(15000 + TEST_STALL_WINDOW_MS);
+    pump.update(reading(50));
+    TEST_ASSERT_EQUAL(PUMP_FAULT_NO_RISE, pump.getFault());
+}
+
+void test_stall_spares_a_full_tank(void) {
+    PumpController pump(configManager);
+    startStallRun(pump);
+    pump.setMode(PUMP_MANUAL);      // Run on past the OFF threshold
+    
+    clock.set(5000);
+    pump.update(reading(99.5f));
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    clock.set(5000 + 2 * TEST_STALL_WINDOW_MS);
+    pump.update(reading(99.5f));
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    TEST_ASSERT_EQUAL(PUMP_FAULT_NONE, pump.getFault());
+}
+
+void test_fault_reset_allows_a_restart(void) {
+    PumpController pump(configManager);
+    start(pump);
+    TEST_ASSERT_FALSE(pump.resetFault());       // Nothing to reset
+    
+    configManager.getConfigRef().pumpStallWindow = TEST_STALL_WINDOW_MS;
+    TEST_ASSERT_TRUE(pump.turnOn());
+    clock.set(5000);
+    pump.update(reading(50));
+    serviceAt(pump, 1000 + PUMP_MIN_RUN_TIME);
+    clock.set(5000 + TEST_STALL_WINDOW_MS);
+    pump.update(reading(50));
+    TEST_ASSERT_EQUAL(PUMP_ERROR, pump.getState());
+    
+    // Through the queue, as the web and MQTT commands arrive
+    TEST_ASSERT_TRUE(pump.post(PUMP_CMD_RESET, PUMP_ORIGIN_MQTT));
+    pump.processCommands();
+    TEST_ASSERT_EQUAL(PUMP_OFF, pump.getState());
+    TEST_ASSERT_EQUAL(PUMP_FAULT_NONE, pump.getFault());
+    TEST_ASSERT_EQUAL_STRING("", pump.getLastError());
+    
+    pump.update(reading(10));
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_auto_stop_is_held_for_the_minimum_run);
+    RUN_TEST(test_auto_stop_after_the_minimum_run_is_immediate);
+    RUN_TEST(test_level_drop_does_not_cancel_a_held_stop);
+    RUN_TEST(test_max_run_forces_an_error_stop);
+    RUN_TEST(test_max_run_applies_in_manual_mode);
+    RUN_TEST(test_late_reading_catches_up_on_the_deadline);
+    RUN_TEST(test_cooldown_refuses_a_start_until_it_expires);
+    RUN_TEST(test_time_limits_across_the_millis_wrap);
+    RUN_TEST(test_predictive_stop_projects_the_rise);
+    RUN_TEST(test_stop_latency_learns_from_the_settled_peak);
+    RUN_TEST(test_held_stop_learns_from_the_actual_stop);
+    RUN_TEST(test_stall_trips_without_a_rise);
+    RUN_TEST(test_stall_window_restarts_on_progress);
+    RUN_TEST(test_stall_ignores_readings_from_before_the_run);
+    RUN_TEST(test_stall_spares_a_full_tank);
+    RUN_TEST(test_fault_reset_allows_a_restart);
+    return UNITY_END();
+}
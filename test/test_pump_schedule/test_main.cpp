@@ -0,0 +1,251 @@
+#include <unity.h>
+#include "pump_schedule.h"
+#include "pump_controller.h"
+
+#define MINUTE(day, hour, minute) ((day) * MINUTES_PER_DAY + (hour) * 60 + (minute))
+#define SECOND(day, hour, minute) ((uint32_t)MINUTE(day, hour, minute) * 60)
+
+#define SUNDAY   0
+#define MONDAY   1
+#define SATURDAY 6
+
+static ConfigManager configManager;
+static VirtualClock clock;
+
+static void assertNextChange(const PumpSchedule& schedule, uint32_t second, bool expectOpen, uint32_t expectSeconds) {
+    bool open;
+    uint32_t seconds;
+    TEST_ASSERT_TRUE(schedule.nextChange(second, open, seconds));
+    TEST_ASSERT_EQUAL(expectOpen, open);
+    TEST_ASSERT_EQUAL(expectOpen, schedule.isOpen(second));
+    TEST_ASSERT_EQUAL_UINT32(expectSeconds, seconds);
+}
+
+static SensorReading reading(float percent) {
+    SensorReading target = {};
+    target.filteredCenti = percentToCenti(percent);
+    target.isValid = true;
+    target.timestamp = clock.nowMs();
+    return target;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ============================================================================
+// WINDOW EDGES
+// ============================================================================
+void test_window_edges_to_the_second(void) {
+    PumpSchedule schedule;
+    const PumpWindow windows[] = { { MINUTE(MONDAY, 1, 0), MINUTE(MONDAY, 5, 0) } };
+    TEST_ASSERT_TRUE(schedule.setWindows(windows, 1));
+    
+    // Open from the start second up to, not including, the end second
+    assertNextChange(schedule, SECOND(MONDAY, 1, 0) - 1, false, 1);
+    assertNextChange(schedule, SECOND(MONDAY, 1, 0), true, 4 * 3600);
+    assertNextChange(schedule, SECOND(MONDAY, 5, 0) - 1, true, 1);
+    
+    // After the last edge of the week the next one is next Monday
+    assertNextChange(schedule, SECOND(MONDAY, 5, 0), false, SECONDS_PER_WEEK - 4 * 3600);
+    assertNextChange(schedule, SECONDS_PER_WEEK - 1, false, SECOND(MONDAY, 1, 0) + 1);
+    assertNextChange(schedule, 0, false, SECOND(MONDAY, 1, 0));
+}
+
+void test_window_across_the_week_end(void) {
+    // Saturday 23:00 to Sunday 02:00
+    PumpSchedule schedule;
+    const PumpWindow windows[] = {
+        { MINUTE(SATURDAY, 23, 0), MINUTE(SUNDAY, 2, 0) },
+        { MINUTE(MONDAY, 23, 0), MINUTE(MONDAY, 23, 30) }
+    };
+    TEST_ASSERT_TRUE(schedule.setWindows(windows, 2));
+    
+    assertNextChange(schedule, SECOND(SATURDAY, 22, 0), false, 3600);
+    
+    // Open through midnight; the next change is the real close on Sunday
+    assertNextChange(schedule, SECOND(SATURDAY, 23, 0), true, 3 * 3600);
+    assertNextChange(schedule, SECONDS_PER_WEEK - 1, true, 2 * 3600 + 1);
+    assertNextChange(schedule, 0, true, 2 * 3600);
+    assertNextChange(schedule, SECOND(SUNDAY, 2, 0), false, SECOND(MONDAY, 23, 0) - SECOND(SUNDAY, 2, 0));
+}
+
+void test_window_ending_at_midnight_saturday(void) {
+    PumpSchedule schedule;
+    const PumpWindow windows[] = { { MINUTE(SATURDAY, 22, 0), 0 } };
+    TEST_ASSERT_TRUE(schedule.setWindows(windows, 1));
+    
+    assertNextChange(schedule, SECONDS_PER_WEEK - 1, true, 1);
+    assertNextChange(schedule, 0, false, SECOND(SATURDAY, 22, 0));
+}
+
+void test_overlapping_and_touching_windows_merge(void) {
+    PumpSchedule schedule;
+    const PumpWindow windows[] = {
+        { MINUTE(MONDAY, 2, 0), MINUTE(MONDAY, 4, 0) },    // Overlaps the next
+        { MINUTE(MONDAY, 1, 0), MINUTE(MONDAY, 3, 0) },
+        { MINUTE(MONDAY, 4, 0), MINUTE(MONDAY, 5, 0) },    // Touches
+        { MINUTE(MONDAY, 1, 30), MINUTE(MONDAY, 2, 30) },  // Inside
+        { MINUTE(MONDAY, 9, 0), MINUTE(MONDAY, 9, 0) }     // Empty
+    };
+    TEST_ASSERT_TRUE(schedule.setWindows(windows, 5));
+    
+    // One window, 01:00 to 05:00, with no edge at 03:00 or 04:00
+    assertNextChange(schedule, SECOND(MONDAY, 1, 0), true, 4 * 3600);
+    assertNextChange(schedule, SECOND(MONDAY, 3, 0), true, 2 * 3600);
+    assertNextChange(schedule, SECOND(MONDAY, 4, 0), true, 3600);
+    assertNextChange(schedule, SECOND(MONDAY, 5, 0), false, SECONDS_PER_WEEK - 4 * 3600);
+    TEST_ASSERT_FALSE(schedule.isOpen(SECOND(MONDAY, 9, 0)));
+}
+
+void test_overlap_across_the_week_end(void) {
+    // Every night 23:00 to 06:00, plus Saturday afternoon into the night
+    PumpSchedule schedule;
+    PumpWindow windows[PUMP_SCHEDULE_MAX_WINDOWS];
+    uint8_t count = PumpSchedule::makeWindows(SCHEDULE_EVERY_DAY, "23:00", "06:00", windows, 7);
+    TEST_ASSERT_EQUAL_UINT8(7, count);
+    windows[count].startMin = MINUTE(SATURDAY, 14, 0);
+    windows[count++].endMin = MINUTE(SATURDAY, 23, 30);
+    TEST_ASSERT_TRUE(schedule.setWindows(windows, count));
+    
+    // Saturday 14:00 straight through to Sunday 06:00
+    assertNextChange(schedule, SECOND(SATURDAY, 14, 0), true, 16 * 3600);
+    assertNextChange(schedule, SECOND(SUNDAY, 5, 59), true, 60);
+    assertNextChange(schedule, SECOND(SUNDAY, 6, 0), false, 17 * 3600);
+}
+
+void test_invalid_windows_leave_the_schedule(void) {
+    PumpSchedule schedule;
+    const PumpWindow good[] = { { MINUTE(MONDAY, 1, 0), MINUTE(MONDAY, 2, 0) } };
+    const PumpWindow bad[] = { { MINUTE(MONDAY, 1, 0), MINUTES_PER_WEEK } };
+    TEST_ASSERT_TRUE(schedule.setWindows(good, 1));
+    TEST_ASSERT_FALSE(schedule.setWindows(bad, 1));
+    TEST_ASSERT_FALSE(schedule.setWindows(good, PUMP_SCHEDULE_MAX_WINDOWS + 1));
+    TEST_ASSERT_TRUE(schedule.isOpen(SECOND(MONDAY, 1, 30)));
+    
+    bool open;
+    uint32_t seconds;
+    TEST_ASSERT_TRUE(schedule.setWindows(nullptr, 0));
+    TEST_ASSERT_TRUE(schedule.isEmpty());
+    TEST_ASSERT_FALSE(schedule.nextChange(SECOND(MONDAY, 1, 30), open, seconds));
+    TEST_ASSERT_FALSE(open);
+}
+
+void test_make_windows_and_format(void) {
+    PumpWindow windows[PUMP_SCHEDULE_MAX_WINDOWS];
+    TEST_ASSERT_EQUAL_UINT8(1, PumpSchedule::makeWindows(SATURDAY, "23:00", "06:00", windows, 1));
+    TEST_ASSERT_EQUAL_UINT16(MINUTE(SATURDAY, 23, 0), windows[0].startMin);
+    TEST_ASSERT_EQUAL_UINT16(MINUTE(SUNDAY, 6, 0), windows[0].endMin);
+    
+    TEST_ASSERT_EQUAL_UINT8(0, PumpSchedule::makeWindows(SCHEDULE_EVERY_DAY, "23:00", "06:00", windows, 6));
+    TEST_ASSERT_EQUAL_UINT8(0, PumpSchedule::makeWindows(MONDAY, "24:00", "06:00", windows, 1));
+    TEST_ASSERT_EQUAL_UINT8(0, PumpSchedule::makeWindows(MONDAY, "23:00", "6", windows, 1));
+    
+    char text[16];
+    PumpSchedule::formatMinute(text, sizeof(text), MINUTE(MONDAY, 23, 5));
+    TEST_ASSERT_EQUAL_STRING("Mon 23:05", text);
+}
+
+// ============================================================================
+// SCHEDULED MODE
+// ============================================================================
+void test_scheduled_mode_follows_the_windows(void) {
+    TEST_ASSERT_TRUE(configManager.begin());
+    configManager.resetToDefaults();
+    SystemConfig& config = configManager.getConfigRef();
+    config.pumpMode = PUMP_SCHEDULED;
+    config.pumpStallWindow = 0;
+    config.pumpPredictiveStop = false;
+    config.pumpWindowCount = 0;
+    
+    PumpController pump(configManager);
+    clock.set(1000);
+    clock.setWallTime(SECOND(SATURDAY, 23, 29));
+    pump.setClock(&clock);
+    TEST_ASSERT_TRUE(pump.begin());
+    
+    // Saturday 23:30 to Sunday 00:20, staged and applied by the owner
+    const PumpWindow windows[] = { { MINUTE(SATURDAY, 23, 30), MINUTE(SUNDAY, 0, 20) } };
+    TEST_ASSERT_TRUE(pump.setSchedule(windows, 1, PUMP_ORIGIN_MQTT));
+    pump.processCommands();
+    TEST_ASSERT_EQUAL_UINT8(1, config.pumpWindowCount);
+    
+    uint32_t ms;
+    TEST_ASSERT_FALSE(pump.isWindowOpen());
+    TEST_ASSERT_TRUE(pump.getWindowChangeIn(ms));
+    TEST_ASSERT_EQUAL_UINT32(60000, ms);
+    
+    // Low level outside the window: no start
+    pump.update(reading(10));
+    TEST_ASSERT_EQUAL(PUMP_OFF, pump.getState());
+    
+    clock.advance(59999);
+    pump.service();
+    TEST_ASSERT_FALSE(pump.isWindowOpen());
+    clock.advance(1);
+    pump.service();
+    TEST_ASSERT_TRUE(pump.isWindowOpen());
+    pump.update(reading(10));
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    
+    // Through the week end without a stop; closed at 00:20
+    TEST_ASSERT_TRUE(pump.getWindowChangeIn(ms));
+    TEST_ASSERT_EQUAL_UINT32(50 * 60000, ms);
+    clock.advance(PUMP_MIN_RUN_TIME);
+    pump.service();
+    clock.advance(30 * 60000 - PUMP_MIN_RUN_TIME);
+    pump.update(reading(40));
+    TEST_ASSERT_TRUE(pump.isWindowOpen());
+    TEST_ASSERT_TRUE(pump.getWindowChangeIn(ms));
+    TEST_ASSERT_EQUAL_UINT32(20 * 60000, ms);
+    
+    clock.advance(20 * 60000 - 1);
+    pump.service();
+    TEST_ASSERT_EQUAL(PUMP_ON, pump.getState());
+    clock.advance(1);
+    pump.service();
+    TEST_ASSERT_FALSE(pump.isWindowOpen());
+    TEST_ASSERT_EQUAL(PUMP_COOLDOWN, pump.getState());
+    TEST_ASSERT_EQUAL_UINT32(0, pump.getMaxTimerLateness());
+}
+
+void test_scheduled_mode_waits_for_the_clock(void) {
+    TEST_ASSERT_TRUE(configManager.begin());
+    configManager.resetToDefaults();
+    SystemConfig& config = configManager.getConfigRef();
+    config.pumpMode = PUMP_SCHEDULED;
+    config.pumpWindows[0].startMin = 0;
+    config.pumpWindows[0].endMin = MINUTES_PER_WEEK - 1;
+    config.pumpWindowCount = 1;
+    
+    // No wall time yet (NTP not synced): closed, looked at again later
+    VirtualClock unset(1000);
+    PumpController pump(configManager);
+    pump.setClock(&unset);
+    TEST_ASSERT_TRUE(pump.begin());
+    
+    uint32_t ms;
+    TEST_ASSERT_FALSE(pump.isWindowOpen());
+    TEST_ASSERT_TRUE(pump.getWindowChangeIn(ms));
+    TEST_ASSERT_EQUAL_UINT32(PUMP_SCHEDULE_RETRY_MS, ms);
+    pump.update(reading(10));
+    TEST_ASSERT_EQUAL(PUMP_OFF, pump.getState());
+    
+    unset.setWallTime(SECOND(MONDAY, 12, 0));
+    unset.advance(PUMP_SCHEDULE_RETRY_MS);
+    pump.service();
+    TEST_ASSERT_TRUE(pump.isWindowOpen());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_window_edges_to_the_second);
+    RUN_TEST(test_window_across_the_week_end);
+    RUN_TEST(test_window_ending_at_midnight_saturday);
+    RUN_TEST(test_overlapping_and_touching_windows_merge);
+    RUN_TEST(test_overlap_across_the_week_end);
+    RUN_TEST(test_invalid_windows_leave_the_schedule);
+    RUN_TEST(test_make_windows_and_format);
+    RUN_TEST(test_scheduled_mode_follows_the_windows);
+    RUN_TEST(test_scheduled_mode_waits_for_the_clock);
+    return UNITY_END();
+}